@@ -2,24 +2,41 @@
 #define _BUTTON_H_
 #include "esp_err.h"
 
+//组合键最多包含的按键个数
+#define BUTTON_COMBO_MAX    4
+
 //按键回调函数
 typedef void(*button_press_cb)(void);
 
+//多击回调函数，count为连击次数(>=2)
+typedef void(*button_multi_cb)(int count);
+
 //按键配置结构体
 typedef struct
 {
     int gpio_num;           //gpio号
     int active_level;       //按下的电平
     int long_press_time;    //长按时间
-    button_press_cb short_cb;   //短按回调函数
+    button_press_cb short_cb;   //短按回调函数，配置了双击/多击回调时在连击间隔结束、只按了一次才调用
     button_press_cb long_cb;    //长按回调函数
+    int click_interval;         //连击间隔，松开后这段时间内再次按下算连击，0表示默认300ms
+    button_press_cb double_cb;  //双击回调函数，可以为NULL
+    button_multi_cb multi_cb;   //多击回调函数(双击时也会调用)，可以为NULL
 }button_config_t;
 
 /** 设置按键事件
  * @param cfg   配置结构体
- * @return ESP_OK or ESP_FAIL 
+ * @return ESP_OK or ESP_FAIL
 */
 esp_err_t button_event_set(button_config_t *cfg);
 
+/** 设置组合键事件，所有按键同时按住时触发一次，组合键中的按键不再触发各自的长按和连击
+ * @param gpio_nums 组合键的gpio号，这些按键需要先通过button_event_set添加
+ * @param num       按键个数，2~BUTTON_COMBO_MAX
+ * @param cb        回调函数
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t button_combo_set(const int *gpio_nums, int num, button_press_cb cb);
+
 
 #endif
@@ -0,0 +1,263 @@
+#include "input_event.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+static const char* TAG = "input_event";
+
+#define RING_MASK   (INPUT_EVENT_RING_LEN - 1)
+
+_Static_assert((INPUT_EVENT_RING_LEN & RING_MASK) == 0, "INPUT_EVENT_RING_LEN must be a power of 2");
+
+/*
+ * 有界无锁队列(每个槽带序号)：
+ * 槽的序号等于写位置时可写，生产者用CAS抢到写位置后填数据，再把序号改为写位置+1表示可读；
+ * 消费者读完后把序号改为读位置+缓存长度，留给下一圈的生产者。
+ * 序号减去槽下标后存放，全0的初始状态就是空缓存，分发任务启动之前也可以放入事件
+ */
+typedef struct
+{
+    atomic_uint seq;        //序号 - 槽下标
+    input_event_t event;
+}input_slot_t;
+
+//订阅者
+typedef struct
+{
+    uint32_t src_mask;
+    input_event_cb cb;
+    void *arg;
+}input_subscriber_t;
+
+static input_slot_t s_ring[INPUT_EVENT_RING_LEN];
+static atomic_uint s_write_pos;         //下一个写位置，多个生产者竞争
+static atomic_uint s_read_pos;          //下一个读位置，只有分发任务修改
+
+static TaskHandle_t s_dispatch_task = NULL;
+static portMUX_TYPE s_init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static input_subscriber_t s_subscriber[INPUT_EVENT_MAX_SUBSCRIBER];
+static portMUX_TYPE s_subscriber_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//统计，生产者和分发任务都会修改
+static atomic_uint s_posted;
+static atomic_uint s_dropped;
+static atomic_uint s_max_depth;
+static uint32_t s_dispatched;
+static uint32_t s_max_latency_us;
+static uint32_t s_slow_handlers;
+
+/** 放入一个事件，不阻塞，任务和中断中都可以调用
+ * @param event 事件
+ * @return true 成功，false 缓存已满(计入dropped)
+*/
+bool IRAM_ATTR input_event_post(const input_event_t *event)
+{
+    input_slot_t *slot;
+    unsigned pos = atomic_load_explicit(&s_write_pos, memory_order_relaxed);
+    while (1)
+    {
+        slot = &s_ring[pos & RING_MASK];
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire) + (pos & RING_MASK);
+        int diff = (int)(seq - pos);
+        if (diff == 0)
+        {
+            //槽空闲，抢写位置，失败时pos被更新为最新的写位置
+            if (atomic_compare_exchange_weak_explicit(&s_write_pos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            //上一圈的数据还没被读走，缓存已满
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&s_write_pos, memory_order_relaxed);
+        }
+    }
+    slot->event = *event;
+    if (slot->event.time_us == 0)
+        slot->event.time_us = esp_timer_get_time();
+    atomic_store_explicit(&slot->seq, pos + 1 - (pos & RING_MASK), memory_order_release);
+
+    //记录积压深度
+    unsigned depth = pos + 1 - atomic_load_explicit(&s_read_pos, memory_order_relaxed);
+    unsigned max_depth = atomic_load_explicit(&s_max_depth, memory_order_relaxed);
+    while (depth > max_depth &&
+        !atomic_compare_exchange_weak_explicit(&s_max_depth, &max_depth, depth,
+            memory_order_relaxed, memory_order_relaxed))
+        ;
+    atomic_fetch_add_explicit(&s_posted, 1, memory_order_relaxed);
+
+    //唤醒分发任务
+    if (s_dispatch_task)
+    {
+        if (xPortInIsrContext())
+        {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(s_dispatch_task, &woken);
+            if (woken)
+                portYIELD_FROM_ISR();
+        }
+        else
+        {
+            xTaskNotifyGive(s_dispatch_task);
+        }
+    }
+    return true;
+}
+
+/** 取出一个事件，只在分发任务中调用
+ * @param event 输出
+ * @return true 取到，false 缓存为空
+*/
+static bool input_event_take(input_event_t *event)
+{
+    unsigned pos = atomic_load_explicit(&s_read_pos, memory_order_relaxed);
+    input_slot_t *slot = &s_ring[pos & RING_MASK];
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire) + (pos & RING_MASK);
+    if ((int)(seq - (pos + 1)) < 0)
+        return false;
+    *event = slot->event;
+    atomic_store_explicit(&slot->seq, pos + INPUT_EVENT_RING_LEN - (pos & RING_MASK), memory_order_release);
+    atomic_store_explicit(&s_read_pos, pos + 1, memory_order_relaxed);
+    return true;
+}
+
+/** 把一个事件交给所有订阅者，回调在锁外执行
+ * @param event 事件
+ * @return 无
+*/
+static void input_event_dispatch(const input_event_t *event)
+{
+    input_subscriber_t subscriber[INPUT_EVENT_MAX_SUBSCRIBER];
+    portENTER_CRITICAL(&s_subscriber_lock);
+    memcpy(subscriber, s_subscriber, sizeof(subscriber));
+    portEXIT_CRITICAL(&s_subscriber_lock);
+
+    int64_t start = esp_timer_get_time();
+    uint32_t latency = (uint32_t)(start - event->time_us);
+    if (latency > s_max_latency_us)
+        s_max_latency_us = latency;
+
+    for (int i = 0; i < INPUT_EVENT_MAX_SUBSCRIBER; i++)
+    {
+        if (!subscriber[i].cb || !(subscriber[i].src_mask & INPUT_SRC_MASK(event->source)))
+            continue;
+        int64_t t0 = esp_timer_get_time();
+        subscriber[i].cb(event, subscriber[i].arg);
+        int64_t cost = esp_timer_get_time() - t0;
+        if (cost > INPUT_EVENT_SLOW_US)
+        {
+            s_slow_handlers++;
+            ESP_LOGW(TAG, "slow handler %d: %lld us", i, cost);
+        }
+    }
+    s_dispatched++;
+}
+
+/** 分发任务，缓存为空时阻塞等待通知
+ * @param param 无
+ * @return 无
+*/
+static void input_event_task(void *param)
+{
+    input_event_t event;
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (input_event_take(&event))
+            input_event_dispatch(&event);
+    }
+}
+
+/** 初始化并启动分发任务，可以重复调用
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t input_event_init(void)
+{
+    static bool s_inited = false;
+    bool first = false;
+    portENTER_CRITICAL(&s_init_lock);
+    if (!s_inited)
+    {
+        s_inited = true;
+        first = true;
+    }
+    portEXIT_CRITICAL(&s_init_lock);
+    if (!first)
+        return ESP_OK;
+
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(input_event_task, "input_event", 3072, NULL, 5, &task, 1) != pdPASS)
+    {
+        ESP_LOGE(TAG, "create task fail");
+        return ESP_FAIL;
+    }
+    s_dispatch_task = task;
+    //任务创建之前放入的事件
+    xTaskNotifyGive(task);
+    return ESP_OK;
+}
+
+/** 订阅事件
+ * @param src_mask 关心的来源，INPUT_SRC_MASK 的组合
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int input_event_subscribe(uint32_t src_mask, input_event_cb cb, void *arg)
+{
+    int id = -1;
+    if (!cb)
+        return -1;
+    portENTER_CRITICAL(&s_subscriber_lock);
+    for (int i = 0; i < INPUT_EVENT_MAX_SUBSCRIBER; i++)
+    {
+        if (!s_subscriber[i].cb)
+        {
+            s_subscriber[i].src_mask = src_mask;
+            s_subscriber[i].cb = cb;
+            s_subscriber[i].arg = arg;
+            id = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_subscriber_lock);
+    return id;
+}
+
+/** 取消订阅
+ * @param id input_event_subscribe 返回的订阅编号
+ * @return 无
+*/
+void input_event_unsubscribe(int id)
+{
+    if (id < 0 || id >= INPUT_EVENT_MAX_SUBSCRIBER)
+        return;
+    portENTER_CRITICAL(&s_subscriber_lock);
+    memset(&s_subscriber[id], 0, sizeof(input_subscriber_t));
+    portEXIT_CRITICAL(&s_subscriber_lock);
+}
+
+/** 获取统计信息
+ * @param stats 输出
+ * @return 无
+*/
+void input_event_get_stats(input_event_stats_t *stats)
+{
+    stats->posted = atomic_load(&s_posted);
+    stats->dropped = atomic_load(&s_dropped);
+    stats->dispatched = s_dispatched;
+    stats->max_depth = atomic_load(&s_max_depth);
+    stats->max_latency_us = s_max_latency_us;
+    stats->slow_handlers = s_slow_handlers;
+}
@@ -0,0 +1,112 @@
+#ifndef _INPUT_EVENT_H_
+#define _INPUT_EVENT_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * 输入事件管道：按键、触摸、PIR 等生产者把带时间戳的事件放进无锁环形缓存(中断里也可以放)，
+ * 一个分发任务按顺序把事件交给订阅者。订阅者的回调再慢也只影响分发任务，不会拖慢定时器和中断
+ */
+
+#define INPUT_EVENT_RING_LEN        32      //环形缓存长度，必须是2的幂
+#define INPUT_EVENT_MAX_SUBSCRIBER  6       //最多订阅者个数
+#define INPUT_EVENT_SLOW_US         10000   //回调执行超过这个时间记为慢回调
+
+//事件来源，订阅时用 INPUT_SRC_MASK 组合
+typedef enum
+{
+    INPUT_SRC_BUTTON,
+    INPUT_SRC_TOUCH,
+    INPUT_SRC_PIR,
+    INPUT_SRC_NUM,
+}input_src_t;
+
+#define INPUT_SRC_MASK(src)     (1u << (src))
+#define INPUT_SRC_ALL           ((1u << INPUT_SRC_NUM) - 1)
+
+//事件类型
+typedef enum
+{
+    INPUT_BTN_SHORT,        //短按，id为gpio号
+    INPUT_BTN_LONG,         //长按，id为gpio号
+    INPUT_BTN_DOUBLE,       //双击，id为gpio号
+    INPUT_BTN_MULTI,        //多击，id为gpio号，value为次数
+    INPUT_BTN_COMBO,        //组合键，id为组合键编号
+    INPUT_TOUCH_PRESS,      //触摸按下，x/y为坐标
+    INPUT_TOUCH_MOVE,       //触摸移动
+    INPUT_TOUCH_RELEASE,    //触摸松开
+    INPUT_PIR_OCCUPIED,     //有人
+    INPUT_PIR_RETRIGGER,    //有人期间再次触发，value为触发次数
+    INPUT_PIR_VACANT,       //无人
+}input_type_t;
+
+//事件，16字节
+typedef struct
+{
+    int64_t time_us;        //产生时刻(esp_timer_get_time)，input_event_post 时为0则自动填写
+    uint8_t source;         //input_src_t
+    uint8_t type;           //input_type_t
+    uint16_t id;            //来源内的编号
+    union
+    {
+        uint32_t value;
+        struct
+        {
+            int16_t x;
+            int16_t y;
+        };
+    };
+}input_event_t;
+
+//统计信息
+typedef struct
+{
+    uint32_t posted;        //成功放入的事件数
+    uint32_t dropped;       //缓存满丢弃的事件数
+    uint32_t dispatched;    //已分发的事件数
+    uint32_t max_depth;     //缓存中最多同时积压的事件数
+    uint32_t max_latency_us;//从产生到开始分发的最大延迟
+    uint32_t slow_handlers; //慢回调次数
+}input_event_stats_t;
+
+/** 事件回调函数，在分发任务中执行
+ * @param event 事件
+ * @param arg 用户参数
+ * @return 无
+*/
+typedef void (*input_event_cb)(const input_event_t *event, void *arg);
+
+/** 初始化并启动分发任务，可以重复调用
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t input_event_init(void);
+
+/** 放入一个事件，不阻塞，任务和中断中都可以调用
+ * @param event 事件
+ * @return true 成功，false 缓存已满(计入dropped)
+*/
+bool input_event_post(const input_event_t *event);
+
+/** 订阅事件
+ * @param src_mask 关心的来源，INPUT_SRC_MASK 的组合
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int input_event_subscribe(uint32_t src_mask, input_event_cb cb, void *arg);
+
+/** 取消订阅
+ * @param id input_event_subscribe 返回的订阅编号
+ * @return 无
+*/
+void input_event_unsubscribe(int id);
+
+/** 获取统计信息
+ * @param stats 输出
+ * @return 无
+*/
+void input_event_get_stats(input_event_stats_t *stats);
+
+#endif
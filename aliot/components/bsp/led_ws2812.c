@@ -12,6 +12,8 @@ static const char *TAG = "led_encoder";
 
 #define LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz 分辨率, 也就是1tick = 0.1us，也就是可以控制的最小时间单元，低于0.1us的脉冲无法产生
 
+#define WS2812_WAIT_MS          50      //修改缓存前等待上一帧发送完成的最长时间
+
 //WS2812驱动的描述符
 struct ws2812_strip_t
 {
@@ -227,25 +229,63 @@ esp_err_t ws2812_deinit(ws2812_strip_handle_t handle)
     return ESP_OK;
 }
 
-/** 向某个WS2812写入RGB数据
+/** 把缓存中的RGB数据一次发送给整条灯带
  * @param handle 句柄
- * @param index 第几个WS2812（0开始）
- * @param r,g,b RGB数据
  * @return ESP_OK or ESP_FAIL
 */
-esp_err_t ws2812_write(ws2812_strip_handle_t handle,uint32_t index,uint32_t r,uint32_t g,uint32_t b)
+esp_err_t ws2812_refresh(ws2812_strip_handle_t handle)
 {
-     rmt_transmit_config_t tx_config = {
+    rmt_transmit_config_t tx_config = {
         .loop_count = 0, //不循环发送
     };
+    return rmt_transmit(handle->led_chan, handle->led_encoder, handle->led_buffer, handle->led_num*3, &tx_config);
+}
+
+/** 修改某个WS2812的RGB数据，只写缓存，不发送，改完后调用ws2812_refresh一次发送
+ * @param handle 句柄
+ * @param index 第几个WS2812（0开始）
+ * @param r,g,b RGB数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_set(ws2812_strip_handle_t handle,uint32_t index,uint32_t r,uint32_t g,uint32_t b)
+{
     if(index >= handle->led_num)
         return ESP_FAIL;
+    //缓存可能还在发送上一帧
+    rmt_tx_wait_all_done(handle->led_chan, WS2812_WAIT_MS);
     uint32_t start = index*3;
     handle->led_buffer[start+0] = g & 0xff;     //注意，WS2812的数据顺序时GRB
     handle->led_buffer[start+1] = r & 0xff;
     handle->led_buffer[start+2] = b & 0xff;
+    return ESP_OK;
+}
 
-    return rmt_transmit(handle->led_chan, handle->led_encoder, handle->led_buffer, handle->led_num*3, &tx_config);
-    
+/** 所有WS2812设置成同一个颜色，只发送一次
+ * @param handle 句柄
+ * @param r,g,b RGB数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_fill(ws2812_strip_handle_t handle,uint32_t r,uint32_t g,uint32_t b)
+{
+    rmt_tx_wait_all_done(handle->led_chan, WS2812_WAIT_MS);
+    for(int i = 0;i < handle->led_num;i++)
+    {
+        handle->led_buffer[i*3+0] = g & 0xff;
+        handle->led_buffer[i*3+1] = r & 0xff;
+        handle->led_buffer[i*3+2] = b & 0xff;
+    }
+    return ws2812_refresh(handle);
 }
 
+/** 向某个WS2812写入RGB数据，每次调用都发送整条灯带，连续修改多个灯时用ws2812_set + ws2812_refresh
+ * @param handle 句柄
+ * @param index 第几个WS2812（0开始）
+ * @param r,g,b RGB数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_write(ws2812_strip_handle_t handle,uint32_t index,uint32_t r,uint32_t g,uint32_t b)
+{
+    if(ws2812_set(handle,index,r,g,b) != ESP_OK)
+        return ESP_FAIL;
+    return ws2812_refresh(handle);
+}
@@ -5,6 +5,7 @@
 #include "freertos/task.h"
 #include "nvs_flash.h"
 #include "dht11.h"
+#include "sensor_hub.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 
@@ -14,20 +15,55 @@
 
 #define TAG     "main"
 
-void mytask1(void* param)
+//DHT11的温度和湿度通道
+static int s_temp_chan = -1;
+static int s_humidity_chan = -1;
+
+/** DHT11采集完成回调，可能在RMT中断中执行，结果交给传感器中心
+ * @param result 1 成功，0 失败
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @param arg 无
+ * @return 是否唤醒了更高优先级的任务
+*/
+static bool dht11_done(int result, int temp_x10, int humidity, void *arg)
 {
-    int tempx10 = 0;
-    int humidity = 0;
-    while(1)
-    {
-        if(DHT11_StartGet(&tempx10,&humidity))
-        {
-            ESP_LOGI(TAG,"temperature:%.1f,humidity:%i%%",(float)tempx10/10.0,humidity);
-            ble_set_temp_value(tempx10&0xffff);
-            ble_set_humidity_value(humidity&0xffff);
-        }
-        vTaskDelay(pdMS_TO_TICKS(1500));
-    }
+    int32_t values[2] = {temp_x10,humidity};
+    return sensor_hub_complete(s_temp_chan,values,result ? ESP_OK : ESP_FAIL);
+}
+
+/** 传感器中心读取DHT11的函数，只启动采集，不等待
+ * @param values 无，结果由dht11_done交回
+ * @param arg 无
+ * @return ESP_ERR_NOT_FINISHED or ESP_FAIL
+*/
+static esp_err_t dht11_read(int32_t *values, void *arg)
+{
+    if(xDht11StartAsync(dht11_done,NULL) != ESP_OK)
+        return ESP_FAIL;
+    return ESP_ERR_NOT_FINISHED;
+}
+
+/** 温湿度变化的订阅回调，在传感器中心的任务中执行，更新BLE的温湿度特征值
+ * @param channel 变化的通道
+ * @param sample 采样值
+ * @param arg 无
+ * @return 无
+*/
+static void env_changed(int channel, const sensor_sample_t *sample, void *arg)
+{
+    //温湿度同时变化时会回调两次，同一次采样只处理一次
+    static int64_t last_time_us = -1;
+    sensor_sample_t temp,humidity;
+    if(sample->time_us == last_time_us)
+        return;
+    if(sensor_hub_latest(s_temp_chan,&temp) != ESP_OK || sensor_hub_latest(s_humidity_chan,&humidity) != ESP_OK)
+        return;
+    last_time_us = sample->time_us;
+
+    ESP_LOGI(TAG,"temperature:%.1f,humidity:%li%%",(float)temp.value/10.0,humidity.value);
+    ble_set_temp_value(temp.value&0xffff);
+    ble_set_humidity_value(humidity.value&0xffff);
 }
 
 void app_main(void)
@@ -45,7 +81,7 @@ void app_main(void)
     ble_cfg_net_init();
 
     //初始化DHT11
-    DHT11_Init(DHT11_GPIO);
+    vDht11Init(DHT11_GPIO);
 
     //初始化GPIO
     gpio_config_t led_cfg = 
@@ -58,6 +94,21 @@ void app_main(void)
     };
     gpio_config(&led_cfg);
 
-    //新建任务
-    xTaskCreatePinnedToCore(mytask1,"mytask",4096,NULL,3,NULL,1);
+    //传感器中心，DHT11每1.5秒采样一次，温湿度变化时更新BLE
+    sensor_desc_t dht11_desc =
+    {
+        .name = "dht11",
+        .period_ms = 1500,
+        .read = dht11_read,
+        .arg = NULL,
+        .chan_num = 2,
+        .chan = {
+            {.name = "temp", .deadband = 0},        //温度X10
+            {.name = "humidity", .deadband = 0},    //湿度
+        },
+    };
+    s_temp_chan = sensor_hub_add(&dht11_desc);
+    s_humidity_chan = s_temp_chan + 1;
+    sensor_hub_subscribe((1u << s_temp_chan) | (1u << s_humidity_chan),env_changed,NULL);
+    sensor_hub_start();
 }
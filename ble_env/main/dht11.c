@@ -1,165 +1,490 @@
+/*
+ * 已完成变量命名修改
+ * 已完成注释修改
+ * 已完成格式化
+ * 已完成中英文间距修改
+*/
+#include <stdlib.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <nvs_flash.h>
+#include <freertos/semphr.h>
 #include <driver/rmt_rx.h>
 #include <driver/rmt_tx.h>
 #include <soc/rmt_reg.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "esp_system.h"
-#include "esp32/rom/ets_sys.h"
+#include "dht11.h"
+#include "pulse_decoder.h"
+
+#define TAG "DHT11"
+
+#define DHT11_START_US 20000	 // DHT11 起始信号低电平时间，至少 18 ms
+#define DHT22_START_US 2000		 // DHT22 起始信号低电平时间，至少 1 ms
+#define DHT_TIMEOUT_US 50000	 // 释放总线后等待应答的超时时间，一帧数据约 5 ms
+#define DHT_BIT_NUM 40			 // 一帧数据 40 位
+#define DHT_SYMBOL_NUM 128		 // 接收缓存大小
+
+/*
+ * 采集过程（全程不占用 CPU）：
+	1、xDhtStartAsync 拉低总线，启动单次定时器后立即返回
+	2、定时器到期：启动 RMT 接收，释放总线，再把定时器作为超时定时器启动
+	3、RMT 接收完成中断：解析数据，调用用户回调
+	4、超时仍未收到数据：终止接收，以失败调用用户回调
+ * 每个传感器实例有自己的 RMT RX 通道、定时器和接收缓存，多个传感器可以同时采集
+ */
+typedef enum
+{
+	DHT_STATE_IDLE = 0, // 空闲
+	DHT_STATE_START,	// 正在发送起始信号
+	DHT_STATE_RECV,		// 等待应答数据
+} DhtState_t;
 
-#define TAG		"DHT11"
+/* 单传感器接口的回调和参数 */
+typedef struct
+{
+	Dht11DoneCallback_t pxCallback;
+	void *pvArg;
+} Dht11Ctx_t;
+
+/* 传感器实例 */
+struct Dht_t
+{
+	DhtType_t xType;							   // 传感器型号
+	uint8_t ucPin;								   // GPIO 引脚
+	rmt_channel_handle_t xRxChannelHandle;		   // RMT 接收通道句柄
+	esp_timer_handle_t xTimer;					   // 起始信号 / 超时定时器
+	DhtState_t xState;							   // 采集状态，由 xLock 保护
+	portMUX_TYPE xLock;							   // 状态锁
+	DhtDoneCallback_t pxCallback;				   // 用户回调
+	void *pvArg;								   // 用户参数
+	Dht11Ctx_t xDht11Ctx;						   // 单传感器接口的回调，由 xLock 保护
+	DhtStats_t xStats;							   // 累计统计，由 xLock 保护
+	rmt_symbol_word_t xRawSymbols[DHT_SYMBOL_NUM]; // 接收缓存
+};
 
-uint8_t DHT11_PIN = -1;
+/* 数据位解码配置：每位 50 us 低电平，高电平 26~28 us 为 0，70 us 为 1 */
+static const PulseDecConfig_t s_xDhtDecConfig = {
+	.usLowMin = 30,
+	.usLowMax = 70, // 应答信号的 80 us 低电平不在范围内，作为帧头同步
+	.usHighMin = 15,
+	.usHighMax = 95,
+	.usGlitchUs = 8,
+	.usThreshold = 40,
+	.usMinSpread = 20,
+	.ucBitNum = DHT_BIT_NUM,
+};
 
-//rmt接收通道句柄
-static rmt_channel_handle_t rx_chan_handle = NULL;
+/* 单传感器接口使用的默认实例 */
+static DhtHandle_t s_xDht11Default = NULL;
 
-//数据接收队列
-static QueueHandle_t rx_receive_queue = NULL;
+/* 阻塞接口 iDht11StartGet 使用 */
+static SemaphoreHandle_t xGetDoneSem = NULL;
+static int s_iGetResult, s_iGetTempX10, s_iGetHumidity;
 
-// 将RMT读取到的脉冲数据处理为温度和湿度
-static int parse_items(rmt_symbol_word_t *item, int item_num, int *humidity, int *temp_x10);
+/* 将 RMT 读取到的脉冲数据处理为温度和湿度 */
+static DhtErr_t prvParseItems(struct Dht_t *pxDht, const rmt_symbol_word_t *pxItem, int iItemNum, DhtReading_t *pxReading);
 
-//接收完成回调函数
-static bool IRAM_ATTR example_rmt_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_data)
+/** 结束本次采集，取出用户回调（只有第一个调用者能取到，用于仲裁接收完成和超时）
+ * @param pxDht 传感器实例
+ * @param ppvArg 返回的回调参数
+ * @return 用户回调，已经结束过则返回 NULL
+ */
+static DhtDoneCallback_t prvDhtFinish(struct Dht_t *pxDht, void **ppvArg)
 {
-    BaseType_t high_task_wakeup = pdFALSE;
-    QueueHandle_t rx_receive_queue = (QueueHandle_t)user_data;
-    // send the received RMT symbols to the parser task
-    xQueueSendFromISR(rx_receive_queue, edata, &high_task_wakeup);
-    return high_task_wakeup == pdTRUE;
+	DhtDoneCallback_t pxCallback = NULL;
+	portENTER_CRITICAL_SAFE(&pxDht->xLock);
+	if (pxDht->xState == DHT_STATE_RECV){
+		pxDht->xState = DHT_STATE_IDLE;
+		pxCallback = pxDht->pxCallback;
+		*ppvArg = pxDht->pvArg;
+	}
+	portEXIT_CRITICAL_SAFE(&pxDht->xLock);
+	return pxCallback;
 }
 
-/** DHT11初始化
- * @param dht11_pin GPIO引脚
- * @return 无
-*/
-void DHT11_Init(uint8_t dht11_pin)
-{
-	DHT11_PIN = dht11_pin;
-    
-    rmt_rx_channel_config_t rx_chan_config = {
-        .clk_src = RMT_CLK_SRC_APB,   // 选择时钟源
-        .resolution_hz = 1000 * 1000, 	  // 1 MHz 滴答分辨率，即 1 滴答 = 1 µs
-        .mem_block_symbols = 64,          // 内存块大小，即 64 * 4 = 256 字节
-        .gpio_num = dht11_pin,            // GPIO 编号
-        .flags.invert_in = false,         // 不反转输入信号
-        .flags.with_dma = false,          // 不需要 DMA 后端(ESP32S3才有)
-    };
-	//创建rmt接收通道
-	ESP_ERROR_CHECK(rmt_new_rx_channel(&rx_chan_config, &rx_chan_handle));
- 
-	//新建接收数据队列
-    rx_receive_queue = xQueueCreate(20, sizeof(rmt_rx_done_event_data_t));
-    assert(rx_receive_queue);
-
-	//注册接收完成回调函数
-	 ESP_LOGI(TAG, "register RX done callback");
-    rmt_rx_event_callbacks_t cbs = {
-        .on_recv_done = example_rmt_rx_done_callback,
-    };
-    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_chan_handle, &cbs, rx_receive_queue));
-
-	//使能RMT接收通道
-	ESP_ERROR_CHECK(rmt_enable(rx_chan_handle));
-}
-
-// 将RMT读取到的脉冲数据处理为温度和湿度(rmt_symbol_word_t称为RMT符号)
-static int parse_items(rmt_symbol_word_t *item, int item_num, int *humidity, int *temp_x10)
-{
-	int i = 0;
-	unsigned int rh = 0, temp = 0, checksum = 0;
-	if (item_num < 41){					// 检查是否有足够的脉冲数
-		//ESP_LOGI(TAG, "item_num < 41  %d",item_num);
-		return 0;
+/* 接收完成回调函数，直接在中断里解析（只有 40 多个符号）并通知用户 */
+static bool IRAM_ATTR prvExampleRmtRxDoneCallback(rmt_channel_handle_t xCannel, const rmt_rx_done_event_data_t *pxEventData, void *pvUserData)
+{
+	struct Dht_t *pxDht = (struct Dht_t *)pvUserData;
+	void *pvArg = NULL;
+	DhtDoneCallback_t pxCallback = prvDhtFinish(pxDht, &pvArg);
+	if (!pxCallback)
+		return false;
+	DhtReading_t xReading = {0};
+	xReading.xErr = prvParseItems(pxDht, pxEventData->received_symbols, pxEventData->num_symbols, &xReading);
+	xReading.iResult = xReading.xErr == DHT_OK;
+	return pxCallback(pxDht, &xReading, pvArg);
+}
+
+/* 定时器回调：起始信号结束时启动接收，接收超时时终止接收 */
+static void prvDhtTimerCallback(void *pvTimerArg)
+{
+	struct Dht_t *pxDht = (struct Dht_t *)pvTimerArg;
+	portENTER_CRITICAL(&pxDht->xLock);
+	DhtState_t xState = pxDht->xState;
+	if (xState == DHT_STATE_START)
+		pxDht->xState = DHT_STATE_RECV;
+	portEXIT_CRITICAL(&pxDht->xLock);
+
+	if (xState == DHT_STATE_START){
+		/* 启动RMT接收器以获取数据 */
+		rmt_receive_config_t xReceiveConfig = {
+			.signal_range_min_ns = 100,			// 最小脉冲宽度(0.1 us),信号长度小于这个值，视为干扰
+			.signal_range_max_ns = 1000 * 1000, // 最大脉冲宽度(1000 us)，信号长度大于这个值，视为结束信号
+		};
+		rmt_receive(pxDht->xRxChannelHandle, pxDht->xRawSymbols, sizeof(pxDht->xRawSymbols), &xReceiveConfig);
+		/* 释放总线，信号线设置为输入准备接收数据 */
+		gpio_set_direction(pxDht->ucPin, GPIO_MODE_INPUT);
+		gpio_set_pull_mode(pxDht->ucPin, GPIO_PULLUP_ONLY);
+		/* 定时器转为超时检测 */
+		esp_timer_start_once(pxDht->xTimer, DHT_TIMEOUT_US);
+	} else if (xState == DHT_STATE_RECV){
+		void *pvArg = NULL;
+		DhtDoneCallback_t pxCallback = prvDhtFinish(pxDht, &pvArg);
+		if (!pxCallback)
+			return; // 接收完成中断已经处理
+		/* 传感器无应答，重新使能通道以终止未完成的接收 */
+		rmt_disable(pxDht->xRxChannelHandle);
+		rmt_enable(pxDht->xRxChannelHandle);
+		DhtReading_t xReading = {.xErr = DHT_ERR_TIMEOUT};
+		portENTER_CRITICAL(&pxDht->xLock);
+		pxDht->xStats.ulCount[DHT_ERR_TIMEOUT]++;
+		portEXIT_CRITICAL(&pxDht->xLock);
+		pxCallback(pxDht, &xReading, pvArg);
 	}
-	if(item_num > 41)
-		item++;								// 跳过开始信号脉冲
-
-	for (i = 0; i < 16; i++, item++)	// 提取湿度数据
-	{
-		uint16_t duration = 0;
-		if(item->level0)
-			duration = item->duration0;
-		else
-			duration = item->duration1;
-		rh = (rh << 1) + (duration < 35 ? 0 : 1);
+}
+
+/** 创建一个传感器实例
+ * @param ucPin GPIO 引脚
+ * @param xType 传感器型号
+ * @param pxHandle 返回的传感器句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtCreate(uint8_t ucPin, DhtType_t xType, DhtHandle_t *pxHandle)
+{
+	esp_err_t ret = ESP_OK;
+	if (!pxHandle)
+		return ESP_ERR_INVALID_ARG;
+	struct Dht_t *pxDht = calloc(1, sizeof(struct Dht_t));
+	if (!pxDht)
+		return ESP_ERR_NO_MEM;
+	pxDht->xType = xType;
+	pxDht->ucPin = ucPin;
+	pxDht->xState = DHT_STATE_IDLE;
+	portMUX_INITIALIZE(&pxDht->xLock);
+
+	rmt_rx_channel_config_t xRxChannelConfig = {
+		.clk_src = RMT_CLK_SRC_APB,	  // 选择时钟源
+		.resolution_hz = 1000 * 1000, // 1 MHz 滴答分辨率，即 1 滴答 = 1 µs
+		.mem_block_symbols = 64,	  // 内存块大小，即 64 * 4 = 256 字节
+		.gpio_num = ucPin,			  // GPIO 编号
+		.flags.invert_in = false,	  // 不反转输入信号
+		.flags.with_dma = false,	  // 不需要 DMA 后端(ESP32S3才有)
+	};
+	/* 创建 rmt 接收通道，每个传感器一个 */
+	ret = rmt_new_rx_channel(&xRxChannelConfig, &pxDht->xRxChannelHandle);
+	if (ret != ESP_OK){
+		ESP_LOGE(TAG, "no free rmt rx channel for gpio %d", ucPin);
+		goto err;
 	}
 
+	/* 注册接收完成回调函数，用户数据为传感器实例 */
+	rmt_rx_event_callbacks_t xCallbackStruct = {
+		.on_recv_done = prvExampleRmtRxDoneCallback,
+	};
+	ret = rmt_rx_register_event_callbacks(pxDht->xRxChannelHandle, &xCallbackStruct, pxDht);
+	if (ret != ESP_OK)
+		goto err;
+
+	/* 使能 RMT 接收通道 */
+	ret = rmt_enable(pxDht->xRxChannelHandle);
+	if (ret != ESP_OK)
+		goto err;
 
-	for (i = 0; i < 16; i++, item++)	// 提取温度数据
-	{
-		uint16_t duration = 0;
-		if(item->level0)
-			duration = item->duration0;
-		else
-			duration = item->duration1;
-		temp = (temp << 1) + (duration < 35 ? 0 : 1);
+	/* 创建起始信号 / 超时定时器 */
+	esp_timer_create_args_t xTimerArgs = {
+		.callback = prvDhtTimerCallback,
+		.arg = pxDht,
+		.name = "dht",
+	};
+	ret = esp_timer_create(&xTimerArgs, &pxDht->xTimer);
+	if (ret != ESP_OK)
+		goto err;
+
+	*pxHandle = pxDht;
+	return ESP_OK;
+err:
+	if (pxDht->xRxChannelHandle){
+		rmt_disable(pxDht->xRxChannelHandle);
+		rmt_del_channel(pxDht->xRxChannelHandle);
 	}
-	
-	for (i = 0; i < 8; i++, item++){	// 提取校验数据
-	
-		uint16_t duration = 0;
-		if(item->level0)
-			duration = item->duration0;
-		else
-			duration = item->duration1;
-		checksum = (checksum << 1) + (duration < 35 ? 0 : 1);
+	free(pxDht);
+	return ret;
+}
+
+/** 删除传感器实例
+ * @param xHandle 传感器句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtDelete(DhtHandle_t xHandle)
+{
+	if (!xHandle)
+		return ESP_OK;
+	portENTER_CRITICAL(&xHandle->xLock);
+	DhtState_t xState = xHandle->xState;
+	portEXIT_CRITICAL(&xHandle->xLock);
+	if (xState != DHT_STATE_IDLE)
+		return ESP_ERR_INVALID_STATE;
+	esp_timer_stop(xHandle->xTimer);
+	esp_timer_delete(xHandle->xTimer);
+	rmt_disable(xHandle->xRxChannelHandle);
+	rmt_del_channel(xHandle->xRxChannelHandle);
+	free(xHandle);
+	return ESP_OK;
+}
+
+/** 读取传感器的累计统计
+ * @param xHandle 传感器句柄
+ * @param pxStats 返回的统计数据
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtGetStats(DhtHandle_t xHandle, DhtStats_t *pxStats)
+{
+	if (!xHandle || !pxStats)
+		return ESP_ERR_INVALID_ARG;
+	portENTER_CRITICAL(&xHandle->xLock);
+	*pxStats = xHandle->xStats;
+	portEXIT_CRITICAL(&xHandle->xLock);
+	return ESP_OK;
+}
+
+/* 将 40 位数据转换为温度和湿度，DHT11 和 DHT22 时序相同，只有数据格式不同 */
+static DhtErr_t prvConvert(DhtType_t xType, const uint8_t *pucData, DhtReading_t *pxReading)
+{
+	/* 检查校验，两种型号都是前 4 个字节之和 */
+	if (((pucData[0] + pucData[1] + pucData[2] + pucData[3]) & 0xFF) != pucData[4])
+		return DHT_ERR_CHECKSUM;
+	int iHumidityX10, iTempX10;
+	if (xType == DHT_TYPE_DHT22){
+		/* DHT22：湿度为 16 位的 X10 值；温度最高位为符号位，其余 15 位为 X10 值 */
+		iHumidityX10 = (pucData[0] << 8) | pucData[1];
+		iTempX10 = ((pucData[2] & 0x7F) << 8) | pucData[3];
+		if (pucData[2] & 0x80)
+			iTempX10 = -iTempX10;
+		/* 判断数据合法性 */
+		if (iHumidityX10 > 1000 || iTempX10 < -400 || iTempX10 > 800)
+			return DHT_ERR_RANGE;
+	} else {
+		/* DHT11：高字节为整数部分，低字节为小数部分，湿度只有整数 */
+		iHumidityX10 = pucData[0] * 10;
+		iTempX10 = pucData[2] * 10 + pucData[3];
+		/* 判断数据合法性 */
+		if (iHumidityX10 > 1000 || iTempX10 > 600)
+			return DHT_ERR_RANGE;
 	}
-	// 检查校验
-	if ((((temp >> 8) + temp + (rh >> 8) + rh) & 0xFF) != checksum){
-		ESP_LOGI(TAG, "Checksum failure %4X %4X %2X\n", temp, rh, checksum);
-		return 0;
+	pxReading->iHumidityX10 = iHumidityX10;
+	pxReading->iTempX10 = iTempX10;
+	return DHT_OK;
+}
+
+/* 将RMT读取到的脉冲数据处理为温度和湿度 (rmt_symbol_word_t 称为 RMT 符号)
+ * 脉冲由 xPulseDecode 解码为 40 位数据，解码和转换的结果都记入统计
+ * 该函数在中断中调用，不能打印日志
+ */
+static DhtErr_t prvParseItems(struct Dht_t *pxDht, const rmt_symbol_word_t *pxItem, int iItemNum, DhtReading_t *pxReading)
+{
+	uint8_t ucData[DHT_BIT_NUM / 8];
+	PulseDecInfo_t xInfo;
+	DhtErr_t xErr;
+	switch (xPulseDecode(&s_xDhtDecConfig, pxItem, iItemNum, ucData, &xInfo)){
+	case PULSE_DEC_OK:
+		xErr = prvConvert(pxDht->xType, ucData, pxReading);
+		break;
+	case PULSE_DEC_ERR_NO_DATA:
+		xErr = DHT_ERR_NO_DATA;
+		break;
+	default:
+		xErr = DHT_ERR_BITS;
+		break;
 	}
-	// 返回数据
-	
-	rh = rh >> 8;
-	temp = (temp >> 8) * 10 + (temp & 0xFF);
-
-	//判断数据合法性
-	if(rh <= 100)
-		*humidity = rh;
-	if(temp <= 600)
-		*temp_x10 = temp;
-	return 1;
+	portENTER_CRITICAL_SAFE(&pxDht->xLock);
+	pxDht->xStats.ulCount[xErr]++;
+	pxDht->xStats.ulGlitch += xInfo.usGlitch;
+	pxDht->xStats.ulResync += xInfo.usResync;
+	pxDht->xStats.ulExtraBits += xInfo.usExtraBits;
+	portEXIT_CRITICAL_SAFE(&pxDht->xLock);
+	return xErr;
 }
 
+/** 发送起始信号，调用前实例已经由调用者置为 DHT_STATE_START
+ * @param pxDht 传感器实例
+ * @return ESP_OK or 定时器启动失败的原因（此时实例恢复空闲）
+ */
+static esp_err_t prvDhtSendStart(struct Dht_t *pxDht)
+{
+	/* 取消上一次采集残留的超时定时 */
+	esp_timer_stop(pxDht->xTimer);
+	/* 拉低总线作为起始信号，由定时器计时，不再阻塞 CPU */
+	gpio_set_direction(pxDht->ucPin, GPIO_MODE_OUTPUT);
+	gpio_set_level(pxDht->ucPin, 0);
+	esp_err_t ret = esp_timer_start_once(pxDht->xTimer, pxDht->xType == DHT_TYPE_DHT22 ? DHT22_START_US : DHT11_START_US);
+	if (ret != ESP_OK){
+		gpio_set_direction(pxDht->ucPin, GPIO_MODE_INPUT);
+		portENTER_CRITICAL(&pxDht->xLock);
+		pxDht->xState = DHT_STATE_IDLE;
+		portEXIT_CRITICAL(&pxDht->xLock);
+	}
+	return ret;
+}
+
+/** 异步启动一次采集
+ * @param xHandle 传感器句柄
+ * @param pxCallback 采集完成回调
+ * @param pvArg 回调的用户参数
+ * @return ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t xDhtStartAsync(DhtHandle_t xHandle, DhtDoneCallback_t pxCallback, void *pvArg)
+{
+	if (!xHandle || !pxCallback)
+		return ESP_ERR_INVALID_ARG;
+	/* 检查和占用在同一个临界区内完成，并发启动时只有一个能成功 */
+	portENTER_CRITICAL(&xHandle->xLock);
+	if (xHandle->xState != DHT_STATE_IDLE){
+		portEXIT_CRITICAL(&xHandle->xLock);
+		return ESP_ERR_INVALID_STATE;
+	}
+	xHandle->xState = DHT_STATE_START;
+	xHandle->pxCallback = pxCallback;
+	xHandle->pvArg = pvArg;
+	portEXIT_CRITICAL(&xHandle->xLock);
+	return prvDhtSendStart(xHandle);
+}
+
+/* 扫描时每个传感器的结果位置 */
+typedef struct
+{
+	TaskHandle_t xTask;		// 等待结果的任务
+	DhtReading_t *pxResult; // 结果存放位置
+} DhtScanSlot_t;
 
-/** 获取DHT11数据
- * @param temp_x10 温度值
+/* 扫描的完成回调，可能在中断或定时器任务中执行 */
+static bool prvDhtScanDone(DhtHandle_t xHandle, const DhtReading_t *pxReading, void *pvArg)
+{
+	DhtScanSlot_t *pxSlot = (DhtScanSlot_t *)pvArg;
+	BaseType_t xHighTaskWakeup = pdFALSE;
+	*pxSlot->pxResult = *pxReading;
+	if (xPortInIsrContext())
+		vTaskNotifyGiveFromISR(pxSlot->xTask, &xHighTaskWakeup);
+	else
+		xTaskNotifyGive(pxSlot->xTask);
+	return xHighTaskWakeup == pdTRUE;
+}
+
+/** 同时触发多个传感器并等待全部完成
+ * @param pxHandles 传感器句柄数组
+ * @param iNum 传感器个数
+ * @param pxResults 返回的采集结果
+ * @return 采集成功的传感器个数
+ */
+int iDhtScan(const DhtHandle_t *pxHandles, int iNum, DhtReading_t *pxResults)
+{
+	DhtScanSlot_t xSlots[DHT_MAX_SENSOR];
+	int iStarted = 0, iOk = 0;
+	if (iNum > DHT_MAX_SENSOR)
+		iNum = DHT_MAX_SENSOR;
+
+	/* 启动只需要几微秒，各传感器的起始信号和应答几乎同时进行 */
+	for (int i = 0; i < iNum; i++){
+		xSlots[i].xTask = xTaskGetCurrentTaskHandle();
+		xSlots[i].pxResult = &pxResults[i];
+		pxResults[i].iResult = 0;
+		if (xDhtStartAsync(pxHandles[i], prvDhtScanDone, &xSlots[i]) == ESP_OK)
+			iStarted++;
+	}
+	/* 每个已启动的传感器都保证回调一次（成功、失败或超时），等齐后 xSlots 才能释放 */
+	for (int i = 0; i < iStarted; i++)
+		ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+	for (int i = 0; i < iNum; i++)
+		iOk += pxResults[i].iResult;
+	return iOk;
+}
+
+/* 单传感器接口的回调适配，pvArg 为实例中保存的单传感器回调 */
+static bool prvDht11Adapter(DhtHandle_t xHandle, const DhtReading_t *pxReading, void *pvArg)
+{
+	const Dht11Ctx_t *pxCtx = (const Dht11Ctx_t *)pvArg;
+	return pxCtx->pxCallback(pxReading->iResult, pxReading->iTempX10, pxReading->iHumidityX10 / 10, pxCtx->pvArg);
+}
+
+/** DHT11 初始化
+ * @param xDht11Pin GPIO 引脚
  * @return 无
-*/
-int DHT11_StartGet(int *temp_x10, int *humidity)
-{
-	//发送20ms开始信号脉冲启动DHT11单总线
-	gpio_set_direction(DHT11_PIN, GPIO_MODE_OUTPUT);
-	gpio_set_level(DHT11_PIN, 1);
-	ets_delay_us(1000);
-	gpio_set_level(DHT11_PIN, 0);
-	ets_delay_us(20000);
-	//拉高20us
-	gpio_set_level(DHT11_PIN, 1);
-	ets_delay_us(20);
-	//信号线设置为输入准备接收数据
-	gpio_set_direction(DHT11_PIN, GPIO_MODE_INPUT);
-	gpio_set_pull_mode(DHT11_PIN,GPIO_PULLUP_ONLY);
-
-	//启动RMT接收器以获取数据
-	rmt_receive_config_t receive_config = {
-        .signal_range_min_ns = 100,     //最小脉冲宽度(0.1us),信号长度小于这个值，视为干扰
-        .signal_range_max_ns = 1000*1000, 	//最大脉冲宽度(1000us)，信号长度大于这个值，视为结束信号
-    };
-	
-	static rmt_symbol_word_t raw_symbols[128];	//接收缓存
-    static rmt_rx_done_event_data_t rx_data;	//实际接收到的数据
-	ESP_ERROR_CHECK(rmt_receive(rx_chan_handle, raw_symbols, sizeof(raw_symbols), &receive_config));
-
-	// wait for RX done signal
-	if (xQueueReceive(rx_receive_queue, &rx_data, pdMS_TO_TICKS(1000)) == pdTRUE) {
-		// parse the receive symbols and print the result
-		return parse_items(rx_data.received_symbols, rx_data.num_symbols,humidity, temp_x10);
+ */
+void vDht11Init(uint8_t xDht11Pin)
+{
+	ESP_ERROR_CHECK(xDhtCreate(xDht11Pin, DHT_TYPE_DHT11, &s_xDht11Default));
+
+	xGetDoneSem = xSemaphoreCreateBinary();
+	assert(xGetDoneSem);
+}
+
+/** 异步启动一次 DHT11 采集
+ * @param pxCallback 采集完成回调
+ * @param pvArg 回调的用户参数
+ * @return ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t xDht11StartAsync(Dht11DoneCallback_t pxCallback, void *pvArg)
+{
+	struct Dht_t *pxDht = s_xDht11Default;
+	if (!pxCallback || !pxDht)
+		return ESP_ERR_INVALID_ARG;
+	/* 上一次采集未结束时不能覆盖回调，检查、占用和保存回调在同一个临界区内完成 */
+	portENTER_CRITICAL(&pxDht->xLock);
+	if (pxDht->xState != DHT_STATE_IDLE){
+		portEXIT_CRITICAL(&pxDht->xLock);
+		return ESP_ERR_INVALID_STATE;
 	}
-    return 0;
-}
\ No newline at end of file
+	pxDht->xState = DHT_STATE_START;
+	pxDht->xDht11Ctx.pxCallback = pxCallback;
+	pxDht->xDht11Ctx.pvArg = pvArg;
+	pxDht->pxCallback = prvDht11Adapter;
+	pxDht->pvArg = &pxDht->xDht11Ctx;
+	portEXIT_CRITICAL(&pxDht->xLock);
+	return prvDhtSendStart(pxDht);
+}
+
+/* 阻塞接口的完成回调，可能在中断或定时器任务中执行 */
+static bool prvDht11GetDone(int iResult, int iTempX10, int iHumidity, void *pvArg)
+{
+	BaseType_t xHighTaskWakeup = pdFALSE;
+	s_iGetResult = iResult;
+	s_iGetTempX10 = iTempX10;
+	s_iGetHumidity = iHumidity;
+	if (xPortInIsrContext())
+		xSemaphoreGiveFromISR(xGetDoneSem, &xHighTaskWakeup);
+	else
+		xSemaphoreGive(xGetDoneSem);
+	return xHighTaskWakeup == pdTRUE;
+}
+
+/** 获取 DHT11 数据
+ * @param piTempX10 温度值
+ * @param piHumidity 湿度值
+ * @return 1 成功，0 失败
+ */
+int iDht11StartGet(int *piTempX10, int *piHumidity)
+{
+	if (xDht11StartAsync(prvDht11GetDone, NULL) != ESP_OK)
+		return 0;
+	/* 等待期间任务休眠，CPU 可以运行其他任务 */
+	if (xSemaphoreTake(xGetDoneSem, pdMS_TO_TICKS(1000)) != pdTRUE)
+		return 0;
+	if (!s_iGetResult)
+		return 0;
+	*piTempX10 = s_iGetTempX10;
+	*piHumidity = s_iGetHumidity;
+	return 1;
+}
@@ -1,18 +1,135 @@
 #ifndef _DHT11_H_
 #define _DHT11_H_
+
 #include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
 
-/** DHT11初始化
- * @param dht11_pin GPIO引脚
- * @return 无
-*/
-void DHT11_Init(uint8_t dht11_pin);
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DHT_MAX_SENSOR 8 // 一次扫描最多的传感器个数，实际受芯片 RMT RX 通道数限制
+
+/* 传感器型号 */
+typedef enum
+{
+    DHT_TYPE_DHT11 = 0, // DHT11：整数湿度，0~50 ℃
+    DHT_TYPE_DHT22,     // DHT22 / AM2302：0.1 精度湿度，-40~80 ℃
+} DhtType_t;
+
+/* 采集失败原因 */
+typedef enum
+{
+    DHT_OK = 0,         // 成功
+    DHT_ERR_TIMEOUT,    // 传感器无应答
+    DHT_ERR_NO_DATA,    // 收到的脉冲中没有有效数据位
+    DHT_ERR_BITS,       // 有效数据位不足 40 位（帧被截断或干扰太多）
+    DHT_ERR_CHECKSUM,   // 校验错误
+    DHT_ERR_RANGE,      // 数据超出传感器量程
+    DHT_ERR_NUM,
+} DhtErr_t;
+
+/* 一次采集的结果 */
+typedef struct
+{
+    int iResult;      // 1 成功，0 失败
+    DhtErr_t xErr;    // 失败原因
+    int iTempX10;     // 温度值X10，可能为负
+    int iHumidityX10; // 湿度值X10
+} DhtReading_t;
+
+/* 传感器累计统计 */
+typedef struct
+{
+    uint32_t ulCount[DHT_ERR_NUM]; // 各结果的次数，下标为 DhtErr_t
+    uint32_t ulGlitch;             // 解码时滤除的毛刺总数
+    uint32_t ulResync;             // 解码时重新同步的总次数
+    uint32_t ulExtraBits;          // 有效数据之前多出的位数总和
+} DhtStats_t;
+
+typedef struct Dht_t *DhtHandle_t;
+
+/** 传感器采集完成回调
+ * 注意：回调可能在 RMT 中断中执行，只能做 FromISR 类的轻量操作（记录数据、通知任务等）
+ * @param xHandle 传感器句柄
+ * @param pxReading 采集结果
+ * @param pvArg 用户参数
+ * @return 是否唤醒了更高优先级的任务（在中断中调用时用于决定是否切换任务）
+ */
+typedef bool (*DhtDoneCallback_t)(DhtHandle_t xHandle, const DhtReading_t *pxReading, void *pvArg);
 
-/** 获取DHT11数据
- * @param temp_x10 温度值X10
- * @param humidity 湿度值
+/** DHT11 采集完成回调（单传感器接口使用）
+ * 注意：回调可能在 RMT 中断中执行，只能做 FromISR 类的轻量操作（记录数据、通知任务等）
+ * @param iResult 1 成功，0 失败（无应答、脉冲数不足或校验错误）
+ * @param iTempX10 温度值X10，失败时无意义
+ * @param iHumidity 湿度值，失败时无意义
+ * @param pvArg 用户参数
+ * @return 是否唤醒了更高优先级的任务（在中断中调用时用于决定是否切换任务）
+ */
+typedef bool (*Dht11DoneCallback_t)(int iResult, int iTempX10, int iHumidity, void *pvArg);
+
+/** 创建一个传感器实例，每个实例独占一个 RMT RX 通道和一个定时器
+ * @param ucPin GPIO引脚
+ * @param xType 传感器型号
+ * @param pxHandle 返回的传感器句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtCreate(uint8_t ucPin, DhtType_t xType, DhtHandle_t *pxHandle);
+
+/** 删除传感器实例，调用前应保证没有正在进行的采集
+ * @param xHandle 传感器句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtDelete(DhtHandle_t xHandle);
+
+/** 异步启动一次采集，立即返回
+ * 起始信号由单次定时器计时，应答由 RMT 接收，整个过程不占用 CPU，结束后调用 pxCallback
+ * @param xHandle 传感器句柄
+ * @param pxCallback 采集完成回调
+ * @param pvArg 回调的用户参数
+ * @return ESP_OK 已启动，ESP_ERR_INVALID_STATE 上一次采集尚未结束
+ */
+esp_err_t xDhtStartAsync(DhtHandle_t xHandle, DhtDoneCallback_t pxCallback, void *pvArg);
+
+/** 读取传感器的累计统计
+ * @param xHandle 传感器句柄
+ * @param pxStats 返回的统计数据
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xDhtGetStats(DhtHandle_t xHandle, DhtStats_t *pxStats);
+
+/** 同时触发多个传感器并等待全部完成，总耗时约等于单个传感器的采集时间
+ * 使用调用者任务的任务通知等待，等待期间任务休眠
+ * @param pxHandles 传感器句柄数组
+ * @param iNum 传感器个数，不超过 DHT_MAX_SENSOR
+ * @param pxResults 返回的采集结果，与 pxHandles 一一对应
+ * @return 采集成功的传感器个数
+ */
+int iDhtScan(const DhtHandle_t *pxHandles, int iNum, DhtReading_t *pxResults);
+
+/** DHT11初始化（单传感器接口，内部创建一个默认实例）
+ * @param xDht11Pin GPIO引脚
  * @return 无
-*/
-int DHT11_StartGet(int *temp_x10, int *humidity);
+ */
+void vDht11Init(uint8_t xDht11Pin);
+
+/** 异步启动一次 DHT11 采集，立即返回
+ * @param pxCallback 采集完成回调
+ * @param pvArg 回调的用户参数
+ * @return ESP_OK 已启动，ESP_ERR_INVALID_STATE 上一次采集尚未结束
+ */
+esp_err_t xDht11StartAsync(Dht11DoneCallback_t pxCallback, void *pvArg);
+
+/** 获取DHT11数据（阻塞等待结果，但等待期间调用者任务休眠，不占用 CPU）
+ * @param piTempX10 温度值X10
+ * @param piHumidity 湿度值
+ * @return 1 成功，0 失败
+ */
+int iDht11StartGet(int *piTempX10, int *piHumidity);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -1,8 +1,11 @@
 #include "button.h"
+#include "input_event.h"
 
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
 #include <stdio.h>
 #include <string.h>
 static const char* TAG = "button";
@@ -10,9 +13,10 @@ static const char* TAG = "button";
 typedef enum
 {
     BUTTON_RELEASE,             //按键没有按下
-    BUTTON_PRESS,               //按键按下了，等待一点延时（消抖），然后触发短按回调事件，进入BUTTON_HOLD
+    BUTTON_PRESS,               //按键按下了，等待一点延时（消抖），没有连击回调时触发短按回调事件，进入BUTTON_HOLD
     BUTTON_HOLD,                //按住状态，如果时间长度超过设定的超时计数，将触发长按回调函数，进入BUTTON_LONG_PRESS_HOLD
     BUTTON_LONG_PRESS_HOLD,     //此状态等待电平消失，回到BUTTON_RELEASE状态
+    BUTTON_WAIT_CLICK,          //短按松开了，等待连击间隔，期间再次按下进入BUTTON_PRESS，超时后触发单击/双击/多击回调，回到BUTTON_RELEASE
 }BUTTON_STATE;
 
 typedef struct Button
@@ -20,32 +24,114 @@ typedef struct Button
     button_config_t btn_cfg;    //按键配置
     BUTTON_STATE    state;      //当前状态
     int press_cnt;              //按下计数
+    int release_cnt;            //松开计数，用于连击间隔
+    int click_cnt;              //连击次数
+    bool in_combo;              //已经作为组合键触发，松开前不再触发长按和连击
     struct Button* next;        //下一个按键参数
 }button_dev_t;
 
+//组合键
+typedef struct Combo
+{
+    button_dev_t* btn[BUTTON_COMBO_MAX];    //组合中的按键
+    int num;                    //按键个数
+    button_press_cb cb;         //回调函数
+    bool fired;                 //已经触发，等待任一按键松开
+    int id;                     //编号，事件中用来找到组合键
+    struct Combo* next;
+}button_combo_t;
+
 //按键处理列表
 static button_dev_t *s_button_head = NULL;
 
+//组合键列表
+static button_combo_t *s_combo_head = NULL;
+
 //消抖过滤时间
 #define FILITER_TIMER   20
 
-//定时器释放运行标志
-static bool g_is_timer_running = false;
+//默认连击间隔
+#define CLICK_INTERVAL  300
+
+//扫描周期
+#define SCAN_INTERVAL   5
+
+//定时器释放运行标志，没有按键活动时定时器停止，由gpio中断重新启动
+static volatile bool g_is_timer_running = false;
+static portMUX_TYPE s_timer_lock = portMUX_INITIALIZER_UNLOCKED;
 
 //定时器句柄
-static esp_timer_handle_t g_button_timer_handle;
+static esp_timer_handle_t g_button_timer_handle = NULL;
 
 static void button_handle(void *param);
+static void button_event_handle(const input_event_t *event, void *arg);
+
+/** 启动扫描定时器，可以在中断中调用
+ * @param 无
+ * @return 无
+*/
+static void IRAM_ATTR button_timer_arm(void)
+{
+    bool start = false;
+    portENTER_CRITICAL_SAFE(&s_timer_lock);
+    if (!g_is_timer_running) {
+        g_is_timer_running = true;
+        start = true;
+    }
+    portEXIT_CRITICAL_SAFE(&s_timer_lock);
+    if (start)
+        esp_timer_start_periodic(g_button_timer_handle, SCAN_INTERVAL * 1000);
+}
+
+/** 按键按下的边沿中断，只负责启动扫描定时器
+ * @param arg 无
+ * @return 无
+*/
+static void IRAM_ATTR button_isr_handler(void *arg)
+{
+    button_timer_arm();
+}
+
+/** 查找按键
+ * @param gpio_num gpio号
+ * @return 按键，没有找到返回NULL
+*/
+static button_dev_t* button_find(int gpio_num)
+{
+    button_dev_t* btn_p = s_button_head;
+    for (; btn_p; btn_p = btn_p->next)
+    {
+        if (btn_p->btn_cfg.gpio_num == gpio_num)
+            return btn_p;
+    }
+    return NULL;
+}
 
 /** 设置按键事件
  * @param cfg   配置结构体
- * @return ESP_OK or ESP_FAIL 
+ * @return ESP_OK or ESP_FAIL
 */
 esp_err_t button_event_set(button_config_t *cfg)
 {
-    gpio_config_t gpio_t = 
+    if (!g_button_timer_handle) {
+        //回调不在定时器任务中执行，由输入事件的分发任务调用
+        if (input_event_init() != ESP_OK)
+            return ESP_FAIL;
+        input_event_subscribe(INPUT_SRC_MASK(INPUT_SRC_BUTTON), button_event_handle, NULL);
+        esp_timer_create_args_t button_timer;
+        button_timer.arg = (void*)SCAN_INTERVAL;
+        button_timer.callback = button_handle;
+        button_timer.dispatch_method = ESP_TIMER_TASK;
+        button_timer.name = "button_handle";
+        button_timer.skip_unhandled_events = true;
+        if (esp_timer_create(&button_timer, &g_button_timer_handle) != ESP_OK)
+            return ESP_FAIL;
+    }
+
+    //只在按下的边沿产生中断
+    gpio_config_t gpio_t =
     {
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = cfg->active_level ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE,
         .mode = GPIO_MODE_INPUT,
         .pin_bit_mask = (1ull<<cfg->gpio_num),
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
@@ -56,6 +142,9 @@ esp_err_t button_event_set(button_config_t *cfg)
     if(!btn)
         return ESP_FAIL;
     memset(btn,0,sizeof(button_dev_t));
+    memcpy(&btn->btn_cfg,cfg,sizeof(button_config_t));
+    if (btn->btn_cfg.click_interval <= 0)
+        btn->btn_cfg.click_interval = CLICK_INTERVAL;
     if(!s_button_head)
     {
         s_button_head = btn;
@@ -69,88 +158,318 @@ esp_err_t button_event_set(button_config_t *cfg)
         btn_p->next = btn;
         ESP_LOGI(TAG,"btn add");
     }
-    memcpy(&btn->btn_cfg,cfg,sizeof(button_config_t));
 
-    if (false == g_is_timer_running) {
-        ESP_LOGI(TAG,"run button timer");
-        static int timer_interval = 5;
-        esp_timer_create_args_t button_timer;
-        button_timer.arg = (void*)timer_interval;
-        button_timer.callback = button_handle;
-        button_timer.dispatch_method = ESP_TIMER_TASK;
-        button_timer.name = "button_handle";
-        esp_timer_create(&button_timer, &g_button_timer_handle);
-        esp_timer_start_periodic(g_button_timer_handle,  5000);
-        g_is_timer_running = true;
-    }
+    //中断服务可能已经被其他模块安装过
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+        return ESP_FAIL;
+    ESP_ERROR_CHECK(gpio_isr_handler_add(cfg->gpio_num, button_isr_handler, NULL));
 
+    //添加时按键可能已经按下
+    if (gpio_get_level(cfg->gpio_num) == cfg->active_level)
+        button_timer_arm();
 
     return ESP_OK;
 }
 
-/** 定时器回调函数，本例中是5ms执行一次
+/** 设置组合键事件，所有按键同时按住时触发一次，组合键中的按键不再触发各自的长按和连击
+ * @param gpio_nums 组合键的gpio号，这些按键需要先通过button_event_set添加
+ * @param num       按键个数，2~BUTTON_COMBO_MAX
+ * @param cb        回调函数
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t button_combo_set(const int *gpio_nums, int num, button_press_cb cb)
+{
+    if (num < 2 || num > BUTTON_COMBO_MAX || !cb)
+        return ESP_FAIL;
+    button_combo_t* combo = (button_combo_t*)malloc(sizeof(button_combo_t));
+    if (!combo)
+        return ESP_FAIL;
+    memset(combo,0,sizeof(button_combo_t));
+    for (int i = 0; i < num; i++)
+    {
+        combo->btn[i] = button_find(gpio_nums[i]);
+        if (!combo->btn[i])
+        {
+            ESP_LOGE(TAG,"gpio %d not added",gpio_nums[i]);
+            free(combo);
+            return ESP_FAIL;
+        }
+    }
+    combo->num = num;
+    combo->cb = cb;
+    combo->id = s_combo_head ? s_combo_head->id + 1 : 0;
+    //组合键在定时器任务中遍历，先填好再挂到表头
+    combo->next = s_combo_head;
+    s_combo_head = combo;
+    ESP_LOGI(TAG,"combo add");
+    return ESP_OK;
+}
+
+/** 放入一个按键事件，回调由分发任务执行，不会阻塞扫描定时器
+ * @param type 事件类型
+ * @param id gpio号或组合键编号
+ * @param value 附加值
+ * @return 无
+*/
+static void button_post(input_type_t type, int id, uint32_t value)
+{
+    input_event_t event =
+    {
+        .time_us = esp_timer_get_time(),
+        .source = INPUT_SRC_BUTTON,
+        .type = type,
+        .id = id,
+        .value = value,
+    };
+    if (!input_event_post(&event))
+        ESP_LOGW(TAG,"event queue full");
+}
+
+/** 按键事件回调，在分发任务中执行，调用按键配置里的回调函数
+ * @param event 事件
+ * @param arg 无
+ * @return 无
+*/
+static void button_event_handle(const input_event_t *event, void *arg)
+{
+    if (event->type == INPUT_BTN_COMBO)
+    {
+        button_combo_t* combo = s_combo_head;
+        for (; combo; combo = combo->next)
+        {
+            if (combo->id == event->id)
+            {
+                combo->cb();
+                break;
+            }
+        }
+        return;
+    }
+    button_dev_t* btn = button_find(event->id);
+    if (!btn)
+        return;
+    switch (event->type)
+    {
+    case INPUT_BTN_SHORT:
+        if (btn->btn_cfg.short_cb)
+            btn->btn_cfg.short_cb();
+        break;
+    case INPUT_BTN_LONG:
+        if (btn->btn_cfg.long_cb)
+            btn->btn_cfg.long_cb();
+        break;
+    case INPUT_BTN_DOUBLE:
+        if (btn->btn_cfg.double_cb)
+            btn->btn_cfg.double_cb();
+        break;
+    case INPUT_BTN_MULTI:
+        if (btn->btn_cfg.multi_cb)
+            btn->btn_cfg.multi_cb(event->value);
+        break;
+    default:
+        break;
+    }
+}
+
+/** 按键回到初始状态
+ * @param btn 按键
+ * @return 无
+*/
+static void button_reset(button_dev_t* btn)
+{
+    btn->state = BUTTON_RELEASE;
+    btn->press_cnt = 0;
+    btn->release_cnt = 0;
+    btn->click_cnt = 0;
+    btn->in_combo = false;
+}
+
+/** 是否需要检测连击，需要时短按要等连击间隔结束才能确定
+ * @param btn 按键
+ * @return true 配置了双击或多击回调
+*/
+static bool button_has_click_cb(const button_dev_t* btn)
+{
+    return btn->btn_cfg.double_cb || btn->btn_cfg.multi_cb;
+}
+
+/** 短按松开后，需要检测连击就进入等待，否则直接回到初始状态
+ * @param btn 按键
+ * @return 无
+*/
+static void button_click_release(button_dev_t* btn)
+{
+    if (btn->in_combo || !button_has_click_cb(btn))
+    {
+        button_reset(btn);
+        return;
+    }
+    btn->click_cnt++;
+    btn->press_cnt = 0;
+    btn->release_cnt = 0;
+    btn->state = BUTTON_WAIT_CLICK;
+}
+
+/** 检测组合键
+ * @param 无
+ * @return 无
+*/
+static void button_combo_handle(void)
+{
+    button_combo_t* combo = s_combo_head;
+    for (; combo; combo = combo->next)
+    {
+        bool all_hold = true;
+        for (int i = 0; i < combo->num; i++)
+        {
+            BUTTON_STATE state = combo->btn[i]->state;
+            if (state != BUTTON_HOLD && state != BUTTON_LONG_PRESS_HOLD)
+            {
+                all_hold = false;
+                break;
+            }
+        }
+        if (!all_hold)
+        {
+            combo->fired = false;
+            continue;
+        }
+        if (!combo->fired)
+        {
+            ESP_LOGI(TAG,"combo press detect");
+            combo->fired = true;
+            for (int i = 0; i < combo->num; i++)
+                combo->btn[i]->in_combo = true;
+            button_post(INPUT_BTN_COMBO, combo->id, 0);
+        }
+    }
+}
+
+/** 定时器回调函数，本例中是5ms执行一次，所有按键都回到BUTTON_RELEASE后停止定时器
  * @param cfg   配置结构体
- * @return ESP_OK or ESP_FAIL 
+ * @return ESP_OK or ESP_FAIL
 */
 static void button_handle(void *param)
 {
     int increase_cnt = (int)param;  //传入的参数是5，表示定时器运行周期是5ms
+    bool idle = true;
     button_dev_t* btn_target = s_button_head;
     for(;btn_target;btn_target = btn_target->next)
     {
+        bool pressed = (gpio_get_level(btn_target->btn_cfg.gpio_num) == btn_target->btn_cfg.active_level);
         switch(btn_target->state)
         {
             case BUTTON_RELEASE:             //按键没有按下
-                if(gpio_get_level(btn_target->btn_cfg.gpio_num) == btn_target->btn_cfg.active_level)
+                if(pressed)
                 {
                     btn_target->press_cnt += increase_cnt;
                     btn_target->state = BUTTON_PRESS;   //调转到按下状态
                 }
                 break;
-            case BUTTON_PRESS:               //按键按下了，等待一点延时（消抖），然后触发短按回调事件，进入BUTTON_HOLD
-                if(gpio_get_level(btn_target->btn_cfg.gpio_num) == btn_target->btn_cfg.active_level)
+            case BUTTON_PRESS:               //按键按下了，等待一点延时（消抖），没有连击回调时触发短按回调事件，进入BUTTON_HOLD
+                if(pressed)
                 {
                     btn_target->press_cnt += increase_cnt;
-                    if(btn_target->press_cnt >= FILITER_TIMER)  //过了滤波时间，执行短按回调函数
+                    if(btn_target->press_cnt >= FILITER_TIMER)  //过了滤波时间
                     {
-                        ESP_LOGI(TAG,"short press detect");
-                        if(btn_target->btn_cfg.short_cb)
-                            btn_target->btn_cfg.short_cb();
+                        //有连击回调时，这次按下可能是双击的一部分，等连击间隔结束再决定是不是单击
+                        if(!button_has_click_cb(btn_target))
+                        {
+                            ESP_LOGI(TAG,"short press detect");
+                            button_post(INPUT_BTN_SHORT, btn_target->btn_cfg.gpio_num, 0);
+                        }
                         btn_target->state = BUTTON_HOLD;    //状态转入按下状态
                     }
                 }
-                else
+                else if(btn_target->click_cnt)      //连击等待中的抖动，继续等待
                 {
-                    btn_target->state = BUTTON_RELEASE;
                     btn_target->press_cnt = 0;
+                    btn_target->state = BUTTON_WAIT_CLICK;
+                }
+                else
+                {
+                    button_reset(btn_target);
                 }
                 break;
             case BUTTON_HOLD:                //按住状态，如果时间长度超过设定的超时计数，将触发长按回调函数，进入BUTTON_LONG_PRESS_HOLD
-                if(gpio_get_level(btn_target->btn_cfg.gpio_num) == btn_target->btn_cfg.active_level)
+                if(pressed)
                 {
                     btn_target->press_cnt += increase_cnt;
                     if(btn_target->press_cnt >= btn_target->btn_cfg.long_press_time)  //已经检测到按下大于预设长按时间,执行长按回调函数
                     {
-                        ESP_LOGI(TAG,"long press detect");
-                        if(btn_target->btn_cfg.long_cb)
-                            btn_target->btn_cfg.long_cb();
+                        if(!btn_target->in_combo)
+                        {
+                            ESP_LOGI(TAG,"long press detect");
+                            button_post(INPUT_BTN_LONG, btn_target->btn_cfg.gpio_num, 0);
+                        }
                         btn_target->state = BUTTON_LONG_PRESS_HOLD;
                     }
                 }
                 else
                 {
-                    btn_target->state = BUTTON_RELEASE;
-                    btn_target->press_cnt = 0;
+                    button_click_release(btn_target);
                 }
                 break;
             case BUTTON_LONG_PRESS_HOLD:     //此状态等待电平消失，回到BUTTON_RELEASE状态
-                if(gpio_get_level(btn_target->btn_cfg.gpio_num) != btn_target->btn_cfg.active_level)    //检测到释放，就回到初始状态
+                if(!pressed)    //检测到释放，就回到初始状态
                 {
-                    btn_target->state = BUTTON_RELEASE;
-                    btn_target->press_cnt = 0;
+                    button_reset(btn_target);
+                }
+                break;
+            case BUTTON_WAIT_CLICK:          //等待连击
+                if(pressed)
+                {
+                    btn_target->press_cnt += increase_cnt;
+                    btn_target->state = BUTTON_PRESS;
+                }
+                else
+                {
+                    btn_target->release_cnt += increase_cnt;
+                    if(btn_target->release_cnt >= btn_target->btn_cfg.click_interval)   //连击结束
+                    {
+                        int count = btn_target->click_cnt;
+                        if(count == 1)
+                        {
+                            ESP_LOGI(TAG,"short press detect");
+                            button_post(INPUT_BTN_SHORT, btn_target->btn_cfg.gpio_num, 0);
+                        }
+                        if(count == 2 && btn_target->btn_cfg.double_cb)
+                        {
+                            ESP_LOGI(TAG,"double click detect");
+                            button_post(INPUT_BTN_DOUBLE, btn_target->btn_cfg.gpio_num, 0);
+                        }
+                        if(count >= 2 && btn_target->btn_cfg.multi_cb)
+                        {
+                            ESP_LOGI(TAG,"%d clicks detect",count);
+                            button_post(INPUT_BTN_MULTI, btn_target->btn_cfg.gpio_num, count);
+                        }
+                        button_reset(btn_target);
+                    }
                 }
                 break;
             default:break;
         }
+        if(btn_target->state != BUTTON_RELEASE)
+            idle = false;
+    }
+
+    button_combo_handle();
+
+    if(idle)
+    {
+        //先停定时器再清标志，这中间来的按下边沿由下面的电平检查补上
+        esp_timer_stop(g_button_timer_handle);
+        portENTER_CRITICAL(&s_timer_lock);
+        g_is_timer_running = false;
+        portEXIT_CRITICAL(&s_timer_lock);
+        for(btn_target = s_button_head;btn_target;btn_target = btn_target->next)
+        {
+            if(gpio_get_level(btn_target->btn_cfg.gpio_num) == btn_target->btn_cfg.active_level)
+            {
+                button_timer_arm();
+                break;
+            }
+        }
     }
 }
@@ -17,7 +17,7 @@ void simple_btn_test(void* arg)
     //初始化按键GPIO
     gpio_config_t gpio_t = 
     {
-        .intr_type = GPIO_INTR_DISABLE,     //禁止中断
+        .intr_type = GPIO_INTR_NEGEDGE,     //与较通用的按键例程共用引脚，不能关闭按键的中断
         .mode = GPIO_MODE_INPUT,            //输入模式
         .pin_bit_mask = (1ull<<BTN_GPIO),   //GPIO引脚号
         .pull_down_en = GPIO_PULLDOWN_DISABLE,  //禁止下拉
@@ -39,6 +39,7 @@ void simple_btn_test(void* arg)
 static EventGroupHandle_t s_pressEvent;
 #define SHORT_EV    BIT0    //短按
 #define LONG_EV     BIT1    //长按
+#define DOUBLE_EV   BIT2    //双击
 
 /** 短按按键回调函数
  * @param 无
@@ -58,6 +59,14 @@ void long_press_handle(void)
     xEventGroupSetBits(s_pressEvent,LONG_EV);
 }
 
+/** 双击按键回调函数
+ * @param 无
+ * @return 无
+*/
+void double_click_handle(void)
+{
+    xEventGroupSetBits(s_pressEvent,DOUBLE_EV);
+}
 
 /** 完整的按键+LED演示程序
  * @param 无
@@ -72,14 +81,16 @@ void complete_btn_test(void* arg)
         .active_level = 0,          //按下的电平
         .long_press_time = 3000,    //长按时间
         .short_cb = short_press_handle,           //短按回调函数
-        .long_cb = long_press_handle             //长按回调函数
+        .long_cb = long_press_handle,            //长按回调函数
+        .click_interval = 300,                   //连击间隔
+        .double_cb = double_click_handle,        //双击回调函数
     };
     button_event_set(&btn_cfg);     //添加按键响应事件处理
     EventBits_t ev;
     while(1)
     {
         //等待按键按下事件
-        ev = xEventGroupWaitBits(s_pressEvent,SHORT_EV|LONG_EV,pdTRUE,pdFALSE,portMAX_DELAY);
+        ev = xEventGroupWaitBits(s_pressEvent,SHORT_EV|LONG_EV|DOUBLE_EV,pdTRUE,pdFALSE,portMAX_DELAY);
         if(ev & SHORT_EV)
         {
             //短按事件，亮一下熄灭
@@ -98,8 +109,16 @@ void complete_btn_test(void* arg)
                 vTaskDelay(pdMS_TO_TICKS(200));
             }
         }
+        if(ev & DOUBLE_EV)
+        {
+            //双击事件，常亮1秒
+            gpio_set_level(LED_GPIO,1);
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            gpio_set_level(LED_GPIO,0);
+        }
         xEventGroupClearBits(s_pressEvent,SHORT_EV);
         xEventGroupClearBits(s_pressEvent,LONG_EV);
+        xEventGroupClearBits(s_pressEvent,DOUBLE_EV);
     }
 }
 
@@ -0,0 +1,83 @@
+#ifndef _DHT_TRACES_H_
+#define _DHT_TRACES_H_
+/*
+ * DHT11 / DHT22 接收波形，按手册时序加上抖动、毛刺生成，RMT 分辨率 1 MHz，格式与 rmt_receive 收到的符号相同
+ * 注意：这些都是人工合成的波形，不是从硬件上录下来的，脉宽数值只代表手册时序，没有经过实际传感器验证；
+ * 用真实传感器录到的波形请另外加入，并注明传感器型号和录制条件
+ * 每帧从主机起始信号的尾部开始（低电平 + 释放总线后的上拉高电平），然后是 80 us 应答低电平、80 us 高电平、40 位数据
+ * 最后一个符号的 duration1 为 0，表示空闲电平超过 signal_range_max_ns 后接收结束
+ */
+#include "driver/rmt_types.h"
+
+#define SYM(l0, d0, l1, d1) {{.duration0 = (d0), .level0 = (l0), .duration1 = (d1), .level1 = (l1)}}
+
+/* DHT11 正常帧：湿度 55%，温度 23.4 ℃，字节 37 00 17 04 52 */
+static const rmt_symbol_word_t s_xTraceDht11Clean[] = {
+    SYM(0, 19, 1, 31), SYM(0, 81, 1, 83), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 54, 1, 0),
+};
+
+/* DHT22 正常帧：湿度 65.2%，温度 -10.1 ℃，字节 02 8C 80 65 73，时序抖动 ±2 us */
+static const rmt_symbol_word_t s_xTraceDht22Negative[] = {
+    SYM(0, 19, 1, 31), SYM(0, 81, 1, 83), SYM(0, 51, 1, 26), SYM(0, 50, 1, 27), SYM(0, 54, 1, 28),
+    SYM(0, 50, 1, 25), SYM(0, 50, 1, 28), SYM(0, 52, 1, 26), SYM(0, 54, 1, 69), SYM(0, 54, 1, 28),
+    SYM(0, 50, 1, 69), SYM(0, 51, 1, 24), SYM(0, 50, 1, 28), SYM(0, 51, 1, 28), SYM(0, 51, 1, 72),
+    SYM(0, 54, 1, 68), SYM(0, 50, 1, 27), SYM(0, 50, 1, 24), SYM(0, 54, 1, 68), SYM(0, 51, 1, 24),
+    SYM(0, 54, 1, 24), SYM(0, 54, 1, 24), SYM(0, 52, 1, 28), SYM(0, 50, 1, 26), SYM(0, 50, 1, 28),
+    SYM(0, 50, 1, 24), SYM(0, 53, 1, 28), SYM(0, 51, 1, 71), SYM(0, 53, 1, 72), SYM(0, 53, 1, 28),
+    SYM(0, 51, 1, 24), SYM(0, 53, 1, 72), SYM(0, 51, 1, 25), SYM(0, 50, 1, 69), SYM(0, 54, 1, 24),
+    SYM(0, 52, 1, 71), SYM(0, 51, 1, 68), SYM(0, 50, 1, 70), SYM(0, 52, 1, 27), SYM(0, 51, 1, 24),
+    SYM(0, 54, 1, 68), SYM(0, 54, 1, 69), SYM(0, 54, 1, 0),
+};
+
+/* DHT11 干扰帧：湿度 61%，温度 27.8 ℃，字节 3D 00 1B 08 60，时序抖动 ±6 us，5 个 2~4 us 毛刺，应答前有一次总线抖动 */
+static const rmt_symbol_word_t s_xTraceDht11Noisy[] = {
+    SYM(0, 19, 1, 31), SYM(0, 40, 1, 30), SYM(0, 81, 1, 83), SYM(0, 48, 1, 24), SYM(0, 54, 1, 30),
+    SYM(0, 47, 1, 73), SYM(0, 56, 1, 70), SYM(0, 55, 1, 75), SYM(0, 49, 1, 71), SYM(0, 54, 1, 27),
+    SYM(0, 48, 1, 74), SYM(0, 53, 1, 28), SYM(0, 49, 1, 33), SYM(0, 54, 1, 25), SYM(0, 56, 1, 27),
+    SYM(0, 53, 1, 33), SYM(0, 51, 1, 22), SYM(0, 46, 1, 24), SYM(0, 49, 1, 21), SYM(0, 54, 1, 30),
+    SYM(0, 54, 1, 26), SYM(0, 57, 1, 11), SYM(0, 4, 1, 8), SYM(0, 50, 1, 71), SYM(0, 46, 1, 72),
+    SYM(0, 58, 1, 29), SYM(0, 52, 1, 36), SYM(0, 2, 1, 35), SYM(0, 58, 1, 71), SYM(0, 52, 1, 29),
+    SYM(0, 49, 1, 16), SYM(0, 2, 1, 15), SYM(0, 51, 1, 22), SYM(0, 54, 1, 28), SYM(0, 49, 1, 67),
+    SYM(0, 48, 1, 22), SYM(0, 52, 1, 24), SYM(0, 48, 1, 23), SYM(0, 58, 1, 30), SYM(0, 46, 1, 74),
+    SYM(0, 46, 1, 74), SYM(0, 57, 1, 27), SYM(0, 48, 1, 12), SYM(0, 4, 1, 9), SYM(0, 55, 1, 16),
+    SYM(0, 3, 1, 13), SYM(0, 55, 1, 25), SYM(0, 55, 1, 27), SYM(0, 54, 1, 0),
+};
+
+/* DHT11 截断帧：只收到前 30 位（接收缓存不足或传感器中途停止） */
+static const rmt_symbol_word_t s_xTraceDht11Truncated[] = {
+    SYM(0, 19, 1, 31), SYM(0, 81, 1, 83), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(1, 0, 0, 0),
+};
+
+/* DHT11 中途失步：第 21 位的低电平被拉长到 120 us，之后只剩 19 位 */
+static const rmt_symbol_word_t s_xTraceDht11Broken[] = {
+    SYM(0, 19, 1, 31), SYM(0, 81, 1, 83), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 120, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 71),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 52, 1, 27),
+    SYM(0, 52, 1, 71), SYM(0, 52, 1, 27), SYM(0, 54, 1, 0),
+};
+
+/* 传感器无应答：只有主机释放总线前后的电平 */
+static const rmt_symbol_word_t s_xTraceNoResponse[] = {
+    SYM(0, 19, 1, 31), SYM(1, 0, 0, 0),
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * xPulseDecode 的主机测试
+	1、逐个解码 fixtures/dht_traces.h 中的合成波形(按手册时序生成，不是硬件录制)，检查返回值、输出字节和统计信息
+	2、--bench N：每个波形重复解码 N 次，打印每次解码的耗时
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pulse_decoder.h"
+#include "dht_traces.h"
+
+#define ARRAY_NUM(a) (sizeof(a) / sizeof((a)[0]))
+
+/* 与 dht11.c 中的 s_xDhtDecConfig 相同 */
+static const PulseDecConfig_t s_xDhtDecConfig = {
+	.usLowMin = 30,
+	.usLowMax = 70,
+	.usHighMin = 15,
+	.usHighMax = 95,
+	.usGlitchUs = 8,
+	.usThreshold = 40,
+	.usMinSpread = 20,
+	.ucBitNum = 40,
+};
+
+typedef struct
+{
+	const char *pcName;
+	const rmt_symbol_word_t *pxItem;
+	int iItemNum;
+	PulseDecErr_t xErr;		 // 期望的返回值
+	uint8_t ucData[5];		 // 期望的输出，只在 PULSE_DEC_OK 时检查
+	PulseDecInfo_t xInfo;	 // 期望的统计信息，usThreshold 为 0 时不检查
+} TraceCase_t;
+
+#define TRACE(a) #a, a, ARRAY_NUM(a)
+
+static const TraceCase_t s_xCases[] = {
+	{TRACE(s_xTraceDht11Clean), PULSE_DEC_OK, {0x37, 0x00, 0x17, 0x04, 0x52}, {.usBitNum = 40, .usThreshold = 49}},
+	{TRACE(s_xTraceDht22Negative), PULSE_DEC_OK, {0x02, 0x8C, 0x80, 0x65, 0x73}, {.usBitNum = 40}},
+	{TRACE(s_xTraceDht11Noisy), PULSE_DEC_OK, {0x3D, 0x00, 0x1B, 0x08, 0x60}, {.usBitNum = 40, .usGlitch = 5, .usResync = 1}},
+	{TRACE(s_xTraceDht11Truncated), PULSE_DEC_ERR_BITS, {0}, {.usBitNum = 30}},
+	{TRACE(s_xTraceDht11Broken), PULSE_DEC_ERR_BITS, {0}, {.usBitNum = 19, .usResync = 1}},
+	{TRACE(s_xTraceNoResponse), PULSE_DEC_ERR_NO_DATA, {0}, {0}},
+};
+
+static const char *prvErrName(PulseDecErr_t xErr)
+{
+	switch (xErr){
+	case PULSE_DEC_OK:
+		return "OK";
+	case PULSE_DEC_ERR_NO_DATA:
+		return "NO_DATA";
+	case PULSE_DEC_ERR_BITS:
+		return "BITS";
+	default:
+		return "?";
+	}
+}
+
+static int prvCheck(const TraceCase_t *pxCase)
+{
+	uint8_t ucData[5];
+	PulseDecInfo_t xInfo;
+	int iFail = 0;
+	memset(ucData, 0, sizeof(ucData));
+	PulseDecErr_t xErr = xPulseDecode(&s_xDhtDecConfig, pxCase->pxItem, pxCase->iItemNum, ucData, &xInfo);
+
+	if (xErr != pxCase->xErr){
+		printf("  result %s, expect %s\n", prvErrName(xErr), prvErrName(pxCase->xErr));
+		iFail++;
+	}
+	if (xErr == PULSE_DEC_OK && memcmp(ucData, pxCase->ucData, sizeof(ucData))){
+		printf("  data %02X %02X %02X %02X %02X, expect %02X %02X %02X %02X %02X\n",
+			   ucData[0], ucData[1], ucData[2], ucData[3], ucData[4],
+			   pxCase->ucData[0], pxCase->ucData[1], pxCase->ucData[2], pxCase->ucData[3], pxCase->ucData[4]);
+		iFail++;
+	}
+	const PulseDecInfo_t *pxExpect = &pxCase->xInfo;
+	if (xInfo.usBitNum != pxExpect->usBitNum || xInfo.usExtraBits != pxExpect->usExtraBits ||
+		xInfo.usGlitch != pxExpect->usGlitch || xInfo.usResync != pxExpect->usResync ||
+		(pxExpect->usThreshold && xInfo.usThreshold != pxExpect->usThreshold)){
+		printf("  info bits %u extra %u glitch %u resync %u threshold %u, expect %u %u %u %u %u\n",
+			   xInfo.usBitNum, xInfo.usExtraBits, xInfo.usGlitch, xInfo.usResync, xInfo.usThreshold,
+			   pxExpect->usBitNum, pxExpect->usExtraBits, pxExpect->usGlitch, pxExpect->usResync, pxExpect->usThreshold);
+		iFail++;
+	}
+	printf("%-24s %-8s %s\n", pxCase->pcName, prvErrName(xErr), iFail ? "FAIL" : "ok");
+	return iFail;
+}
+
+static double prvNow(void)
+{
+	struct timespec xTs;
+	clock_gettime(CLOCK_MONOTONIC, &xTs);
+	return xTs.tv_sec + xTs.tv_nsec * 1e-9;
+}
+
+/* 每个波形连续解码 iLoop 次，打印每次解码和每个符号的平均耗时 */
+static void prvBench(int iLoop)
+{
+	uint8_t ucData[5];
+	volatile uint32_t ulSink = 0;
+	for (size_t i = 0; i < ARRAY_NUM(s_xCases); i++){
+		const TraceCase_t *pxCase = &s_xCases[i];
+		double dStart = prvNow();
+		for (int j = 0; j < iLoop; j++){
+			ulSink += xPulseDecode(&s_xDhtDecConfig, pxCase->pxItem, pxCase->iItemNum, ucData, NULL);
+			ulSink += ucData[4];
+		}
+		double dNs = (prvNow() - dStart) * 1e9 / iLoop;
+		printf("%-24s %3d symbols  %8.1f ns/decode  %6.2f ns/symbol\n",
+			   pxCase->pcName, pxCase->iItemNum, dNs, dNs / pxCase->iItemNum);
+	}
+	(void)ulSink;
+}
+
+int main(int argc, char **argv)
+{
+	int iFail = 0;
+	for (size_t i = 0; i < ARRAY_NUM(s_xCases); i++)
+		iFail += prvCheck(&s_xCases[i]);
+	if (argc > 2 && !strcmp(argv[1], "--bench"))
+		prvBench(atoi(argv[2]));
+	if (iFail)
+		printf("%d check(s) failed\n", iFail);
+	return iFail ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+#ifndef _HOST_RMT_TYPES_H_
+#define _HOST_RMT_TYPES_H_
+/* 主机替身：只提供 pulse_decoder 用到的 rmt_symbol_word_t，布局与 ESP-IDF 的 hal/rmt_types.h 相同 */
+#include <stdint.h>
+
+typedef union
+{
+	struct
+	{
+		uint16_t duration0 : 15;
+		uint16_t level0 : 1;
+		uint16_t duration1 : 15;
+		uint16_t level1 : 1;
+	};
+	uint32_t val;
+} rmt_symbol_word_t;
+
+#endif
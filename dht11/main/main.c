@@ -17,6 +17,25 @@ const static char *TAG = "DHT11_Demo";
 // 温度 湿度变量
 int iTemp = 0, iHum = 0;
 
+/* 采集结果，由完成回调写入 */
+static volatile int s_iResult = 0;
+
+/* DHT11 采集完成回调（接收完成时在中断中执行，超时时在定时器任务中执行），记录数据并通知主任务 */
+static bool prvDht11Done(int iResult, int iTempX10, int iHumidity, void *pvArg)
+{
+	BaseType_t xHighTaskWakeup = pdFALSE;
+	s_iResult = iResult;
+	if (iResult){
+		iTemp = iTempX10;
+		iHum = iHumidity;
+	}
+	if (xPortInIsrContext())
+		vTaskNotifyGiveFromISR((TaskHandle_t)pvArg, &xHighTaskWakeup);
+	else
+		xTaskNotifyGive((TaskHandle_t)pvArg);
+	return xHighTaskWakeup == pdTRUE;
+}
+
 /*
  * RMT 是 ESP32 的一个专用外设，本质上是一个可编程的脉冲序列发生器/分析器。
  * 全称是 Remote Control Transceiver（远程控制收发器）。
@@ -56,9 +75,14 @@ void app_main(void)
 	vDht11Init(DHT11_GPIO);
 	while (1)
 	{
-		if (iDht11StartGet(&iTemp, &iHum))
+		/* 异步启动采集，起始信号和接收都不占用 CPU，这段时间可以做别的事情 */
+		if (xDht11StartAsync(prvDht11Done, xTaskGetCurrentTaskHandle()) == ESP_OK)
 		{
-			ESP_LOGI(TAG, "temp->%i.%i C     hum->%i%%", iTemp / 10, iTemp % 10, iHum);
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+			if (s_iResult)
+			{
+				ESP_LOGI(TAG, "temp->%i.%i C     hum->%i%%", iTemp / 10, iTemp % 10, iHum);
+			}
 		}
 		vTaskDelay(1000 / portTICK_PERIOD_MS);
 	}
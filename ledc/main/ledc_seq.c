@@ -0,0 +1,344 @@
+/*
+ * LEDC 硬件渐变波形序列器
+ *
+ * 原来的呼吸灯每次渐变结束都要：中断 -> 事件组唤醒任务 -> 任务设置下一次渐变 -> 重新注册回调。
+ * 这里在播放时就把整条波形拆成若干段硬件渐变（起始占空比、方向、步数、每步周期数、步长），
+ * 渐变完成中断里直接把下一段写进寄存器，整个播放过程没有任何任务唤醒。
+ *
+ * LEDC 硬件渐变只能是线性的，而人眼对亮度的感知是非线性的，
+ * 所以每段关键帧过渡再拆成 LEDC_SEQ_SUBSEG 小段，每段端点做 gamma 校正，用折线逼近 gamma 曲线。
+ */
+
+#include <math.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "soc/soc_caps.h"
+#include "hal/ledc_hal.h"
+#include "ledc_seq.h"
+
+static const char *TAG = "ledc_seq";
+
+#define LEDC_SEQ_MODE LEDC_LOW_SPEED_MODE // 所有芯片都支持低速模式
+#define LEDC_SEQ_MAX_SEGMENT (LEDC_SEQ_MAX_KEYFRAME * LEDC_SEQ_SUBSEG)
+
+/* 渐变寄存器位宽为 10 位 */
+#define LEDC_SEQ_HW_NUM_MAX 1023   // 最大步数
+#define LEDC_SEQ_HW_CYCLE_MAX 1023 // 每步最多的 PWM 周期数
+#define LEDC_SEQ_HW_SCALE_MAX 1023 // 最大步长
+#define LEDC_SEQ_SCALE_SEARCH 32   // 计算渐变段时最多尝试的步长个数
+
+/* 一段硬件渐变，播放前计算好，中断里直接写入 */
+typedef struct
+{
+    uint32_t ulStartDuty; // 起始占空比
+    uint16_t usNum;       // 步数
+    uint16_t usCycle;     // 每步的 PWM 周期数
+    uint16_t usScale;     // 每步变化量，0 表示保持
+    uint8_t ucDir;        // 方向 ledc_duty_direction_t
+} LedcSeqSegment_t;
+
+/* 单个通道的播放状态 */
+typedef struct
+{
+    LedcSeqSegment_t xSegs[LEDC_SEQ_MAX_SEGMENT]; // 渐变段
+    uint16_t usSegNum;                            // 渐变段个数
+    uint16_t usSegIndex;                          // 当前播放的段
+    uint8_t ucLoop;                               // 是否循环
+    uint8_t ucActive;                             // 是否正在播放
+    uint8_t ucUsed;                               // 通道是否已添加
+} LedcSeqChannel_t;
+
+static LedcSeqChannel_t s_xChannels[LEDC_SEQ_MAX_CHANNEL];
+static ledc_hal_context_t s_xHal;
+static ledc_isr_handle_t s_xIsrHandle = NULL;
+static portMUX_TYPE s_xLock = portMUX_INITIALIZER_UNLOCKED;
+static LedcSeqConfig_t s_xConfig;
+static uint32_t s_ulMaxDuty = 0;
+
+/** 把一段硬件渐变写入寄存器并启动
+ * @param xChannel 通道
+ * @param pxSeg 渐变段
+ * @return 无
+ */
+static inline void prvLedcSeqStartSegment(ledc_channel_t xChannel, const LedcSeqSegment_t *pxSeg)
+{
+    /* 驱动的 ledc_set_fade / ledc_update_duty 会打印日志、使用任务版本的临界区，不能在中断里调用，
+     * 这里直接通过 HAL 写寄存器，与驱动内部的 ledc_duty_config + _ledc_update_duty 相同。
+     * 调用者持有 s_xLock，保证同一通道不会同时被中断和任务写入 */
+    ledc_hal_set_duty_int_part(&s_xHal, xChannel, pxSeg->ulStartDuty);
+    ledc_hal_set_fade_param(&s_xHal, xChannel, 0, pxSeg->ucDir, pxSeg->usCycle, pxSeg->usScale, pxSeg->usNum);
+#if SOC_LEDC_GAMMA_CURVE_FADE_SUPPORTED
+    ledc_hal_set_range_number(&s_xHal, xChannel, 1);
+#endif
+    ledc_hal_set_sig_out_en(&s_xHal, xChannel, true);
+    ledc_hal_set_duty_start(&s_xHal, xChannel, true);
+    ledc_hal_ls_channel_update(&s_xHal, xChannel);
+}
+
+/** 渐变完成中断，直接装载下一段
+ * @param pvArg 未使用
+ * @return 无
+ */
+static void prvLedcSeqIsr(void *pvArg)
+{
+    uint32_t ulStatus = 0;
+    ledc_hal_get_fade_end_intr_status(&s_xHal, &ulStatus);
+    while (ulStatus){
+        ledc_channel_t xChannel = __builtin_ctz(ulStatus);
+        ulStatus &= ulStatus - 1;
+        ledc_hal_clear_fade_end_intr_status(&s_xHal, xChannel);
+        if (xChannel >= LEDC_SEQ_MAX_CHANNEL)
+            continue;
+
+        LedcSeqChannel_t *pxChan = &s_xChannels[xChannel];
+        portENTER_CRITICAL_ISR(&s_xLock);
+        if (pxChan->ucActive){
+            if (++pxChan->usSegIndex >= pxChan->usSegNum){
+                if (pxChan->ucLoop){
+                    pxChan->usSegIndex = 0;
+                } else {
+                    pxChan->ucActive = 0; // 播放一次结束，停在最后一段的目标亮度
+                }
+            }
+            if (pxChan->ucActive)
+                prvLedcSeqStartSegment(xChannel, &pxChan->xSegs[pxChan->usSegIndex]);
+        }
+        portEXIT_CRITICAL_ISR(&s_xLock);
+    }
+}
+
+/** 感知亮度转换为占空比（gamma 校正）
+ * @param ulLevel 亮度 0 ~ LEDC_SEQ_LEVEL_MAX
+ * @return 占空比
+ */
+static uint32_t prvLedcSeqLevelToDuty(uint32_t ulLevel)
+{
+    if (ulLevel >= LEDC_SEQ_LEVEL_MAX)
+        return s_ulMaxDuty;
+    float fGamma = s_xConfig.fGamma > 0 ? s_xConfig.fGamma : 1.0f;
+    return (uint32_t)(s_ulMaxDuty * powf((float)ulLevel / LEDC_SEQ_LEVEL_MAX, fGamma) + 0.5f);
+}
+
+/** 计算从 ulFrom 到 ulTo 占空比、历时 ulTimeMs 的一段硬件渐变参数
+ * 实际时长为 步数 x 每步周期数，三个参数都只有 10 位，时长只能逼近：
+ * 每步周期数取整的误差最多为步数的一半，步数接近总周期数时（每步 1~2 个周期）误差可达 30% 以上，
+ * 所以在几个步长中选择时长误差最小的一组，除了总共只有几十个周期的极短渐变，误差一般在 1% 以内。
+ * 渐变段最长为 可用步数 x 1023 个周期（5 kHz 时约 100 s 以上），超出时被截短
+ * @param pxSeg 返回的渐变段
+ * @param ulFrom,ulTo 起止占空比
+ * @param ulTimeMs 渐变时间
+ * @return 无
+ */
+static void prvLedcSeqBuildSegment(LedcSeqSegment_t *pxSeg, uint32_t ulFrom, uint32_t ulTo, uint32_t ulTimeMs)
+{
+    /* 渐变时间换算为 PWM 周期数 */
+    uint32_t ulPeriods = ulTimeMs * s_xConfig.ulFreqHz / 1000;
+    if (ulPeriods == 0)
+        ulPeriods = 1;
+    uint32_t ulDelta = ulTo > ulFrom ? ulTo - ulFrom : ulFrom - ulTo;
+    pxSeg->ucDir = ulTo >= ulFrom ? LEDC_DUTY_DIR_INCREASE : LEDC_DUTY_DIR_DECREASE;
+
+    if (ulDelta == 0){
+        /* 保持段：步长为 0，只用步数 x 周期数计时 */
+        uint32_t ulCycle = (ulPeriods + LEDC_SEQ_HW_NUM_MAX - 1) / LEDC_SEQ_HW_NUM_MAX;
+        ulCycle = ulCycle > LEDC_SEQ_HW_CYCLE_MAX ? LEDC_SEQ_HW_CYCLE_MAX : ulCycle;
+        uint32_t ulNum = ulPeriods / ulCycle;
+        pxSeg->usScale = 0;
+        pxSeg->usCycle = ulCycle;
+        pxSeg->usNum = ulNum == 0 ? 1 : (ulNum > LEDC_SEQ_HW_NUM_MAX ? LEDC_SEQ_HW_NUM_MAX : ulNum);
+        pxSeg->ulStartDuty = ulTo;
+        return;
+    }
+
+    /* 最小步长：既要在规定周期内走完，又不能超过最大步数 */
+    uint32_t ulMinScale = (ulDelta + ulPeriods - 1) / ulPeriods;
+    uint32_t ulNumScale = (ulDelta + LEDC_SEQ_HW_NUM_MAX - 1) / LEDC_SEQ_HW_NUM_MAX;
+    ulMinScale = ulMinScale < ulNumScale ? ulNumScale : ulMinScale;
+    ulMinScale = ulMinScale > LEDC_SEQ_HW_SCALE_MAX ? LEDC_SEQ_HW_SCALE_MAX : ulMinScale;
+
+    /* 步长越小越平滑，加大步长减少步数可以让每步周期数的取整误差变小，取时长误差最小的一组 */
+    uint32_t ulBestErr = UINT32_MAX, ulScale = ulMinScale, ulNum = 1, ulCycle = 1;
+    for (uint32_t s = ulMinScale; s <= LEDC_SEQ_HW_SCALE_MAX && s < ulMinScale + LEDC_SEQ_SCALE_SEARCH; s++){
+        uint32_t n = ulDelta / s;
+        if (n == 0)
+            break;
+        n = n > LEDC_SEQ_HW_NUM_MAX ? LEDC_SEQ_HW_NUM_MAX : n;
+        uint32_t c = (ulPeriods + n / 2) / n;
+        c = c == 0 ? 1 : (c > LEDC_SEQ_HW_CYCLE_MAX ? LEDC_SEQ_HW_CYCLE_MAX : c);
+        uint32_t ulErr = n * c > ulPeriods ? n * c - ulPeriods : ulPeriods - n * c;
+        if (ulErr < ulBestErr){
+            ulBestErr = ulErr;
+            ulScale = s;
+            ulNum = n;
+            ulCycle = c;
+        }
+        if (ulErr == 0)
+            break;
+    }
+
+    pxSeg->usScale = ulScale;
+    pxSeg->usNum = ulNum;
+    pxSeg->usCycle = ulCycle;
+    /* 步长不能整除时调整起点，保证最终正好停在目标占空比上 */
+    pxSeg->ulStartDuty = pxSeg->ucDir == LEDC_DUTY_DIR_INCREASE ? ulTo - ulNum * ulScale : ulTo + ulNum * ulScale;
+}
+
+/** 把两帧之间的过渡拆成若干硬件渐变段
+ * @param pxChan 通道
+ * @param ulFromLevel,ulToLevel 起止亮度
+ * @param ulTimeMs 过渡时间
+ * @return 无
+ */
+static void prvLedcSeqAddTransition(LedcSeqChannel_t *pxChan, uint32_t ulFromLevel, uint32_t ulToLevel, uint32_t ulTimeMs)
+{
+    if (ulTimeMs == 0 && ulFromLevel == ulToLevel)
+        return;
+    /* 保持不变的过渡只需要一段 */
+    uint32_t ulSub = ulFromLevel == ulToLevel ? 1 : LEDC_SEQ_SUBSEG;
+    uint32_t ulPrevDuty = prvLedcSeqLevelToDuty(ulFromLevel);
+    for (uint32_t k = 1; k <= ulSub; k++){
+        int32_t lLevel = (int32_t)ulFromLevel + ((int32_t)ulToLevel - (int32_t)ulFromLevel) * (int32_t)k / (int32_t)ulSub;
+        uint32_t ulDuty = prvLedcSeqLevelToDuty(lLevel);
+        prvLedcSeqBuildSegment(&pxChan->xSegs[pxChan->usSegNum++], ulPrevDuty, ulDuty, ulTimeMs / ulSub);
+        ulPrevDuty = ulDuty;
+    }
+}
+
+/** 初始化波形序列器
+ * @param pxConfig 配置
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqInit(const LedcSeqConfig_t *pxConfig)
+{
+    ESP_RETURN_ON_FALSE(pxConfig && pxConfig->ulFreqHz, ESP_ERR_INVALID_ARG, TAG, "invalid config");
+    ESP_RETURN_ON_FALSE(s_xIsrHandle == NULL, ESP_ERR_INVALID_STATE, TAG, "already initialized");
+
+    s_xConfig = *pxConfig;
+    s_ulMaxDuty = (1UL << pxConfig->xDutyRes) - 1;
+    memset(s_xChannels, 0, sizeof(s_xChannels));
+
+    ledc_timer_config_t xLedcTimer = {
+        .speed_mode = LEDC_SEQ_MODE,
+        .timer_num = pxConfig->xTimer,
+        .duty_resolution = pxConfig->xDutyRes,
+        .freq_hz = pxConfig->ulFreqHz,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    ESP_RETURN_ON_ERROR(ledc_timer_config(&xLedcTimer), TAG, "timer config failed");
+
+    /* 自己处理渐变完成中断，不经过 ledc_fade_func_install 的回调和信号量 */
+    ledc_hal_init(&s_xHal, LEDC_SEQ_MODE);
+    ESP_RETURN_ON_ERROR(ledc_isr_register(prvLedcSeqIsr, NULL, 0, &s_xIsrHandle), TAG, "isr register failed");
+    return ESP_OK;
+}
+
+/** 添加一个 LED 通道
+ * @param xChannel LEDC 通道
+ * @param xGpio 输出管脚
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqAddChannel(ledc_channel_t xChannel, gpio_num_t xGpio)
+{
+    ESP_RETURN_ON_FALSE(s_xIsrHandle, ESP_ERR_INVALID_STATE, TAG, "not initialized");
+    ESP_RETURN_ON_FALSE(xChannel < LEDC_SEQ_MAX_CHANNEL, ESP_ERR_INVALID_ARG, TAG, "invalid channel");
+
+    ledc_channel_config_t xLedcChannel = {
+        .speed_mode = LEDC_SEQ_MODE,
+        .channel = xChannel,
+        .timer_sel = s_xConfig.xTimer,
+        .gpio_num = xGpio,
+        .intr_type = LEDC_INTR_FADE_END, // 使能渐变完成中断
+        .duty = 0,
+        .hpoint = 0,
+    };
+    ESP_RETURN_ON_ERROR(ledc_channel_config(&xLedcChannel), TAG, "channel config failed");
+    s_xChannels[xChannel].ucUsed = 1;
+    return ESP_OK;
+}
+
+/** 在某个通道上播放波形
+ * @param xChannel LEDC 通道
+ * @param pxWave 波形
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqPlay(ledc_channel_t xChannel, const LedcSeqWave_t *pxWave)
+{
+    ESP_RETURN_ON_FALSE(xChannel < LEDC_SEQ_MAX_CHANNEL && s_xChannels[xChannel].ucUsed, ESP_ERR_INVALID_ARG, TAG, "invalid channel");
+    ESP_RETURN_ON_FALSE(pxWave && pxWave->pxFrames && pxWave->ucFrameNum > 0 && pxWave->ucFrameNum <= LEDC_SEQ_MAX_KEYFRAME,
+                        ESP_ERR_INVALID_ARG, TAG, "invalid wave");
+    LedcSeqChannel_t *pxChan = &s_xChannels[xChannel];
+
+    /* 先停止播放，中断不会再读取渐变段，之后可以放心重建 */
+    portENTER_CRITICAL(&s_xLock);
+    pxChan->ucActive = 0;
+    portEXIT_CRITICAL(&s_xLock);
+
+    const LedcSeqKeyframe_t *pxFrames = pxWave->pxFrames;
+    uint8_t ucNum = pxWave->ucFrameNum;
+    pxChan->usSegNum = 0;
+    for (uint8_t i = 1; i < ucNum; i++)
+        prvLedcSeqAddTransition(pxChan, pxFrames[i - 1].usLevel, pxFrames[i].usLevel, pxFrames[i].usTimeMs);
+    if (pxWave->ucLoop)
+        prvLedcSeqAddTransition(pxChan, pxFrames[ucNum - 1].usLevel, pxFrames[0].usLevel, pxFrames[0].usTimeMs);
+
+    /* 没有任何过渡（单帧或全部时间为 0），直接输出最后的亮度 */
+    if (pxChan->usSegNum == 0)
+        return xLedcSeqStop(xChannel, pxFrames[ucNum - 1].usLevel);
+
+    portENTER_CRITICAL(&s_xLock);
+    pxChan->ucLoop = pxWave->ucLoop;
+    pxChan->usSegIndex = 0;
+    pxChan->ucActive = 1;
+    prvLedcSeqStartSegment(xChannel, &pxChan->xSegs[0]);
+    portEXIT_CRITICAL(&s_xLock);
+    return ESP_OK;
+}
+
+/** 呼吸效果
+ * @param xChannel LEDC 通道
+ * @param ulPeriodMs 一个呼吸周期（ms）
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqBreathe(ledc_channel_t xChannel, uint32_t ulPeriodMs)
+{
+    LedcSeqKeyframe_t xFrames[] = {
+        {0, ulPeriodMs / 2},                  // 由亮变暗
+        {LEDC_SEQ_LEVEL_MAX, ulPeriodMs / 2}, // 由暗变亮
+    };
+    LedcSeqWave_t xWave = {.pxFrames = xFrames, .ucFrameNum = 2, .ucLoop = 1};
+    return xLedcSeqPlay(xChannel, &xWave);
+}
+
+/** 脉冲效果
+ * @param xChannel LEDC 通道
+ * @param ulPeriodMs 一个脉冲周期（ms）
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqPulse(ledc_channel_t xChannel, uint32_t ulPeriodMs)
+{
+    LedcSeqKeyframe_t xFrames[] = {
+        {0, 0},                                // 起点
+        {LEDC_SEQ_LEVEL_MAX, ulPeriodMs / 10}, // 快速点亮
+        {0, ulPeriodMs * 4 / 10},              // 缓慢熄灭
+        {0, ulPeriodMs / 2},                   // 熄灭保持
+    };
+    LedcSeqWave_t xWave = {.pxFrames = xFrames, .ucFrameNum = 4, .ucLoop = 1};
+    return xLedcSeqPlay(xChannel, &xWave);
+}
+
+/** 停止波形并保持某个亮度
+ * @param xChannel LEDC 通道
+ * @param usLevel 亮度
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedcSeqStop(ledc_channel_t xChannel, uint16_t usLevel)
+{
+    ESP_RETURN_ON_FALSE(xChannel < LEDC_SEQ_MAX_CHANNEL && s_xChannels[xChannel].ucUsed, ESP_ERR_INVALID_ARG, TAG, "invalid channel");
+    portENTER_CRITICAL(&s_xLock);
+    s_xChannels[xChannel].ucActive = 0;
+    portEXIT_CRITICAL(&s_xLock);
+    /* 直接设置占空比会终止正在进行的硬件渐变 */
+    ESP_RETURN_ON_ERROR(ledc_set_duty(LEDC_SEQ_MODE, xChannel, prvLedcSeqLevelToDuty(usLevel)), TAG, "set duty failed");
+    return ledc_update_duty(LEDC_SEQ_MODE, xChannel);
+}
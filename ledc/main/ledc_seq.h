@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LEDC_SEQ_MAX_CHANNEL 8   // 最多同时驱动的 LEDC 通道数
+#define LEDC_SEQ_MAX_KEYFRAME 16 // 每条波形最多的关键帧数
+#define LEDC_SEQ_SUBSEG 4        // 每段关键帧过渡拆成的硬件渐变段数，用折线逼近 gamma 曲线
+#define LEDC_SEQ_LEVEL_MAX 1000  // 亮度满量程（千分比）
+
+/* 关键帧：从上一帧经过 usTimeMs 毫秒过渡到 usLevel 亮度 */
+typedef struct
+{
+    uint16_t usLevel;  // 亮度 0 ~ LEDC_SEQ_LEVEL_MAX（感知亮度，播放时做 gamma 校正）
+    uint16_t usTimeMs; // 过渡时间，第 0 帧的时间用于循环时从最后一帧回到第 0 帧
+} LedcSeqKeyframe_t;
+
+/* 波形 */
+typedef struct
+{
+    const LedcSeqKeyframe_t *pxFrames; // 关键帧数组
+    uint8_t ucFrameNum;                // 关键帧个数
+    uint8_t ucLoop;                    // 1：循环播放，0：播放一次后停在最后一帧
+} LedcSeqWave_t;
+
+/* 序列器全局配置，所有通道共用一个定时器 */
+typedef struct
+{
+    ledc_timer_t xTimer;        // 使用的定时器
+    ledc_timer_bit_t xDutyRes;  // 占空比分辨率
+    uint32_t ulFreqHz;          // PWM 频率
+    float fGamma;               // gamma 值，一般取 2.2，<= 0 时按 1.0（线性）处理
+} LedcSeqConfig_t;
+
+/** 初始化波形序列器，接管 LEDC 低速模式的渐变中断
+ * 注意：使用序列器后不能再调用 ledc_fade_func_install，两者都需要渐变完成中断
+ * @param pxConfig 配置
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqInit(const LedcSeqConfig_t *pxConfig);
+
+/** 添加一个 LED 通道
+ * @param xChannel LEDC 通道
+ * @param xGpio 输出管脚
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqAddChannel(ledc_channel_t xChannel, gpio_num_t xGpio);
+
+/** 在某个通道上播放波形
+ * 波形在调用时一次性拆成硬件渐变段，之后每段结束由中断直接装载下一段，不再唤醒任何任务
+ * @param xChannel LEDC 通道
+ * @param pxWave 波形，调用返回后即可释放
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqPlay(ledc_channel_t xChannel, const LedcSeqWave_t *pxWave);
+
+/** 呼吸效果：亮度从 0 渐变到最大再回到 0，循环
+ * @param xChannel LEDC 通道
+ * @param ulPeriodMs 一个呼吸周期（ms）
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqBreathe(ledc_channel_t xChannel, uint32_t ulPeriodMs);
+
+/** 脉冲效果：快速点亮、缓慢熄灭、熄灭保持，循环
+ * @param xChannel LEDC 通道
+ * @param ulPeriodMs 一个脉冲周期（ms）
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqPulse(ledc_channel_t xChannel, uint32_t ulPeriodMs);
+
+/** 停止波形并保持某个亮度
+ * @param xChannel LEDC 通道
+ * @param usLevel 亮度 0 ~ LEDC_SEQ_LEVEL_MAX
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedcSeqStop(ledc_channel_t xChannel, uint16_t usLevel);
+
+#ifdef __cplusplus
+}
+#endif
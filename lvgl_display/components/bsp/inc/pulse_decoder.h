@@ -0,0 +1,65 @@
+#ifndef _PULSE_DECODER_H_
+#define _PULSE_DECODER_H_
+
+#include <stdint.h>
+#include "driver/rmt_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PULSE_DEC_MAX_BITS 64 // 一帧最多的数据位数
+
+/*
+ * 单总线脉宽解码器：每一位由一段固定宽度的低电平加一段高电平组成，高电平的长短决定 0 / 1
+ * （DHT11 / DHT22 / AM2301 等传感器都是这种格式）
+	1、宽度小于 usGlitchUs 的脉冲视为毛刺，并入相邻电平
+	2、按查表状态机把 低电平 + 高电平 配成一位，时序超出范围时丢弃已收到的位重新同步
+	3、取最后 ucBitNum 位，按这些位高电平宽度的最大最小值中点作为自适应阈值判定 0 / 1
+ */
+
+/* 解码配置，时间单位与 RMT 分辨率相同（一般为 us） */
+typedef struct
+{
+    uint16_t usLowMin, usLowMax;   // 每一位前导低电平的有效范围
+    uint16_t usHighMin, usHighMax; // 数据高电平的有效范围
+    uint16_t usGlitchUs;           // 小于这个宽度的脉冲视为毛刺
+    uint16_t usThreshold;          // 高电平宽度差别不足 usMinSpread 时（全 0 或全 1）使用的固定阈值
+    uint16_t usMinSpread;          // 启用自适应阈值所需的最小宽度差
+    uint8_t ucBitNum;              // 一帧的数据位数，不超过 PULSE_DEC_MAX_BITS
+} PulseDecConfig_t;
+
+/* 解码结果 */
+typedef enum
+{
+    PULSE_DEC_OK = 0,      // 成功
+    PULSE_DEC_ERR_NO_DATA, // 没有收到任何有效位
+    PULSE_DEC_ERR_BITS,    // 有效位数不足
+} PulseDecErr_t;
+
+/* 一次解码的统计信息 */
+typedef struct
+{
+    uint16_t usBitNum;    // 同步后收到的有效位数
+    uint16_t usExtraBits; // 多出的位数（在有效数据之前，被丢弃）
+    uint16_t usGlitch;    // 被并入相邻电平的毛刺个数
+    uint16_t usResync;    // 因时序超出范围而重新同步的次数
+    uint16_t usThreshold; // 本次实际使用的 0 / 1 判定阈值
+} PulseDecInfo_t;
+
+/** 解码一段 RMT 接收到的脉冲
+ * 可以在中断中调用，不分配内存、不打印日志
+ * @param pxConfig 解码配置
+ * @param pxItem RMT 符号数组
+ * @param iItemNum 符号个数
+ * @param pucOut 输出数据，高位在前，长度为 (ucBitNum + 7) / 8 字节
+ * @param pxInfo 输出统计信息，可以为 NULL
+ * @return PULSE_DEC_OK or 失败原因
+ */
+PulseDecErr_t xPulseDecode(const PulseDecConfig_t *pxConfig, const rmt_symbol_word_t *pxItem, int iItemNum, uint8_t *pucOut, PulseDecInfo_t *pxInfo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
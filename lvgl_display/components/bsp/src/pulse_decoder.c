@@ -0,0 +1,182 @@
+#include <string.h>
+#include "pulse_decoder.h"
+
+/* 合并毛刺后的脉冲分类 */
+typedef enum
+{
+	PULSE_LOW_OK = 0, // 低电平，宽度在数据位前导范围内
+	PULSE_LOW_BAD,	  // 低电平，宽度超出范围（应答信号、干扰等）
+	PULSE_HIGH_OK,	  // 高电平，宽度在数据范围内
+	PULSE_HIGH_BAD,	  // 高电平，宽度超出范围
+	PULSE_CLASS_NUM,
+} PulseClass_t;
+
+/* 状态机状态 */
+typedef enum
+{
+	DEC_WAIT_LOW = 0, // 等待一位的前导低电平
+	DEC_WAIT_HIGH,	  // 等待一位的数据高电平
+	DEC_STATE_NUM,
+} DecState_t;
+
+/* 状态机动作 */
+typedef enum
+{
+	DEC_ACT_NONE = 0, // 无动作
+	DEC_ACT_STORE,	  // 记录一位的高电平宽度
+	DEC_ACT_RESYNC,	  // 丢弃已收到的位，重新同步
+} DecAction_t;
+
+typedef struct
+{
+	uint8_t ucNext;	  // 下一个状态
+	uint8_t ucAction; // 动作
+} DecTransition_t;
+
+/* 状态转移表 [当前状态][脉冲分类] */
+static const DecTransition_t s_xDecTable[DEC_STATE_NUM][PULSE_CLASS_NUM] = {
+	[DEC_WAIT_LOW] = {
+		[PULSE_LOW_OK] = {DEC_WAIT_HIGH, DEC_ACT_NONE},
+		[PULSE_LOW_BAD] = {DEC_WAIT_LOW, DEC_ACT_RESYNC},
+		[PULSE_HIGH_OK] = {DEC_WAIT_LOW, DEC_ACT_NONE},	 // 帧头的应答高电平
+		[PULSE_HIGH_BAD] = {DEC_WAIT_LOW, DEC_ACT_NONE}, // 释放总线后的上拉高电平
+	},
+	[DEC_WAIT_HIGH] = {
+		[PULSE_LOW_OK] = {DEC_WAIT_HIGH, DEC_ACT_RESYNC},
+		[PULSE_LOW_BAD] = {DEC_WAIT_LOW, DEC_ACT_RESYNC},
+		[PULSE_HIGH_OK] = {DEC_WAIT_LOW, DEC_ACT_STORE},
+		[PULSE_HIGH_BAD] = {DEC_WAIT_LOW, DEC_ACT_RESYNC},
+	},
+};
+
+/* 解码过程中的上下文，放在调用者的栈上 */
+typedef struct
+{
+	const PulseDecConfig_t *pxConfig;
+	PulseDecInfo_t xInfo;
+	int iBitNum;					   // 一帧的数据位数
+	uint8_t ucState;				   // 状态机状态
+	int iBits;						   // 同步后收到的位数
+	uint16_t usHigh[PULSE_DEC_MAX_BITS]; // 最后 ucBitNum 位的高电平宽度，环形存放
+	uint32_t ulLevel;				   // 当前正在累计的电平
+	uint32_t ulDuration;			   // 当前电平累计的宽度，0 表示还没有
+} PulseDecCtx_t;
+
+/* 一段完整的电平送入状态机 */
+static void prvPulseEmit(PulseDecCtx_t *pxCtx, uint32_t ulLevel, uint32_t ulDuration)
+{
+	const PulseDecConfig_t *pxConfig = pxCtx->pxConfig;
+	uint8_t ucClass;
+	if (ulLevel)
+		ucClass = (ulDuration >= pxConfig->usHighMin && ulDuration <= pxConfig->usHighMax) ? PULSE_HIGH_OK : PULSE_HIGH_BAD;
+	else
+		ucClass = (ulDuration >= pxConfig->usLowMin && ulDuration <= pxConfig->usLowMax) ? PULSE_LOW_OK : PULSE_LOW_BAD;
+
+	const DecTransition_t *pxTrans = &s_xDecTable[pxCtx->ucState][ucClass];
+	switch (pxTrans->ucAction){
+	case DEC_ACT_STORE:
+		pxCtx->usHigh[pxCtx->iBits % pxCtx->iBitNum] = ulDuration;
+		pxCtx->iBits++;
+		break;
+	case DEC_ACT_RESYNC:
+		/* 帧头之前的干扰不算重新同步 */
+		if (pxCtx->iBits)
+			pxCtx->xInfo.usResync++;
+		pxCtx->iBits = 0;
+		break;
+	default:
+		break;
+	}
+	pxCtx->ucState = pxTrans->ucNext;
+}
+
+/* 送入半个 RMT 符号，毛刺并入当前电平，相同电平合并 */
+static inline void prvPulseFeed(PulseDecCtx_t *pxCtx, uint32_t ulLevel, uint32_t ulDuration)
+{
+	if (ulDuration < pxCtx->pxConfig->usGlitchUs){
+		pxCtx->xInfo.usGlitch++;
+		if (pxCtx->ulDuration)
+			pxCtx->ulDuration += ulDuration;
+		return;
+	}
+	if (pxCtx->ulDuration && ulLevel == pxCtx->ulLevel){
+		pxCtx->ulDuration += ulDuration;
+		return;
+	}
+	if (pxCtx->ulDuration)
+		prvPulseEmit(pxCtx, pxCtx->ulLevel, pxCtx->ulDuration);
+	pxCtx->ulLevel = ulLevel;
+	pxCtx->ulDuration = ulDuration;
+}
+
+/** 解码一段 RMT 接收到的脉冲
+ * @param pxConfig 解码配置
+ * @param pxItem RMT 符号数组
+ * @param iItemNum 符号个数
+ * @param pucOut 输出数据
+ * @param pxInfo 输出统计信息，可以为 NULL
+ * @return PULSE_DEC_OK or 失败原因
+ */
+PulseDecErr_t xPulseDecode(const PulseDecConfig_t *pxConfig, const rmt_symbol_word_t *pxItem, int iItemNum, uint8_t *pucOut, PulseDecInfo_t *pxInfo)
+{
+	PulseDecCtx_t xCtx;
+	int iBitNum = pxConfig->ucBitNum;
+	PulseDecErr_t xErr = PULSE_DEC_OK;
+	if (iBitNum > PULSE_DEC_MAX_BITS)
+		iBitNum = PULSE_DEC_MAX_BITS;
+	if (iBitNum == 0)
+		iBitNum = 1;
+	memset(&xCtx, 0, sizeof(xCtx));
+	xCtx.pxConfig = pxConfig;
+	xCtx.iBitNum = iBitNum;
+
+	/* 宽度为 0 表示接收结束（空闲电平），后面的数据无效 */
+	for (int i = 0; i < iItemNum; i++, pxItem++){
+		if (!pxItem->duration0)
+			break;
+		prvPulseFeed(&xCtx, pxItem->level0, pxItem->duration0);
+		if (!pxItem->duration1)
+			break;
+		prvPulseFeed(&xCtx, pxItem->level1, pxItem->duration1);
+	}
+	if (xCtx.ulDuration)
+		prvPulseEmit(&xCtx, xCtx.ulLevel, xCtx.ulDuration);
+
+	xCtx.xInfo.usBitNum = xCtx.iBits;
+	if (!xCtx.iBits){
+		xErr = PULSE_DEC_ERR_NO_DATA;
+		goto out;
+	}
+	if (xCtx.iBits < iBitNum){
+		xErr = PULSE_DEC_ERR_BITS;
+		goto out;
+	}
+	xCtx.xInfo.usExtraBits = xCtx.iBits - iBitNum;
+
+	/* 自适应阈值：取最长和最短高电平的中点，全 0 或全 1 时使用固定阈值 */
+	uint16_t usMin = UINT16_MAX, usMax = 0;
+	for (int i = 0; i < iBitNum; i++){
+		if (xCtx.usHigh[i] < usMin)
+			usMin = xCtx.usHigh[i];
+		if (xCtx.usHigh[i] > usMax)
+			usMax = xCtx.usHigh[i];
+	}
+	uint16_t usThreshold = pxConfig->usThreshold;
+	if (usMax - usMin >= pxConfig->usMinSpread)
+		usThreshold = (usMin + usMax) / 2;
+	xCtx.xInfo.usThreshold = usThreshold;
+
+	/* 从环形缓存中最早的一位开始，高位在前 */
+	memset(pucOut, 0, (iBitNum + 7) / 8);
+	int iIndex = xCtx.iBits % iBitNum;
+	for (int i = 0; i < iBitNum; i++){
+		if (xCtx.usHigh[iIndex] > usThreshold)
+			pucOut[i / 8] |= 0x80 >> (i % 8);
+		if (++iIndex == iBitNum)
+			iIndex = 0;
+	}
+out:
+	if (pxInfo)
+		*pxInfo = xCtx.xInfo;
+	return xErr;
+}
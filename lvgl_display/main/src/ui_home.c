@@ -64,22 +64,41 @@ void vLightSliderEventCallback(lv_event_t *e)
     }
 }
 
+/* DHT11 最近一次采集结果，由采集完成回调写入，LVGL 定时器读取 */
+static volatile int s_iDht11Ready = 0;
+static volatile int s_iDht11Temp = 0;
+static volatile int s_iDht11Humidity = 0;
+
+/**
+ * @brief DHT11 采集完成回调函数（可能在中断中执行），只记录数据，界面在 LVGL 定时器中更新
+ */
+static bool prvDht11DoneCallback(int iResult, int iTempX10, int iHumidity, void *pvArg)
+{
+    if (iResult){
+        s_iDht11Temp = iTempX10;
+        s_iDht11Humidity = iHumidity;
+        s_iDht11Ready = 1;
+    }
+    return false;
+}
+
 /**
  * @brief DHT11 传感器数据获取定时器回调函数
  *
  * 该函数作为LVGL定时器的回调函数，定期读取 DHT11 温湿度传感器的数据，
  * 并将温度和湿度值显示在对应的标签控件上。
+ * 采集是异步的：本次回调显示上一次采集的结果，再启动下一次采集，不会阻塞 LVGL 任务。
  *
  * @param t 定时器句柄指针，指向触发此回调的定时器对象
  */
 void vDht11TimerCallback(struct _lv_timer_t *t)
 {
-    int iTemp;
-    int iHumidity;
-
-    /* 尝试获取 DHT11 传感器的温湿度数据 */
-    if (iDht11StartGet(&iTemp, &iHumidity)){
+    /* 显示上一次采集到的 DHT11 传感器温湿度数据 */
+    if (s_iDht11Ready){
         char cDisplayBuffer[32];
+        int iTemp = s_iDht11Temp;
+        int iHumidity = s_iDht11Humidity;
+        s_iDht11Ready = 0;
         /* 格式化温度值并更新温度标签显示 */
         //ESP_LOGI("DHT11", "Temperature: %.1f C", (float)iTemp / 10.0);
         snprintf(cDisplayBuffer, sizeof(cDisplayBuffer), "%.1f", (float)iTemp / 10.0);
@@ -89,6 +108,8 @@ void vDht11TimerCallback(struct _lv_timer_t *t)
         snprintf(cDisplayBuffer, sizeof(cDisplayBuffer), "%d%%", iHumidity);
         lv_label_set_text(pxHumidityLabel, cDisplayBuffer);
     }
+    /* 启动下一次采集，立即返回 */
+    xDht11StartAsync(prvDht11DoneCallback, NULL);
 }
 
 void vUIHomeCreate(void)
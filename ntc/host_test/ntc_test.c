@@ -0,0 +1,183 @@
+/*
+ * NTC 温度查找表的主机测试
+ *  1、精度：全部 ADC 码(含小数位)经查找表得到的温度，与浮点路径(校准电压 -> 电阻 -> NTC表插值 / Steinhart-Hart)比较
+ *  2、--bench N：查找表与原来逐点 校准 + 除法求电阻 + get_ntc_temp 的耗时对比
+ * ntc.c 由本文件直接包含，以便调用其中的静态函数
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ntc.c"
+
+#define TEST_MAX_ERR_X100   5       //测量范围内查找表允许的最大误差，0.05 ℃
+#define TEST_FULL_ERR_X100  50      //全部 ADC 码上允许的最大误差(两端曲线很陡，节点间插值误差大)，0.5 ℃
+#define TEST_RANGE_MIN      -9      //测量范围：NTC 表两端各留 1 ℃，表外温度被钳位，拐点附近一个节点间隔内插值会抹圆
+#define TEST_RANGE_MAX      49
+#define TEST_CALI_OFFSET    142     //校准曲线：电压(mV) = 偏移 + raw * 斜率，与 ESP32 12dB 衰减的典型值接近
+#define TEST_CALI_FULL      3110    //raw 为 4095 时的电压
+
+/*---------------- adc_scan 替身 ----------------*/
+int adc_scan_add_channel(const adc_scan_chan_cfg_t *cfg)
+{
+    return 0;
+}
+
+int adc_scan_read(int id, uint16_t *buf, int max_num)
+{
+    return 0;
+}
+
+uint32_t adc_scan_get_freq(int id)
+{
+    return 0;
+}
+
+//与 esp_adc_cali 一样按整数毫伏输出
+esp_err_t adc_scan_raw_to_voltage(int id, int raw, int *voltage)
+{
+    *voltage = TEST_CALI_OFFSET + raw * (TEST_CALI_FULL - TEST_CALI_OFFSET) / 4095;
+    return ESP_OK;
+}
+
+/** 浮点参考路径：ADC 值(可带小数) -> 电压 -> 电阻 -> 温度，不经过查找表
+ * @param raw ADC 值
+ * @return 温度
+*/
+static double ref_temp(double raw)
+{
+    double voltage = TEST_CALI_OFFSET + raw * (TEST_CALI_FULL - TEST_CALI_OFFSET) / 4095.0;
+    if (voltage >= ADC_V_MAX)
+        voltage = ADC_V_MAX - 1;
+    double res = voltage * NTC_RES / (ADC_V_MAX - voltage);
+#if NTC_USE_STEINHART
+    double ln_r = log(res);
+    return 1.0 / (NTC_SH_A + NTC_SH_B * ln_r + NTC_SH_C * ln_r * ln_r * ln_r) - 273.15;
+#else
+    //按电阻在表中线性插值，超出表的范围取端点温度
+    if (res >= s_ntc_table[0].res)
+        return s_ntc_table[0].temp;
+    for (int i = 1; i < s_us_ntc_table_num; i++)
+    {
+        if (res >= s_ntc_table[i].res)
+        {
+            double k = (res - s_ntc_table[i - 1].res) / ((double)s_ntc_table[i].res - s_ntc_table[i - 1].res);
+            return s_ntc_table[i - 1].temp + k * (s_ntc_table[i].temp - s_ntc_table[i - 1].temp);
+        }
+    }
+    return s_ntc_table[s_us_ntc_table_num - 1].temp;
+#endif
+}
+
+/** 遍历全部 ADC 码和小数位，分别统计测量范围内和全部码值上查找表与参考路径的误差
+ * @param 无
+ * @return 失败个数
+*/
+static int test_accuracy(void)
+{
+    const uint32_t raw_q_max = 4095u << NTC_RAW_FRAC_BITS;
+    const char *mode = NTC_USE_STEINHART ? "steinhart" : "table";
+    double max_err = 0, range_err = 0, sum_sq = 0, worst_temp = 0;
+    uint32_t num = 0, range_num = 0;
+    int fail = 0;
+    for (uint32_t raw_q = 0; raw_q <= raw_q_max; raw_q++)
+    {
+        double ref = ref_temp((double)raw_q / (1 << NTC_RAW_FRAC_BITS));
+        //查找表节点限制在 ±327 ℃，参考路径同样限制
+        if (ref > 327.0)
+            ref = 327.0;
+        else if (ref < -327.0)
+            ref = -327.0;
+        double err = fabs(ntc_raw_to_temp_x100(raw_q) / 100.0 - ref);
+        num++;
+        if (err > max_err)
+        {
+            max_err = err;
+            worst_temp = ref;
+        }
+        if (ref < TEST_RANGE_MIN || ref > TEST_RANGE_MAX)
+            continue;
+        range_num++;
+        sum_sq += err * err;
+        if (err > range_err)
+            range_err = err;
+    }
+    printf("accuracy (%s): %d~%d C: %u codes, max err %.4f C, rms %.4f C; all %u codes: max err %.4f C at %.2f C\n",
+           mode, TEST_RANGE_MIN, TEST_RANGE_MAX, range_num, range_err, sqrt(sum_sq / range_num),
+           num, max_err, worst_temp);
+    if (range_err * 100 > TEST_MAX_ERR_X100)
+    {
+        printf("max err in range exceeds %.2f C\n", TEST_MAX_ERR_X100 / 100.0);
+        fail++;
+    }
+    if (max_err * 100 > TEST_FULL_ERR_X100)
+    {
+        printf("max err exceeds %.2f C\n", TEST_FULL_ERR_X100 / 100.0);
+        fail++;
+    }
+    return fail;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** 原来的转换路径：校准得到电压，除法求电阻，再按 NTC 表二分查找插值(或 Steinhart-Hart 公式)
+ * @param raw ADC 值
+ * @return 温度
+*/
+static float old_raw_to_temp(int raw)
+{
+    int voltage = 0;
+    adc_scan_raw_to_voltage(s_ntc_scan_id, raw, &voltage);
+    if (voltage >= ADC_V_MAX)
+        voltage = ADC_V_MAX - 1;
+    return ntc_res_to_temp(((uint32_t)voltage * NTC_RES) / (ADC_V_MAX - voltage));
+}
+
+/** 对比两条转换路径的耗时，输入为同一组伪随机 ADC 值
+ * @param loop 转换次数
+ * @return 失败个数
+*/
+static int test_bench(int loop)
+{
+    enum { RAW_NUM = 4096 };
+    static uint16_t raw[RAW_NUM];
+    volatile float sink_f = 0;
+    volatile int32_t sink_i = 0;
+    uint32_t seed = 1;
+    for (int i = 0; i < RAW_NUM; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        raw[i] = 800 + (seed >> 16) % 2500;     //约 -5 ℃ ~ 60 ℃
+    }
+
+    double start = now_s();
+    for (int i = 0; i < loop; i++)
+        sink_f += old_raw_to_temp(raw[i % RAW_NUM]);
+    double old_ns = (now_s() - start) * 1e9 / loop;
+
+    start = now_s();
+    for (int i = 0; i < loop; i++)
+        sink_i += ntc_raw_to_temp_x100((uint32_t)raw[i % RAW_NUM] << NTC_RAW_FRAC_BITS);
+    double lut_ns = (now_s() - start) * 1e9 / loop;
+
+    (void)sink_f;
+    (void)sink_i;
+    printf("bench (%s): old path %.1f ns/conv, lut %.1f ns/conv, %.1fx\n",
+           NTC_USE_STEINHART ? "steinhart" : "table", old_ns, lut_ns, old_ns / lut_ns);
+    return lut_ns < old_ns ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+    temp_ntc_init();
+    fail += test_accuracy();
+    if (argc > 2 && !strcmp(argv[1], "--bench"))
+        fail += test_bench(atoi(argv[2]));
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+/*
+ * sensor_filter.h 的主机测试
+ *  1、排序网络中值与暴力排序结果比较(3/5/7 穷举，其他长度随机)
+ *  2、Hampel 剔除尖峰、滑动平均 / 指数平均的阶跃响应、卡尔曼收敛
+ *  3、--bench N：每种滤波器处理 N 个点的耗时
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "sensor_filter.h"
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __func__, __LINE__); printf(__VA_ARGS__); printf("\n"); return 1; } } while (0)
+
+static uint32_t s_seed = 1;
+
+//可复现的伪随机数
+static uint32_t rand_u32(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 8;
+}
+
+//近似正态分布的噪声，标准差约为 sigma
+static int32_t rand_noise(int32_t sigma)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < 12; i++)
+        sum += rand_u32() % 1024;
+    return (int32_t)(((int64_t)(sum - 6 * 1023) * sigma) / 1024);
+}
+
+static int cmp_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+//暴力排序求中值
+static int32_t brute_median(const int32_t *p, int n)
+{
+    int32_t tmp[FILTER_WIN_MAX];
+    memcpy(tmp, p, n * sizeof(int32_t));
+    qsort(tmp, n, sizeof(int32_t), cmp_i32);
+    return tmp[n / 2];
+}
+
+/** 排序网络中值：3/5/7 个数在 0..3 上穷举(覆盖所有大小关系和重复值)，其他长度随机
+ * @param 无
+ * @return 失败个数
+*/
+static int test_median(void)
+{
+    int32_t v[FILTER_WIN_MAX];
+    for (int n = 3; n <= 7; n += 2)
+    {
+        int total = 1 << (2 * n);
+        for (int code = 0; code < total; code++)
+        {
+            for (int i = 0; i < n; i++)
+                v[i] = (code >> (2 * i)) & 3;
+            int32_t expect = brute_median(v, n);
+            int32_t got = n == 3 ? filter_median3(v[0], v[1], v[2]) : n == 5 ? filter_median5(v) : filter_median7(v);
+            CHECK(got == expect, "median%d code %d: %d != %d", n, code, (int)got, (int)expect);
+            CHECK(filter_median_n(v, n) == expect, "median_n(%d) code %d", n, code);
+        }
+    }
+    for (int n = 1; n <= FILTER_WIN_MAX; n += 2)
+    {
+        for (int round = 0; round < 20000; round++)
+        {
+            for (int i = 0; i < n; i++)
+                v[i] = (int32_t)(rand_u32() % 2001) - 1000;
+            int32_t expect = brute_median(v, n);
+            int32_t copy[FILTER_WIN_MAX];
+            memcpy(copy, v, sizeof(copy));
+            CHECK(filter_median_n(v, n) == expect, "median_n(%d) random", n);
+            CHECK(!memcmp(copy, v, sizeof(copy)), "median_n(%d) modified input", n);
+        }
+    }
+
+    //滑动窗口中值：窗口未满时是已有点的中值，满了之后是最近 len 个点的中值
+    int32_t buf[7], hist[64];
+    filter_median_t med;
+    filter_median_init(&med, buf, 7);
+    for (int i = 0; i < 64; i++)
+    {
+        hist[i] = (int32_t)(rand_u32() % 100);
+        int num = i + 1 < 7 ? i + 1 : 7;
+        int32_t expect = brute_median(&hist[i + 1 - num], num);
+        CHECK(filter_median_update(&med, hist[i]) == expect, "median window at %d", i);
+    }
+    printf("median: ok\n");
+    return 0;
+}
+
+/** Hampel：缓慢变化的带噪信号上叠加孤立尖峰，尖峰被替换、正常点原样输出(延迟 len/2)
+ * @param 无
+ * @return 失败个数
+*/
+static int test_hampel(void)
+{
+    enum { LEN = 7, NUM = 2000, SPIKE_EVERY = 37 };
+    int32_t buf[LEN], x[NUM];
+    int spikes = 0, kept = 0, replaced_normal = 0;
+    filter_hampel_t f;
+    filter_hampel_init(&f, buf, LEN, 3 * 256, 20);
+    for (int i = 0; i < NUM; i++)
+    {
+        x[i] = 1000 + i / 4 + rand_noise(5);
+        if (i % SPIKE_EVERY == SPIKE_EVERY - 1)
+        {
+            x[i] += (i & 64) ? 3000 : -3000;
+            spikes++;
+        }
+    }
+    for (int i = 0; i < NUM; i++)
+    {
+        int32_t y = filter_hampel_update(&f, x[i]);
+        int c = i - LEN / 2;
+        if (i < LEN - 1)
+            continue;
+        bool spike = c % SPIKE_EVERY == SPIKE_EVERY - 1;
+        if (spike)
+            CHECK(y < 1000 + NUM / 4 + 100 && y > 900, "spike at %d not removed: %d", c, (int)y);
+        else if (y == x[c])
+            kept++;
+        else
+            replaced_normal++;
+    }
+    //窗口填满之前和最后 len/2 个点没有被判定
+    CHECK(f.outliers >= (uint32_t)spikes - 1 && f.outliers <= (uint32_t)spikes, "outliers %u, spikes %d", (unsigned)f.outliers, spikes);
+    CHECK(replaced_normal == 0, "%d normal points replaced", replaced_normal);
+    printf("hampel: %u/%d spikes removed, %d points kept\n", (unsigned)f.outliers, spikes, kept);
+    return 0;
+}
+
+/** 滑动平均和指数平均的阶跃响应
+ * @param 无
+ * @return 失败个数
+*/
+static int test_step(void)
+{
+    enum { STEP = 1000 };
+    int32_t buf[8];
+    filter_ma_t ma;
+    filter_ma_init(&ma, buf, 8);
+    for (int i = 0; i < 8; i++)
+        CHECK(filter_ma_update(&ma, 0) == 0, "ma settle");
+    //第 k 个阶跃点之后输出为 k*STEP/len(四舍五入)，len 个点后等于阶跃值
+    for (int k = 1; k <= 16; k++)
+    {
+        int32_t expect = (k >= 8 ? 8 : k) * STEP / 8;
+        CHECK(filter_ma_update(&ma, STEP) == expect, "ma step k=%d", k);
+    }
+    filter_ma_init(&ma, buf, 3);
+    CHECK(filter_ma_update(&ma, -5) == -5 && filter_ma_update(&ma, -6) == -6, "ma negative rounding");
+
+    for (uint8_t shift = 1; shift <= 6; shift++)
+    {
+        filter_ema_t ema;
+        filter_ema_init(&ema, shift);
+        CHECK(filter_ema_update(&ema, 0) == 0, "ema first point");
+        double alpha = 1.0 / (1 << shift), ideal = 0;
+        int settle = -1;
+        for (int k = 1; k <= 1000; k++)
+        {
+            int32_t y = filter_ema_update(&ema, STEP);
+            ideal += alpha * (STEP - ideal);
+            CHECK(abs(y - (int32_t)(ideal + 0.5)) <= 1, "ema shift %d k %d: %d vs %.1f", shift, k, (int)y, ideal);
+            if (settle < 0 && y == STEP)
+                settle = k;
+        }
+        CHECK(settle > 0, "ema shift %d never reached the step", shift);
+        //第一个点直接输出，不从 0 爬升
+        filter_ema_init(&ema, shift);
+        CHECK(filter_ema_update(&ema, STEP) == STEP, "ema first point");
+        printf("ema shift %d: reaches step after %d points\n", shift, settle);
+    }
+    return 0;
+}
+
+/** 卡尔曼：常值加噪声时收敛到真值且输出噪声明显减小；阶跃后能重新跟上
+ * @param 无
+ * @return 失败个数
+*/
+static int test_kalman(void)
+{
+    enum { TRUE_VALUE = 2500, SIGMA = 40, NUM = 3000 };
+    filter_kalman_t f;
+    filter_kalman_init(&f, 1, SIGMA * SIGMA);
+    double in_sq = 0, out_sq = 0;
+    int n = 0;
+    for (int i = 0; i < NUM; i++)
+    {
+        int32_t z = TRUE_VALUE + rand_noise(SIGMA);
+        int32_t x = filter_kalman_update(&f, z);
+        if (i >= NUM / 2)
+        {
+            in_sq += (double)(z - TRUE_VALUE) * (z - TRUE_VALUE);
+            out_sq += (double)(x - TRUE_VALUE) * (x - TRUE_VALUE);
+            n++;
+        }
+    }
+    double in_rms = sqrt(in_sq / n), out_rms = sqrt(out_sq / n);
+    CHECK(out_rms * 4 < in_rms, "kalman rms %.2f, input rms %.2f", out_rms, in_rms);
+    CHECK(abs(f.x - TRUE_VALUE) < SIGMA / 2, "kalman estimate %d", (int)f.x);
+
+    //过程噪声较大时，阶跃后 50 个点内跟上
+    filter_kalman_init(&f, 400, SIGMA * SIGMA);
+    for (int i = 0; i < 200; i++)
+        filter_kalman_update(&f, rand_noise(SIGMA));
+    int settle = -1;
+    for (int i = 0; i < 200 && settle < 0; i++)
+        if (abs(filter_kalman_update(&f, TRUE_VALUE + rand_noise(SIGMA)) - TRUE_VALUE) < SIGMA)
+            settle = i + 1;
+    CHECK(settle > 0 && settle <= 50, "kalman step settle %d", settle);
+    printf("kalman: input rms %.1f, output rms %.1f, step settles in %d points\n", in_rms, out_rms, settle);
+    return 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define BENCH(name, init, expr) do { \
+        init; \
+        double start = now_s(); \
+        for (int i = 0; i < loop; i++) \
+            sink += (expr); \
+        printf("  %-24s %6.2f ns/point\n", name, (now_s() - start) * 1e9 / loop); \
+    } while (0)
+
+/** 每种滤波器处理 loop 个点的耗时，输入为同一组带噪声的数据
+ * @param loop 点数
+ * @return 无
+*/
+static void bench(int loop)
+{
+    enum { DATA_NUM = 4096 };
+    static int32_t data[DATA_NUM];
+    int32_t buf[FILTER_WIN_MAX];
+    volatile int32_t sink = 0;
+    filter_ma_t ma;
+    filter_ema_t ema;
+    filter_median_t med;
+    filter_hampel_t hampel;
+    filter_kalman_t kalman;
+    for (int i = 0; i < DATA_NUM; i++)
+        data[i] = 1000 + rand_noise(30);
+#define X(i) data[(i) % DATA_NUM]
+    printf("bench, %d points:\n", loop);
+    BENCH("median3", , filter_median3(X(i), X(i + 1), X(i + 2)));
+    BENCH("median5", , filter_median5(&data[i % (DATA_NUM - 8)]));
+    BENCH("median7", , filter_median7(&data[i % (DATA_NUM - 8)]));
+    BENCH("median7 (brute sort)", , brute_median(&data[i % (DATA_NUM - 8)], 7));
+    BENCH("median_n(9)", , filter_median_n(&data[i % (DATA_NUM - 16)], 9));
+    BENCH("ma(8)", filter_ma_init(&ma, buf, 8), filter_ma_update(&ma, X(i)));
+    BENCH("ema(shift 3)", filter_ema_init(&ema, 3), filter_ema_update(&ema, X(i)));
+    BENCH("median window(5)", filter_median_init(&med, buf, 5), filter_median_update(&med, X(i)));
+    BENCH("hampel(7)", filter_hampel_init(&hampel, buf, 7, 768, 20), filter_hampel_update(&hampel, X(i)));
+    BENCH("kalman", filter_kalman_init(&kalman, 4, 900), filter_kalman_update(&kalman, X(i)));
+#undef X
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+    fail += test_median();
+    fail += test_hampel();
+    fail += test_step();
+    fail += test_kalman();
+    if (argc > 2 && !strcmp(argv[1], "--bench"))
+        bench(atoi(argv[2]));
+    if (fail)
+        printf("%d test(s) failed\n", fail);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+#ifndef _HOST_ESP_LOG_H_
+#define _HOST_ESP_LOG_H_
+//主机测试不输出驱动日志，避免影响测试结果的输出
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); } while (0)
+
+#endif
@@ -0,0 +1,5 @@
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+//ntc.c 在主机上不需要 FreeRTOS 的任何定义，只是满足包含关系
+
+#endif
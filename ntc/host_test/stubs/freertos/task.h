@@ -0,0 +1,4 @@
+#ifndef _HOST_TASK_H_
+#define _HOST_TASK_H_
+
+#endif
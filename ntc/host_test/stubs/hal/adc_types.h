@@ -0,0 +1,27 @@
+#ifndef _HOST_ADC_TYPES_H_
+#define _HOST_ADC_TYPES_H_
+//主机测试用的 hal/adc_types.h，位宽与 ESP32 的 soc_caps.h 相同
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH   12
+
+typedef enum
+{
+    ADC_CHANNEL_0,
+    ADC_CHANNEL_1,
+    ADC_CHANNEL_2,
+    ADC_CHANNEL_3,
+    ADC_CHANNEL_4,
+    ADC_CHANNEL_5,
+    ADC_CHANNEL_6,
+    ADC_CHANNEL_7,
+}adc_channel_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_12,
+}adc_atten_t;
+
+#endif
@@ -0,0 +1,333 @@
+#include <string.h>
+#include <stdlib.h>
+#include "adc_scan.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+#define TAG     "adc_scan"
+
+/*
+ * 所有通道组成一个连续转换序列，ADC按总采样率依次转换各通道，结果由DMA搬到内存
+ * 每攒满一帧通知一次扫描任务，任务把帧里的数据按通道号分发到各通道的环形缓存，再调用各通道的回调
+ * 所有模拟量传感器共用这一个任务
+ */
+#define ADC_SCAN_FRAME_SAMPLES  1000                //每帧采样点数(所有通道合计)，任务每帧唤醒一次
+#define ADC_SCAN_FRAME_LEN      (ADC_SCAN_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)    //每帧字节数
+#define ADC_SCAN_FRAME_BUF_NUM  4                   //DMA缓存帧数，任务来不及处理时可以暂存
+#define ADC_SCAN_ATTEN_NUM      4                   //衰减倍数种类
+#define ADC_SCAN_READ_CHUNK     32                  //读取时每次加锁最多拷贝的点数，缩短关中断的时间
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_SCAN_OUTPUT_TYPE        ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_SCAN_GET_CHANNEL(p)     ((p)->type1.channel)
+#define ADC_SCAN_GET_DATA(p)        ((p)->type1.data)
+#else
+#define ADC_SCAN_OUTPUT_TYPE        ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_SCAN_GET_CHANNEL(p)     ((p)->type2.channel)
+#define ADC_SCAN_GET_DATA(p)        ((p)->type2.data)
+#endif
+
+//通道
+typedef struct
+{
+    adc_scan_chan_cfg_t cfg;    //通道配置
+    uint16_t *ring;             //环形缓存
+    uint16_t head;              //写位置
+    uint16_t count;             //缓存中的数据个数
+    uint32_t overflow;          //被覆盖的数据个数
+}adc_scan_chan_t;
+
+static adc_scan_chan_t s_chans[ADC_SCAN_MAX_CHANNEL];
+static int s_chan_num = 0;
+
+//ADC通道号 -> 通道编号
+static int8_t s_chan_map[SOC_ADC_MAX_CHANNEL_NUM];
+
+//各衰减倍数的校准句柄，同样衰减的通道共用
+static adc_cali_handle_t s_cali_handle[ADC_SCAN_ATTEN_NUM];
+static bool s_cali_done[ADC_SCAN_ATTEN_NUM];
+
+//没有校准数据时各衰减倍数对应的满量程电压(mV)
+static const int s_atten_full_mv[ADC_SCAN_ATTEN_NUM] = {950, 1250, 1750, 2450};
+
+//环形缓存锁，每次只保护一个采样点的写入或一小段读取
+static portMUX_TYPE s_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//ADC连续转换句柄
+static adc_continuous_handle_t s_adc_handle = NULL;
+
+//扫描任务句柄，转换完成中断里通知
+static TaskHandle_t s_scan_task_handle = NULL;
+
+//总采样率
+static uint32_t s_sample_freq = 0;
+
+//一帧DMA数据
+static uint8_t s_adc_frame[ADC_SCAN_FRAME_LEN];
+
+/*---------------------------------------------------------------
+        ADC校准方案，创建校准方案后，会从官方预烧录的参数中对采集到的电压进行校准
+---------------------------------------------------------------*/
+static bool example_adc_calibration_init(adc_unit_t unit, adc_atten_t atten, adc_cali_handle_t *out_handle)
+{
+    adc_cali_handle_t handle = NULL;
+    esp_err_t ret = ESP_FAIL;
+    bool calibrated = false;
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    if (!calibrated) {
+        ESP_LOGI(TAG, "calibration scheme version is %s", "Curve Fitting");
+        adc_cali_curve_fitting_config_t cali_config = {
+            .unit_id = unit,
+            .atten = atten,
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
+        if (ret == ESP_OK) {
+            calibrated = true;
+        }
+    }
+#endif
+
+#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    if (!calibrated) {
+        ESP_LOGI(TAG, "calibration scheme version is %s", "Line Fitting");
+        adc_cali_line_fitting_config_t cali_config = {
+            .unit_id = unit,
+            .atten = atten,
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
+        if (ret == ESP_OK) {
+            calibrated = true;
+        }
+    }
+#endif
+
+    *out_handle = handle;
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Calibration Success");
+    } else if (ret == ESP_ERR_NOT_SUPPORTED || !calibrated) {
+        ESP_LOGW(TAG, "eFuse not burnt, skip software calibration");
+    } else {
+        ESP_LOGE(TAG, "Invalid arg or no memory");
+    }
+
+    return calibrated;
+}
+
+/**
+ * 添加一个扫描通道
+ * @param cfg 通道配置
+ * @return 通道编号，失败返回-1
+*/
+int adc_scan_add_channel(const adc_scan_chan_cfg_t *cfg)
+{
+    if (s_adc_handle || s_chan_num >= ADC_SCAN_MAX_CHANNEL)
+        return -1;
+    if (cfg->channel >= SOC_ADC_MAX_CHANNEL_NUM || cfg->atten >= ADC_SCAN_ATTEN_NUM || cfg->ring_len == 0)
+        return -1;
+    if (s_chan_num == 0)
+        memset(s_chan_map, -1, sizeof(s_chan_map));
+    if (s_chan_map[cfg->channel] >= 0)
+        return -1;
+
+    adc_scan_chan_t *chan = &s_chans[s_chan_num];
+    chan->ring = malloc(cfg->ring_len * sizeof(uint16_t));
+    if (!chan->ring)
+        return -1;
+    chan->cfg = *cfg;
+    chan->head = 0;
+    chan->count = 0;
+    chan->overflow = 0;
+
+    //每种衰减倍数只创建一次校准方案
+    if (!s_cali_done[cfg->atten]) {
+        s_cali_done[cfg->atten] = example_adc_calibration_init(ADC_UNIT_1, cfg->atten, &s_cali_handle[cfg->atten]);
+    }
+
+    s_chan_map[cfg->channel] = s_chan_num;
+    return s_chan_num++;
+}
+
+//一帧转换完成的中断回调，只通知任务，不在中断里处理数据
+static bool IRAM_ATTR adc_scan_conv_done_cb(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    BaseType_t must_yield = pdFALSE;
+    vTaskNotifyGiveFromISR(s_scan_task_handle, &must_yield);
+    return (must_yield == pdTRUE);
+}
+
+/** 一个采样值写入通道的环形缓存，满了覆盖最旧的数据
+ * @param chan 通道
+ * @param data 采样值
+ * @return 无
+*/
+static inline void adc_scan_push(adc_scan_chan_t *chan, uint16_t data)
+{
+    portENTER_CRITICAL(&s_ring_lock);
+    chan->ring[chan->head] = data;
+    if (++chan->head >= chan->cfg.ring_len)
+        chan->head = 0;
+    if (chan->count < chan->cfg.ring_len)
+        chan->count++;
+    else
+        chan->overflow++;
+    portEXIT_CRITICAL(&s_ring_lock);
+}
+
+/** 把一帧数据按通道号分发到各通道的环形缓存
+ * 一帧有上千个点，整帧加锁会长时间关中断，所以解析在锁外，只有写入环形缓存时加锁
+ * @param buf 帧数据
+ * @param len 帧字节数
+ * @return 无
+*/
+static void adc_scan_demux(const uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&buf[i];
+        uint32_t channel = ADC_SCAN_GET_CHANNEL(p);
+        if (channel >= SOC_ADC_MAX_CHANNEL_NUM || s_chan_map[channel] < 0)
+            continue;
+        adc_scan_push(&s_chans[s_chan_map[channel]], ADC_SCAN_GET_DATA(p));
+    }
+}
+
+//扫描任务，所有模拟量传感器共用
+static void adc_scan_task(void* param)
+{
+    uint32_t ret_num = 0;
+    while(1)
+    {
+        //等待DMA攒满一帧，期间任务休眠
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        //把已完成的帧全部取出来分发
+        while (adc_continuous_read(s_adc_handle, s_adc_frame, ADC_SCAN_FRAME_LEN, &ret_num, 0) == ESP_OK)
+        {
+            adc_scan_demux(s_adc_frame, ret_num);
+            for (int i = 0; i < s_chan_num; i++)
+            {
+                if (s_chans[i].cfg.cb)
+                    s_chans[i].cfg.cb(i, s_chans[i].cfg.arg);
+            }
+        }
+    }
+}
+
+/**
+ * 开始扫描
+ * @param sample_freq_hz 总采样率
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t adc_scan_start(uint32_t sample_freq_hz)
+{
+    adc_digi_pattern_config_t adc_pattern[ADC_SCAN_MAX_CHANNEL] = {0};
+    if (s_adc_handle || s_chan_num == 0)
+        return ESP_FAIL;
+
+    adc_continuous_handle_cfg_t adc_config = {
+        .max_store_buf_size = ADC_SCAN_FRAME_LEN * ADC_SCAN_FRAME_BUF_NUM,  //DMA缓存大小
+        .conv_frame_size = ADC_SCAN_FRAME_LEN,                              //每帧大小，攒满一帧产生一次中断
+    };
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&adc_config, &s_adc_handle));
+
+    //每个通道一个转换项，衰减倍数各自独立
+    for (int i = 0; i < s_chan_num; i++)
+    {
+        adc_pattern[i].unit = ADC_UNIT_1;                   //WIFI和ADC2无法同时启用，这里选择ADC1
+        adc_pattern[i].channel = s_chans[i].cfg.channel;
+        adc_pattern[i].atten = s_chans[i].cfg.atten;
+        adc_pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = s_chan_num,
+        .adc_pattern = adc_pattern,
+        .sample_freq_hz = sample_freq_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_SCAN_OUTPUT_TYPE,
+    };
+    ESP_ERROR_CHECK(adc_continuous_config(s_adc_handle, &dig_cfg));
+    s_sample_freq = sample_freq_hz;
+
+    //通道回调在这个任务里执行，栈要留出余量
+    xTaskCreatePinnedToCore(adc_scan_task, "adc_scan", 3072, NULL, 2, &s_scan_task_handle, 1);
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = adc_scan_conv_done_cb,
+    };
+    ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(s_adc_handle, &cbs, NULL));
+    ESP_ERROR_CHECK(adc_continuous_start(s_adc_handle));
+    ESP_LOGI(TAG, "scan %d channels at %lu Hz", s_chan_num, sample_freq_hz);
+    return ESP_OK;
+}
+
+/**
+ * 从通道的环形缓存中取出采样值
+ * @param id 通道编号
+ * @param buf 输出缓存
+ * @param max_num 最多取出的个数
+ * @return 实际取出的个数
+*/
+int adc_scan_read(int id, uint16_t *buf, int max_num)
+{
+    int num = 0;
+    if (id < 0 || id >= s_chan_num)
+        return 0;
+    adc_scan_chan_t *chan = &s_chans[id];
+    //分段加锁拷贝，每段都重新计算最旧的数据位置，两段之间写入的新数据也能读到
+    while (num < max_num)
+    {
+        int chunk = 0;
+        portENTER_CRITICAL(&s_ring_lock);
+        int tail = chan->head - chan->count;
+        if (tail < 0)
+            tail += chan->cfg.ring_len;
+        while (chunk < ADC_SCAN_READ_CHUNK && num < max_num && chan->count > 0)
+        {
+            buf[num++] = chan->ring[tail];
+            if (++tail >= chan->cfg.ring_len)
+                tail = 0;
+            chan->count--;
+            chunk++;
+        }
+        portEXIT_CRITICAL(&s_ring_lock);
+        if (chunk < ADC_SCAN_READ_CHUNK)
+            break;
+    }
+    return num;
+}
+
+/**
+ * 获取通道的采样率
+ * @param id 通道编号
+ * @return 采样率(Hz)
+*/
+uint32_t adc_scan_get_freq(int id)
+{
+    if (id < 0 || id >= s_chan_num)
+        return 0;
+    return s_sample_freq / s_chan_num;
+}
+
+/**
+ * 采样值转换为电压
+ * @param id 通道编号
+ * @param raw 采样值
+ * @param voltage 电压(mV)
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t adc_scan_raw_to_voltage(int id, int raw, int *voltage)
+{
+    if (id < 0 || id >= s_chan_num)
+        return ESP_FAIL;
+    adc_atten_t atten = s_chans[id].cfg.atten;
+    if (s_cali_done[atten])
+        return adc_cali_raw_to_voltage(s_cali_handle[atten], raw, voltage);
+    *voltage = raw * s_atten_full_mv[atten] / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1);
+    return ESP_OK;
+}
@@ -0,0 +1,68 @@
+#ifndef _ADC_SCAN_H_
+#define _ADC_SCAN_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "hal/adc_types.h"
+
+#define ADC_SCAN_MAX_CHANNEL    8       //最多扫描的通道数(ADC1有8个通道)
+
+/**
+ * 新数据回调，在扫描任务中执行，每处理完一帧调用一次
+ * @param id 通道编号(adc_scan_add_channel的返回值)
+ * @param arg 用户参数
+ * @return 无
+*/
+typedef void (*adc_scan_cb_t)(int id, void *arg);
+
+//通道配置
+typedef struct
+{
+    adc_channel_t channel;      //ADC1通道
+    adc_atten_t atten;          //衰减倍数，决定量程，每个通道可以不同
+    uint16_t ring_len;          //环形缓存长度(采样点数)，满了之后覆盖最旧的数据
+    adc_scan_cb_t cb;           //新数据回调，可以为NULL
+    void *arg;                  //回调的用户参数
+}adc_scan_chan_cfg_t;
+
+/**
+ * 添加一个扫描通道，需要在adc_scan_start之前调用
+ * 会为通道创建对应衰减倍数的校准方案
+ * @param cfg 通道配置
+ * @return 通道编号，失败返回-1
+*/
+int adc_scan_add_channel(const adc_scan_chan_cfg_t *cfg);
+
+/**
+ * 开始扫描：所有通道放在一个连续转换序列里由DMA采样，一个任务负责把结果分发到各通道的环形缓存
+ * @param sample_freq_hz 总采样率，每个通道的采样率为 总采样率/通道数
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t adc_scan_start(uint32_t sample_freq_hz);
+
+/**
+ * 从通道的环形缓存中取出采样值
+ * @param id 通道编号
+ * @param buf 输出缓存
+ * @param max_num 最多取出的个数
+ * @return 实际取出的个数
+*/
+int adc_scan_read(int id, uint16_t *buf, int max_num);
+
+/**
+ * 获取通道的采样率
+ * @param id 通道编号
+ * @return 采样率(Hz)，未开始扫描时返回0
+*/
+uint32_t adc_scan_get_freq(int id);
+
+/**
+ * 使用通道的校准方案把采样值转换为电压，没有校准数据时按线性换算
+ * @param id 通道编号
+ * @param raw 采样值
+ * @param voltage 电压(mV)
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t adc_scan_raw_to_voltage(int id, int raw, int *voltage);
+
+#endif
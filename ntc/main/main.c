@@ -8,24 +8,63 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "ntc.h"
+#include "adc_scan.h"
+#include "sensor_hub.h"
 
 #define TAG     "main"
 
+#define ADC_SCAN_FREQ_HZ    20000       //所有模拟量通道的总采样率(ESP32连续模式最低20kHz)
+
+#define NTC_PERIOD_MS       1000        //温度采样周期
+#define NTC_DEADBAND_X100   10          //温度变化超过0.1度才打印
+
+/** 传感器中心读取NTC温度，adc_scan 已经在后台滤波，这里只取当前值
+ * @param values 输出，温度X100
+ * @param arg 无
+ * @return ESP_OK
+*/
+static esp_err_t ntc_read(int32_t *values, void *arg)
+{
+    values[0] = get_temp_x100();
+    return ESP_OK;
+}
+
+/** 温度变化的订阅回调，在传感器中心的任务中执行
+ * @param channel 温度通道
+ * @param sample 采样值，温度X100
+ * @param arg 无
+ * @return 无
+*/
+static void temp_changed(int channel, const sensor_sample_t *sample, void *arg)
+{
+    ESP_LOGI(TAG,"current temp:%.2f",sample->value / 100.0f);
+}
+
 /* 
  * ADC2 和 wifi 蓝牙不能同时用，所以一般使用ADC1。
  * 不是所有IO口都能用作ADC，具体参考datasheet。
- * 单次转换模式，准确度更高，但需要反复执行转换函数。
+ * 这里使用连续转换模式，所有模拟量通道由 adc_scan 统一扫描，DMA 按固定采样率搬运数据，一个任务每帧处理一次。
  * ESP32设计的ADC参考电压为1100mV,只能测量0-1100mV，如果要测量更大范围的电压，需要设置衰减倍数
  */
 void app_main(void)
 {
-    /* 初始化并创建 ADC 转换任务得到温度*/
+    /* 各模拟量传感器先把自己的通道加入扫描序列，再统一开始扫描 */
     temp_ntc_init();
-    while(1)
-    {
-        /* 另起一个函数接口用于返回温度值*/
-        ESP_LOGI(TAG,"current temp:%.2f",get_temp());
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
+    ESP_ERROR_CHECK(adc_scan_start(ADC_SCAN_FREQ_HZ));
 
+    /* 温度由传感器中心按周期读取，变化时通知订阅者 */
+    sensor_desc_t ntc_desc =
+    {
+        .name = "ntc",
+        .period_ms = NTC_PERIOD_MS,
+        .read = ntc_read,
+        .arg = NULL,
+        .chan_num = 1,
+        .chan = {
+            {.name = "temp", .deadband = NTC_DEADBAND_X100},
+        },
+    };
+    int temp_chan = sensor_hub_add(&ntc_desc);
+    sensor_hub_subscribe(1u << temp_chan,temp_changed,NULL);
+    ESP_ERROR_CHECK(sensor_hub_start());
 }
@@ -1,14 +1,13 @@
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include "ntc.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "esp_adc/adc_continuous.h"
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
+#include "adc_scan.h"
+#include "sensor_filter.h"
 
 #define TAG     "adc"
 
@@ -27,17 +26,40 @@ GPIO39  ADC1_CH3
 #define NTC_RES             10000               //NTC电阻标称值(在电路中和NTC一起串进电路的那个电阻,一般是10K，100K)
 #define ADC_V_MAX           3300                //最大接入电压值
 
-#define ADC_VALUE_NUM       10                  //每次采样的电压
+/*
+ * 采样由 adc_scan 负责：所有模拟量通道在一个连续转换序列里由 DMA 采样，共用一个扫描任务
+ * 扫描任务每处理一帧调用一次 ntc_scan_cb，对新数据做 中值(3) + 平均 的抽取滤波，按输出频率更新温度
+ */
+#define NTC_OUTPUT_HZ       10                  //温度输出频率
+#define NTC_RING_LEN        1024                //通道环形缓存长度(采样点数)
+#define NTC_READ_NUM        64                  //每次从环形缓存取出的点数
 
-static bool do_calibration1 = false;            //是否需要校准
+/*
+ * 温度查找表：按原始 ADC 值直接索引，初始化时根据本芯片的校准曲线、分压电阻和 NTC 表（或 Steinhart-Hart 公式）生成
+ * 运行时转换只需一次查表加一次整数插值，不用除法求电阻，也不用浮点
+ */
+#define NTC_LUT_SHIFT       5                   //每 32 个 ADC 码一个节点
+#define NTC_LUT_NUM         ((1 << (SOC_ADC_DIGI_MAX_BITWIDTH - NTC_LUT_SHIFT)) + 1)    //节点数
+#define NTC_RAW_FRAC_BITS   4                   //平均后的 ADC 值保留的小数位
+
+//使用 Steinhart-Hart 公式代替 NTC 表：1/T = A + B*ln(R) + C*ln(R)^3，T 为开尔文温度
+#ifndef NTC_USE_STEINHART
+#define NTC_USE_STEINHART   0
+#endif
+#define NTC_SH_A            1.009249522e-03
+#define NTC_SH_B            2.378405444e-04
+#define NTC_SH_C            2.019202697e-07
 
-static volatile float s_temp_value = 0.0f;      //室内温度
+static volatile int32_t s_temp_x100 = 0;        //室内温度X100
 
+static int16_t s_ntc_lut[NTC_LUT_NUM];          //温度查找表，单位 0.01 ℃
 
-static int s_adc_raw[ADC_VALUE_NUM];            //ADC采样值
-static int s_voltage_raw[ADC_VALUE_NUM];        //转换后的电压值
+static int s_ntc_scan_id = -1;                  //adc_scan通道编号
 
+static int32_t s_median_buf[3];                 //中值滤波窗口
+static filter_median_t s_median;                //中值滤波，去除毛刺
 
+#if !NTC_USE_STEINHART
 typedef struct
 {
     int8_t temp;        //温度
@@ -112,68 +134,18 @@ static const temp_res_t s_ntc_table[] =
 
 //NTC表长度
 static const uint16_t s_us_ntc_table_num = sizeof(s_ntc_table)/sizeof(s_ntc_table[0]);
+#endif
 
-//ADC操作句柄
-static adc_oneshot_unit_handle_t s_adc_handle = NULL;
-
-//转换句柄
-static adc_cali_handle_t adc1_cali_handle = NULL;
-
-//NTC温度采集任务
-static void temp_adc_task(void*);
+//扫描回调，在扫描任务中执行
+static void ntc_scan_cb(int id, void *arg);
 
+#if !NTC_USE_STEINHART
 static float get_ntc_temp(uint32_t res);
-
-/*---------------------------------------------------------------
-        ADC校准方案，创建校准方案后，会从官方预烧录的参数中对采集到的电压进行校准
----------------------------------------------------------------*/
-static bool example_adc_calibration_init(adc_unit_t unit, adc_atten_t atten, adc_cali_handle_t *out_handle)
-{
-    adc_cali_handle_t handle = NULL;
-    esp_err_t ret = ESP_FAIL;
-    bool calibrated = false;
-
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-    if (!calibrated) {
-        ESP_LOGI(TAG, "calibration scheme version is %s", "Curve Fitting");
-        adc_cali_curve_fitting_config_t cali_config = {
-            .unit_id = unit,
-            .atten = atten,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
-        if (ret == ESP_OK) {
-            calibrated = true;
-        }
-    }
-#endif
-
-#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-    if (!calibrated) {
-        ESP_LOGI(TAG, "calibration scheme version is %s", "Line Fitting");
-        adc_cali_line_fitting_config_t cali_config = {
-            .unit_id = unit,
-            .atten = atten,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
-        if (ret == ESP_OK) {
-            calibrated = true;
-        }
-    }
 #endif
 
-    *out_handle = handle;
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Calibration Success");
-    } else if (ret == ESP_ERR_NOT_SUPPORTED || !calibrated) {
-        ESP_LOGW(TAG, "eFuse not burnt, skip software calibration");
-    } else {
-        ESP_LOGE(TAG, "Invalid arg or no memory");
-    }
+static void ntc_lut_init(void);
 
-    return calibrated;
-}
+static int32_t ntc_raw_to_temp_x100(uint32_t raw_q);
 
 /**
  * 温度检测初始化
@@ -182,17 +154,9 @@ static bool example_adc_calibration_init(adc_unit_t unit, adc_atten_t atten, adc
 */
 void temp_ntc_init(void)
 {
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,  //WIFI和ADC2无法同时启用，这里选择ADC1
-    };
-
-    //启用单次转换模式
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config1, &s_adc_handle));
-
-    //-------------ADC1 Config---------------//
-    adc_oneshot_chan_cfg_t config = {
-        .bitwidth = ADC_BITWIDTH_12,       //分辨率
-        .atten = ADC_ATTEN_DB_12,          
+    adc_scan_chan_cfg_t cfg = {
+        .channel = TEMP_ADC_CHANNEL,
+        .atten = ADC_ATTEN_DB_12,
         // 衰减倍数，ESP32设计的ADC参考电压为1100mV,只能测量0-1100mV之间的电压，如果要测量更大范围的电压
         // 需要设置衰减倍数
         /* 以下是对应可测量范围
@@ -201,13 +165,19 @@ void temp_ntc_init(void)
         ADC_ATTEN_DB_6	    150 mV ~ 1750 mV
         ADC_ATTEN_DB_12	    150 mV ~ 2450 mV
         */
+        .ring_len = NTC_RING_LEN,
+        .cb = ntc_scan_cb,
+        .arg = NULL,
     };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(s_adc_handle, TEMP_ADC_CHANNEL, &config));
-    //-------------ADC1 Calibration Init---------------//
-    do_calibration1 = example_adc_calibration_init(ADC_UNIT_1, ADC_ATTEN_DB_12, &adc1_cali_handle);
-
-    //新建一个任务，不断地进行ADC和温度计算
-    xTaskCreatePinnedToCore(temp_adc_task, "adc_task", 2048, NULL, 2, NULL, 1);
+    filter_median_init(&s_median, s_median_buf, 3);
+    //添加到扫描序列，扫描由 adc_scan_start 统一启动
+    s_ntc_scan_id = adc_scan_add_channel(&cfg);
+    if (s_ntc_scan_id < 0) {
+        ESP_LOGE(TAG, "add ntc channel failed");
+        return;
+    }
+    //校准曲线确定后生成温度查找表
+    ntc_lut_init();
 }
 
 /**
@@ -217,48 +187,48 @@ void temp_ntc_init(void)
 */
 float get_temp(void)
 {
-    return s_temp_value;
+    return s_temp_x100 / 100.0f;
 }
 
-static void temp_adc_task(void* param)
+/**
+ * 获取温度值
+ * @param 无
+ * @return 温度X100
+*/
+int32_t get_temp_x100(void)
 {
-    uint16_t adc_cnt = 0;
-    while(1)
+    return s_temp_x100;
+}
+
+/** 扫描回调：取出新数据，连续三点取中值去除毛刺后累加，攒够一个输出周期的点数求平均并查表得到温度
+ * @param id 通道编号
+ * @param arg 用户参数
+ * @return 无
+*/
+static void ntc_scan_cb(int id, void *arg)
+{
+    static uint32_t sum = 0, num = 0;
+    uint16_t buf[NTC_READ_NUM];
+    int n;
+    uint32_t output_num = adc_scan_get_freq(id) / NTC_OUTPUT_HZ;
+    while ((n = adc_scan_read(id, buf, NTC_READ_NUM)) > 0)
     {
-        /* 读取 ADC 值( 0~4096 ) */
-        adc_oneshot_read(s_adc_handle, TEMP_ADC_CHANNEL, &s_adc_raw[adc_cnt]);
-        if (do_calibration1) {
-            /* 将 ADC 值转换为电压( 0~3.3V )*/
-            adc_cali_raw_to_voltage(adc1_cali_handle, s_adc_raw[adc_cnt], &s_voltage_raw[adc_cnt]);
-        }
-        adc_cnt++;
-        if(adc_cnt >= 10)// 采样10次后，计算平均电压值
+        for (int i = 0; i < n; i++)
         {
-            int i = 0;
-            //用平均值进行滤波
-            uint32_t voltage = 0;
-            uint32_t res = 0;
-            for(i = 0;i < ADC_VALUE_NUM;i++)
-            {
-                voltage += s_voltage_raw[i];
-            }
-            voltage = voltage/ADC_VALUE_NUM;
-
-            if(voltage < ADC_V_MAX)
-            {
-                //电压转换为相应的电阻值
-                res = (voltage*NTC_RES)/(ADC_V_MAX-voltage);
-                //根据电阻值查表找出对应的温度
-                s_temp_value = get_ntc_temp(res);
-            }
-
-            adc_cnt = 0;
+            sum += filter_median_update(&s_median, buf[i]);
+            num++;
+            if (num < output_num)
+                continue;
+            //平均值保留小数位，直接查表得到温度
+            uint32_t raw_q = ((sum << NTC_RAW_FRAC_BITS) + num / 2) / num;
+            s_temp_x100 = ntc_raw_to_temp_x100(raw_q);
+            sum = 0;
+            num = 0;
         }
-
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
+#if !NTC_USE_STEINHART
 /** 线性插值，根据一元一次方程两点式，计算出K和B值，然后将X代入方程中计算出Y值
  * 所谓的线性插值，就是已知两点的坐标，由于两点坐标比较接近，将这两点之间的连线认为是一条直线
  * 然后通过这两点计算出这条直线的k和b值，
@@ -285,13 +255,9 @@ static float linera_interpolation(int32_t x,int32_t x1, int32_t x2, int32_t y1,
 static int find_ntc_index(uint32_t  res,uint16_t left, uint16_t right)
 {
     uint16_t middle = (left + right) / 2;
+    //调用者保证 s_ntc_table[left].res > res > s_ntc_table[right].res，相邻时 res 落在 left 和 right 之间
     if (right <= left || left == middle)
-    {
-        if (res >= s_ntc_table[left].res)
-            return left;
-        else
-            return right;
-    }
+        return left;
     if (res > s_ntc_table[middle].res)
     {
         right = middle;
@@ -311,18 +277,75 @@ static float get_ntc_temp(uint32_t res)
 {
     uint16_t left = 0;
     uint16_t right = s_us_ntc_table_num - 1;
+    //超出表的范围取端点温度
+    if (res >= s_ntc_table[left].res)
+        return s_ntc_table[left].temp;
+    if (res <= s_ntc_table[right].res)
+        return s_ntc_table[right].temp;
     int index = find_ntc_index(res,left,right);
     if (res == s_ntc_table[index].res)
         return s_ntc_table[index].temp;
-    if (index == 0 || index == s_us_ntc_table_num - 1)
-    {
-        return s_ntc_table[index].temp;
-    }
-    else
+    int next_index = index + 1;
+    return linera_interpolation(res, 
+        s_ntc_table[index].res, s_ntc_table[next_index].res, 
+        s_ntc_table[index].temp, s_ntc_table[next_index].temp);
+}
+#endif
+
+/** 电阻值转换为温度
+ * @param res 电阻值
+ * @return 温度
+*/
+static float ntc_res_to_temp(uint32_t res)
+{
+#if NTC_USE_STEINHART
+    double ln_r = log((double)res);
+    return (float)(1.0 / (NTC_SH_A + NTC_SH_B * ln_r + NTC_SH_C * ln_r * ln_r * ln_r) - 273.15);
+#else
+    return get_ntc_temp(res);
+#endif
+}
+
+/** 生成温度查找表，每个节点：ADC 值 -> 校准电压 -> 电阻值 -> 温度
+ * 只在初始化时执行一次，这里的除法和浮点运算不影响运行时
+ * @param 无
+ * @return 无
+*/
+static void ntc_lut_init(void)
+{
+    const int raw_max = (1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1;
+    for (int i = 0; i < NTC_LUT_NUM; i++)
     {
-        int next_index = index + 1;
-        return linera_interpolation(res, 
-            s_ntc_table[index].res, s_ntc_table[next_index].res, 
-            s_ntc_table[index].temp, s_ntc_table[next_index].temp);
+        int raw = i << NTC_LUT_SHIFT;
+        int voltage = 0;
+        float temp;
+        if (raw > raw_max)
+            raw = raw_max;
+        adc_scan_raw_to_voltage(s_ntc_scan_id, raw, &voltage);
+        if (voltage >= ADC_V_MAX)
+            voltage = ADC_V_MAX - 1;
+        //电压转换为相应的电阻值，电压越高电阻越大、温度越低
+        temp = ntc_res_to_temp(((uint64_t)voltage * NTC_RES) / (ADC_V_MAX - voltage));
+        if (temp > 327.0f)
+            temp = 327.0f;
+        else if (temp < -327.0f)
+            temp = -327.0f;
+        s_ntc_lut[i] = (int16_t)(temp * 100 + (temp >= 0 ? 0.5f : -0.5f));
     }
 }
+
+/** 原始 ADC 值转换为温度：一次查表加一次整数线性插值
+ * @param raw_q ADC 值，带 NTC_RAW_FRAC_BITS 位小数
+ * @return 温度X100
+*/
+static int32_t ntc_raw_to_temp_x100(uint32_t raw_q)
+{
+    const int shift = NTC_LUT_SHIFT + NTC_RAW_FRAC_BITS;
+    uint32_t index = raw_q >> shift;
+    int32_t frac = raw_q & ((1 << shift) - 1);
+    if (index >= NTC_LUT_NUM - 1)
+        return s_ntc_lut[NTC_LUT_NUM - 1];
+    int32_t t0 = s_ntc_lut[index];
+    int32_t t1 = s_ntc_lut[index + 1];
+    return t0 + (((t1 - t0) * frac) >> shift);
+}
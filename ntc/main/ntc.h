@@ -1,6 +1,8 @@
 #ifndef _NTC_H_
 #define _NTC_H_
 
+#include <stdint.h>
+
 
 /**
  * 温度检测初始化
@@ -16,4 +18,11 @@ void temp_ntc_init(void);
 */
 float get_temp(void);
 
+/**
+ * 获取温度值（定点）
+ * @param 无
+ * @return 温度X100
+*/
+int32_t get_temp_x100(void);
+
 #endif
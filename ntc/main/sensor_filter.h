@@ -0,0 +1,297 @@
+#ifndef _SENSOR_FILTER_H_
+#define _SENSOR_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 传感器数据流滤波器，全部为定点整数运算，不分配内存
+ * 每个滤波器的状态放在调用者提供的结构体(和缓存)里，可以在任务、回调里逐点调用，也可以串联使用
+ * 输入输出都是传感器自己的整数单位(ADC值、0.01℃、mm 等)
+ *
+ *  滑动平均   filter_ma_t       最近 N 点的平均
+ *  指数平均   filter_ema_t      y += (x - y) / 2^shift
+ *  中值       filter_median3/5/7 排序网络求中值；filter_median_t 滑动窗口中值
+ *  Hampel    filter_hampel_t    与窗口中值偏差超过 k 倍 MAD 的点替换为中值
+ *  卡尔曼     filter_kalman_t    一维卡尔曼滤波(常值模型)
+ */
+
+#define FILTER_WIN_MAX      15      //中值 / Hampel 窗口最大长度
+
+//比较交换，排序网络的基本单元
+#define FILTER_SORT2(a, b)  do { if ((a) > (b)) { int32_t _t = (a); (a) = (b); (b) = _t; } } while (0)
+
+/*---------------------------------------------------------------
+        中值：排序网络，没有分支预测和循环开销
+---------------------------------------------------------------*/
+
+//三个数的中值
+static inline int32_t filter_median3(int32_t a, int32_t b, int32_t c)
+{
+    FILTER_SORT2(a, b);
+    FILTER_SORT2(b, c);
+    FILTER_SORT2(a, b);
+    return b;
+}
+
+//五个数的中值(7 次比较交换)
+static inline int32_t filter_median5(const int32_t *p)
+{
+    int32_t a = p[0], b = p[1], c = p[2], d = p[3], e = p[4];
+    FILTER_SORT2(a, b);
+    FILTER_SORT2(d, e);
+    FILTER_SORT2(a, d);
+    FILTER_SORT2(b, e);
+    FILTER_SORT2(b, c);
+    FILTER_SORT2(c, d);
+    FILTER_SORT2(b, c);
+    return c;
+}
+
+//七个数的中值(13 次比较交换)
+static inline int32_t filter_median7(const int32_t *p)
+{
+    int32_t a = p[0], b = p[1], c = p[2], d = p[3], e = p[4], f = p[5], g = p[6];
+    FILTER_SORT2(a, f);
+    FILTER_SORT2(a, d);
+    FILTER_SORT2(b, g);
+    FILTER_SORT2(c, e);
+    FILTER_SORT2(a, b);
+    FILTER_SORT2(d, f);
+    FILTER_SORT2(c, g);
+    FILTER_SORT2(c, d);
+    FILTER_SORT2(d, g);
+    FILTER_SORT2(e, f);
+    FILTER_SORT2(b, e);
+    FILTER_SORT2(b, d);
+    FILTER_SORT2(d, e);
+    return d;
+}
+
+/** 任意长度(不超过 FILTER_WIN_MAX)的中值，3/5/7 使用排序网络，其他长度用插入排序
+ * @param p 数据，不会被修改
+ * @param n 个数
+ * @return 中值
+*/
+static inline int32_t filter_median_n(const int32_t *p, int n)
+{
+    int32_t tmp[FILTER_WIN_MAX];
+    if (n > FILTER_WIN_MAX)
+        n = FILTER_WIN_MAX;
+    switch (n)
+    {
+    case 1: return p[0];
+    case 3: return filter_median3(p[0], p[1], p[2]);
+    case 5: return filter_median5(p);
+    default: break;
+    }
+    //先拷贝到固定长度的缓存，排序网络不会越过调用者的窗口
+    for (int i = 0; i < n; i++)
+        tmp[i] = p[i];
+    if (n == 7)
+        return filter_median7(tmp);
+    for (int i = 1; i < n; i++)
+    {
+        int32_t v = tmp[i];
+        int j = i;
+        for (; j > 0 && tmp[j - 1] > v; j--)
+            tmp[j] = tmp[j - 1];
+        tmp[j] = v;
+    }
+    return tmp[n / 2];
+}
+
+/*---------------------------------------------------------------
+        滑动平均
+---------------------------------------------------------------*/
+typedef struct
+{
+    int32_t *buf;       //窗口缓存，调用者提供
+    uint16_t len;       //窗口长度
+    uint16_t idx;       //写位置
+    uint16_t num;       //窗口中的点数
+    int32_t sum;        //窗口内的和
+}filter_ma_t;
+
+/** 初始化滑动平均
+ * @param f 滤波器
+ * @param buf 窗口缓存
+ * @param len 窗口长度
+ * @return 无
+*/
+static inline void filter_ma_init(filter_ma_t *f, int32_t *buf, uint16_t len)
+{
+    f->buf = buf;
+    f->len = len;
+    f->idx = 0;
+    f->num = 0;
+    f->sum = 0;
+}
+
+/** 输入一个点
+ * @param f 滤波器
+ * @param x 输入
+ * @return 窗口平均值(四舍五入)
+*/
+static inline int32_t filter_ma_update(filter_ma_t *f, int32_t x)
+{
+    if (f->num < f->len)
+        f->num++;
+    else
+        f->sum -= f->buf[f->idx];
+    f->buf[f->idx] = x;
+    f->sum += x;
+    if (++f->idx >= f->len)
+        f->idx = 0;
+    return (f->sum >= 0 ? f->sum + f->num / 2 : f->sum - f->num / 2) / f->num;
+}
+
+/*---------------------------------------------------------------
+        指数平均：y += (x - y) / 2^shift，内部多保留 8 位小数
+---------------------------------------------------------------*/
+typedef struct
+{
+    int32_t y;          //输出，Q8
+    uint8_t shift;      //平滑系数 alpha = 1/2^shift，越大越平滑
+    bool ready;         //是否已经有第一个点
+}filter_ema_t;
+
+static inline void filter_ema_init(filter_ema_t *f, uint8_t shift)
+{
+    f->y = 0;
+    f->shift = shift;
+    f->ready = false;
+}
+
+static inline int32_t filter_ema_update(filter_ema_t *f, int32_t x)
+{
+    if (!f->ready)
+    {
+        //第一个点直接作为输出，避免从 0 慢慢爬升
+        f->y = x * 256;
+        f->ready = true;
+    }
+    else
+    {
+        f->y += (x * 256 - f->y) >> f->shift;
+    }
+    return (f->y + 128) >> 8;
+}
+
+/*---------------------------------------------------------------
+        滑动窗口中值
+---------------------------------------------------------------*/
+typedef struct
+{
+    int32_t *buf;       //窗口缓存，调用者提供
+    uint8_t len;        //窗口长度，奇数，不超过 FILTER_WIN_MAX
+    uint8_t idx;        //写位置
+    uint8_t num;        //窗口中的点数
+}filter_median_t;
+
+static inline void filter_median_init(filter_median_t *f, int32_t *buf, uint8_t len)
+{
+    f->buf = buf;
+    f->len = len > FILTER_WIN_MAX ? FILTER_WIN_MAX : len;
+    f->idx = 0;
+    f->num = 0;
+}
+
+//输入一个点，返回窗口中值(窗口未满时返回已有点的中值)
+static inline int32_t filter_median_update(filter_median_t *f, int32_t x)
+{
+    f->buf[f->idx] = x;
+    if (++f->idx >= f->len)
+        f->idx = 0;
+    if (f->num < f->len)
+        f->num++;
+    //窗口未满时数据在 buf[0 .. num-1]
+    return filter_median_n(f->buf, f->num);
+}
+
+/*---------------------------------------------------------------
+        Hampel：|x - 中值| > k * 1.4826 * MAD 时认为是离群点，输出中值
+        判定的是窗口中心点，所以输出比输入延迟 len/2 个点
+---------------------------------------------------------------*/
+typedef struct
+{
+    filter_median_t win;    //窗口
+    uint16_t k_q8;          //阈值倍数 k，Q8(例如 3.0 为 768)
+    int32_t min_dev;        //最小偏差，窗口内数据完全相同(MAD 为 0)时避免把正常的小波动当成离群点
+    uint32_t outliers;      //累计剔除的离群点数
+}filter_hampel_t;
+
+static inline void filter_hampel_init(filter_hampel_t *f, int32_t *buf, uint8_t len, uint16_t k_q8, int32_t min_dev)
+{
+    filter_median_init(&f->win, buf, len);
+    f->k_q8 = k_q8;
+    f->min_dev = min_dev;
+    f->outliers = 0;
+}
+
+static inline int32_t filter_hampel_update(filter_hampel_t *f, int32_t x)
+{
+    int32_t dev[FILTER_WIN_MAX];
+    int32_t med = filter_median_update(&f->win, x);
+    int n = f->win.num;
+    //窗口中心点(最新的点往前 n/2 个)
+    int center = (f->win.idx + f->win.len - 1 - n / 2) % f->win.len;
+    int32_t c = f->win.buf[center];
+    for (int i = 0; i < n; i++)
+        dev[i] = f->win.buf[i] > med ? f->win.buf[i] - med : med - f->win.buf[i];
+    int32_t mad = filter_median_n(dev, n);
+    //1.4826 * k 约等于 (k_q8 * 380) >> 16
+    int64_t limit = ((int64_t)mad * f->k_q8 * 380) >> 16;
+    int32_t d = c > med ? c - med : med - c;
+    if (limit < f->min_dev)
+        limit = f->min_dev;
+    if (n >= 3 && d > limit)
+    {
+        f->outliers++;
+        return med;
+    }
+    return c;
+}
+
+/*---------------------------------------------------------------
+        一维卡尔曼滤波(常值模型)，增益用 Q16 表示
+        q：过程噪声方差，越大跟随越快；r：测量噪声方差，越大越平滑(单位为输入单位的平方)
+---------------------------------------------------------------*/
+typedef struct
+{
+    int32_t x;          //估计值
+    uint32_t p;         //估计方差
+    uint32_t q;         //过程噪声方差
+    uint32_t r;         //测量噪声方差
+    bool ready;         //是否已经有第一个点
+}filter_kalman_t;
+
+static inline void filter_kalman_init(filter_kalman_t *f, uint32_t q, uint32_t r)
+{
+    f->x = 0;
+    f->p = r;
+    f->q = q;
+    f->r = r;
+    f->ready = false;
+}
+
+static inline int32_t filter_kalman_update(filter_kalman_t *f, int32_t z)
+{
+    if (!f->ready)
+    {
+        f->x = z;
+        f->ready = true;
+        return z;
+    }
+    //预测
+    uint64_t p = (uint64_t)f->p + f->q;
+    //增益 k = p / (p + r)
+    uint32_t k = (uint32_t)((p << 16) / (p + f->r + 1));
+    //更新
+    f->x += (int32_t)(((int64_t)(z - f->x) * k + (1 << 15)) >> 16);
+    p = (p * (65536 - k)) >> 16;
+    f->p = p > UINT32_MAX ? UINT32_MAX : (uint32_t)p;
+    return f->x;
+}
+
+#endif
@@ -0,0 +1,485 @@
+#include "sensor_hub.h"
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char* TAG = "sensor_hub";
+
+//传感器
+typedef struct
+{
+    sensor_desc_t desc;
+    int first_channel;          //第一个通道的编号
+    int64_t next_due;           //下一次计划读取的时刻
+    sensor_hub_stats_t stats;
+    bool busy;                  //异步读取还没有完成，只在采样任务中修改
+    bool done;                  //异步读取已经完成，以下结果由s_hub_lock保护
+    esp_err_t result;
+    int64_t done_us;
+    int32_t values[SENSOR_HUB_SENSOR_CHANNEL];
+}hub_sensor_t;
+
+//通道
+typedef struct
+{
+    int sensor;                 //所属传感器
+    const char *name;
+    int32_t deadband;
+    bool notified;              //是否通知过
+    int32_t last_notified;      //上次通知的值
+    sensor_sample_t history[SENSOR_HUB_HISTORY_LEN];    //历史记录环形缓存
+    uint16_t head;              //下一个写位置
+    uint16_t count;             //历史记录个数
+}hub_channel_t;
+
+//订阅者
+typedef struct
+{
+    uint32_t channel_mask;
+    sensor_hub_cb cb;
+    void *arg;
+    bool every_sample;          //每次采样都回调，不受死区限制
+}hub_subscriber_t;
+
+static hub_sensor_t s_sensor[SENSOR_HUB_MAX_SENSOR];
+static int s_sensor_num = 0;
+static hub_channel_t s_channel[SENSOR_HUB_MAX_CHANNEL];
+static int s_channel_num = 0;
+
+static hub_subscriber_t s_subscriber[SENSOR_HUB_MAX_SUBSCRIBER];
+
+//保护历史记录和订阅者表，临界区内只做拷贝
+static portMUX_TYPE s_hub_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t s_hub_task = NULL;
+static esp_timer_handle_t s_wakeup_timer = NULL;
+
+/** 添加传感器，需要在sensor_hub_start之前调用
+ * @param desc 描述，内容会被拷贝
+ * @return 第一个通道的编号，其余通道依次加1，失败返回-1
+*/
+int sensor_hub_add(const sensor_desc_t *desc)
+{
+    if (s_hub_task || !desc || !desc->read || desc->period_ms == 0)
+        return -1;
+    if (desc->chan_num == 0 || desc->chan_num > SENSOR_HUB_SENSOR_CHANNEL)
+        return -1;
+    if (s_sensor_num >= SENSOR_HUB_MAX_SENSOR || s_channel_num + desc->chan_num > SENSOR_HUB_MAX_CHANNEL)
+    {
+        ESP_LOGE(TAG, "too many sensors");
+        return -1;
+    }
+    hub_sensor_t *sensor = &s_sensor[s_sensor_num];
+    sensor->desc = *desc;
+    sensor->first_channel = s_channel_num;
+    for (int i = 0; i < desc->chan_num; i++)
+    {
+        hub_channel_t *chan = &s_channel[s_channel_num + i];
+        memset(chan, 0, sizeof(hub_channel_t));
+        chan->sensor = s_sensor_num;
+        chan->name = desc->chan[i].name;
+        chan->deadband = desc->chan[i].deadband;
+    }
+    s_sensor_num++;
+    s_channel_num += desc->chan_num;
+    return sensor->first_channel;
+}
+
+/** 一个传感器所有通道的采样值写入历史记录，写完后读者通过sensor_hub_latest取到的是同一次采样
+ * @param sensor 传感器
+ * @param samples 采样值，每个通道一个
+ * @return 无
+*/
+static void sensor_hub_store(hub_sensor_t *sensor, const sensor_sample_t *samples)
+{
+    portENTER_CRITICAL(&s_hub_lock);
+    for (int i = 0; i < sensor->desc.chan_num; i++)
+    {
+        hub_channel_t *chan = &s_channel[sensor->first_channel + i];
+        chan->history[chan->head] = samples[i];
+        if (++chan->head >= SENSOR_HUB_HISTORY_LEN)
+            chan->head = 0;
+        if (chan->count < SENSOR_HUB_HISTORY_LEN)
+            chan->count++;
+    }
+    portEXIT_CRITICAL(&s_hub_lock);
+}
+
+/** 通知订阅者：每次采样订阅的每次都通知，变化订阅的在数值变化超过死区时通知
+ * @param channel 通道编号
+ * @param sample 采样值
+ * @return 无
+*/
+static void sensor_hub_notify(int channel, const sensor_sample_t *sample)
+{
+    hub_channel_t *chan = &s_channel[channel];
+    hub_subscriber_t subscriber[SENSOR_HUB_MAX_SUBSCRIBER];
+
+    int32_t diff = sample->value - chan->last_notified;
+    if (diff < 0)
+        diff = -diff;
+    bool changed = !chan->notified || (diff != 0 && diff >= chan->deadband);
+    if (changed)
+    {
+        chan->notified = true;
+        chan->last_notified = sample->value;
+    }
+
+    portENTER_CRITICAL(&s_hub_lock);
+    memcpy(subscriber, s_subscriber, sizeof(subscriber));
+    portEXIT_CRITICAL(&s_hub_lock);
+    for (int i = 0; i < SENSOR_HUB_MAX_SUBSCRIBER; i++)
+    {
+        if (!subscriber[i].cb || !(subscriber[i].channel_mask & (1u << channel)))
+            continue;
+        if (changed || subscriber[i].every_sample)
+            subscriber[i].cb(channel, sample, subscriber[i].arg);
+    }
+}
+
+/** 记录一次读取结果，先记录所有通道再通知订阅者，
+ * 订阅者在回调中读取同一传感器的其他通道时得到的是同一次采样的值
+ * @param sensor 传感器
+ * @param values 每个通道一个值
+ * @param time_us 采样时刻
+ * @return 无
+*/
+static void sensor_hub_record(hub_sensor_t *sensor, const int32_t *values, int64_t time_us)
+{
+    sensor_sample_t samples[SENSOR_HUB_SENSOR_CHANNEL];
+    for (int i = 0; i < sensor->desc.chan_num; i++)
+    {
+        samples[i].time_us = time_us;
+        samples[i].value = values[i];
+    }
+    sensor_hub_store(sensor, samples);
+    for (int i = 0; i < sensor->desc.chan_num; i++)
+        sensor_hub_notify(sensor->first_channel + i, &samples[i]);
+}
+
+/** 读取一个传感器，异步读取时只启动，结果由sensor_hub_complete交回
+ * @param sensor 传感器
+ * @param now 读取时刻
+ * @return 无
+*/
+static void sensor_hub_read(hub_sensor_t *sensor, int64_t now)
+{
+    int32_t values[SENSOR_HUB_SENSOR_CHANNEL] = {0};
+    uint32_t lateness = (uint32_t)(now - sensor->next_due);
+    if (lateness > sensor->stats.max_lateness_us)
+        sensor->stats.max_lateness_us = lateness;
+    sensor->stats.reads++;
+    esp_err_t ret = sensor->desc.read(values, sensor->desc.arg);
+    if (ret == ESP_ERR_NOT_FINISHED)
+    {
+        sensor->busy = true;
+        return;
+    }
+    if (ret != ESP_OK)
+    {
+        sensor->stats.errors++;
+        return;
+    }
+    sensor_hub_record(sensor, values, now);
+}
+
+/** 记录已经完成的异步读取
+ * @param sensor 传感器
+ * @return 无
+*/
+static void sensor_hub_collect(hub_sensor_t *sensor)
+{
+    int32_t values[SENSOR_HUB_SENSOR_CHANNEL];
+    bool done;
+    esp_err_t result = ESP_OK;
+    int64_t done_us = 0;
+    if (!sensor->busy)
+        return;
+    portENTER_CRITICAL(&s_hub_lock);
+    done = sensor->done;
+    if (done)
+    {
+        sensor->done = false;
+        result = sensor->result;
+        done_us = sensor->done_us;
+        memcpy(values, sensor->values, sizeof(values));
+    }
+    portEXIT_CRITICAL(&s_hub_lock);
+    if (!done)
+        return;
+    sensor->busy = false;
+    if (result != ESP_OK)
+        sensor->stats.errors++;
+    else
+        sensor_hub_record(sensor, values, done_us);
+}
+
+/** 唤醒定时器，到达最近一个计划时刻时通知任务
+ * @param arg 无
+ * @return 无
+*/
+static void sensor_hub_wakeup(void *arg)
+{
+    xTaskNotifyGive(s_hub_task);
+}
+
+/** 采样任务，计划时刻按周期累加，不会因为读取耗时而漂移；
+ * 两次读取之间任务阻塞，由一次性定时器在下一个计划时刻唤醒，异步读取完成时也会唤醒
+ * @param param 无
+ * @return 无
+*/
+static void sensor_hub_task(void *param)
+{
+    while (1)
+    {
+        int64_t now = esp_timer_get_time();
+        int64_t next = INT64_MAX;
+        for (int i = 0; i < s_sensor_num; i++)
+        {
+            hub_sensor_t *sensor = &s_sensor[i];
+            sensor_hub_collect(sensor);
+            if (sensor->next_due <= now)
+            {
+                //上一次异步读取还没有完成，这个周期不读
+                if (sensor->busy)
+                    sensor->stats.overruns++;
+                else
+                    sensor_hub_read(sensor, now);
+                int64_t period = (int64_t)sensor->desc.period_ms * 1000;
+                sensor->next_due += period;
+                //太晚了就跳过错过的周期，保持原来的相位
+                if (sensor->next_due <= now)
+                {
+                    int64_t missed = (now - sensor->next_due) / period + 1;
+                    sensor->stats.overruns += missed;
+                    sensor->next_due += missed * period;
+                }
+                //读取花了时间，重新取当前时刻给后面的传感器用
+                now = esp_timer_get_time();
+            }
+            if (sensor->next_due < next)
+                next = sensor->next_due;
+        }
+        if (next > now)
+        {
+            //被异步读取完成提前唤醒时定时器还在运行，先停止再按新的最近时刻启动
+            TickType_t wait = portMAX_DELAY;
+            esp_timer_stop(s_wakeup_timer);
+            if (esp_timer_start_once(s_wakeup_timer, next - now) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "start wakeup timer fail");
+                wait = pdMS_TO_TICKS((next - now) / 1000) + 1;
+            }
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+}
+
+/** 启动采样任务
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t sensor_hub_start(void)
+{
+    if (s_hub_task || s_sensor_num == 0)
+        return ESP_FAIL;
+    const esp_timer_create_args_t timer_args =
+    {
+        .callback = sensor_hub_wakeup,
+        .name = "sensor_hub",
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .skip_unhandled_events = true,
+    };
+    if (esp_timer_create(&timer_args, &s_wakeup_timer) != ESP_OK)
+        return ESP_FAIL;
+    //所有传感器启动后立即读一次
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < s_sensor_num; i++)
+        s_sensor[i].next_due = now;
+    if (xTaskCreatePinnedToCore(sensor_hub_task, "sensor_hub", 4096, NULL, 4, &s_hub_task, 1) != pdPASS)
+    {
+        ESP_LOGE(TAG, "create task fail");
+        esp_timer_delete(s_wakeup_timer);
+        s_wakeup_timer = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/** 异步读取完成，交回结果，可以在中断中调用
+ * @param channel 传感器的第一个通道编号
+ * @param values 每个通道一个值
+ * @param result ESP_OK or 失败原因
+ * @return 是否唤醒了更高优先级的任务（在中断中调用时用于决定是否切换任务）
+*/
+bool sensor_hub_complete(int channel, const int32_t *values, esp_err_t result)
+{
+    BaseType_t high_task_wakeup = pdFALSE;
+    if (channel < 0 || channel >= s_channel_num || !s_hub_task)
+        return false;
+    hub_sensor_t *sensor = &s_sensor[s_channel[channel].sensor];
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_SAFE(&s_hub_lock);
+    sensor->done = true;
+    sensor->result = result;
+    sensor->done_us = now;
+    if (result == ESP_OK)
+        memcpy(sensor->values, values, sensor->desc.chan_num * sizeof(int32_t));
+    portEXIT_CRITICAL_SAFE(&s_hub_lock);
+    if (xPortInIsrContext())
+        vTaskNotifyGiveFromISR(s_hub_task, &high_task_wakeup);
+    else
+        xTaskNotifyGive(s_hub_task);
+    return high_task_wakeup == pdTRUE;
+}
+
+/** 按名称查找通道
+ * @param name 通道名称
+ * @return 通道编号，没有找到返回-1
+*/
+int sensor_hub_find(const char *name)
+{
+    for (int i = 0; i < s_channel_num; i++)
+    {
+        if (s_channel[i].name && strcmp(s_channel[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/** 获取通道名称
+ * @param channel 通道编号
+ * @return 名称，通道不存在返回NULL
+*/
+const char *sensor_hub_channel_name(int channel)
+{
+    if (channel < 0 || channel >= s_channel_num)
+        return NULL;
+    return s_channel[channel].name;
+}
+
+/** 添加订阅者
+ * @param channel_mask 关心的通道，第n位对应通道n
+ * @param every_sample true 每次采样都回调，false 只在数值变化时回调
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+static int sensor_hub_subscribe_ex(uint32_t channel_mask, bool every_sample, sensor_hub_cb cb, void *arg)
+{
+    int id = -1;
+    if (!cb)
+        return -1;
+    portENTER_CRITICAL(&s_hub_lock);
+    for (int i = 0; i < SENSOR_HUB_MAX_SUBSCRIBER; i++)
+    {
+        if (!s_subscriber[i].cb)
+        {
+            s_subscriber[i].channel_mask = channel_mask;
+            s_subscriber[i].cb = cb;
+            s_subscriber[i].arg = arg;
+            s_subscriber[i].every_sample = every_sample;
+            id = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_hub_lock);
+    return id;
+}
+
+/** 订阅通道的数值变化
+ * @param channel_mask 关心的通道，第n位对应通道n
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int sensor_hub_subscribe(uint32_t channel_mask, sensor_hub_cb cb, void *arg)
+{
+    return sensor_hub_subscribe_ex(channel_mask, false, cb, arg);
+}
+
+/** 订阅通道的每次采样，数值不变或在死区内也回调，用于记录历史、统计等需要完整采样的场合
+ * @param channel_mask 关心的通道，第n位对应通道n
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int sensor_hub_subscribe_samples(uint32_t channel_mask, sensor_hub_cb cb, void *arg)
+{
+    return sensor_hub_subscribe_ex(channel_mask, true, cb, arg);
+}
+
+/** 取消订阅
+ * @param id sensor_hub_subscribe 返回的订阅编号
+ * @return 无
+*/
+void sensor_hub_unsubscribe(int id)
+{
+    if (id < 0 || id >= SENSOR_HUB_MAX_SUBSCRIBER)
+        return;
+    portENTER_CRITICAL(&s_hub_lock);
+    memset(&s_subscriber[id], 0, sizeof(hub_subscriber_t));
+    portEXIT_CRITICAL(&s_hub_lock);
+}
+
+/** 获取通道最新的采样值
+ * @param channel 通道编号
+ * @param sample 输出
+ * @return ESP_OK，还没有采样值时返回ESP_ERR_NOT_FOUND
+*/
+esp_err_t sensor_hub_latest(int channel, sensor_sample_t *sample)
+{
+    if (channel < 0 || channel >= s_channel_num)
+        return ESP_ERR_INVALID_ARG;
+    hub_channel_t *chan = &s_channel[channel];
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_hub_lock);
+    if (chan->count)
+    {
+        *sample = chan->history[(chan->head + SENSOR_HUB_HISTORY_LEN - 1) % SENSOR_HUB_HISTORY_LEN];
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_hub_lock);
+    return ret;
+}
+
+/** 获取通道的历史记录，按时间从旧到新
+ * @param channel 通道编号
+ * @param buf 输出
+ * @param max_num 最多取出的个数，超过历史记录个数时取最新的max_num个
+ * @return 实际取出的个数
+*/
+int sensor_hub_history(int channel, sensor_sample_t *buf, int max_num)
+{
+    if (channel < 0 || channel >= s_channel_num || max_num <= 0)
+        return 0;
+    hub_channel_t *chan = &s_channel[channel];
+    portENTER_CRITICAL(&s_hub_lock);
+    int num = chan->count < max_num ? chan->count : max_num;
+    int idx = (chan->head + SENSOR_HUB_HISTORY_LEN - num) % SENSOR_HUB_HISTORY_LEN;
+    for (int i = 0; i < num; i++)
+    {
+        buf[i] = chan->history[idx];
+        if (++idx >= SENSOR_HUB_HISTORY_LEN)
+            idx = 0;
+    }
+    portEXIT_CRITICAL(&s_hub_lock);
+    return num;
+}
+
+/** 获取传感器统计信息
+ * @param channel 传感器的任一通道编号
+ * @param stats 输出
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t sensor_hub_get_stats(int channel, sensor_hub_stats_t *stats)
+{
+    if (channel < 0 || channel >= s_channel_num)
+        return ESP_FAIL;
+    *stats = s_sensor[s_channel[channel].sensor].stats;
+    return ESP_OK;
+}
@@ -29,10 +29,26 @@ static const char *TAG = "example";
 #define HC_SR04_TRIG_GPIO  GPIO_NUM_32
 #define HC_SR04_ECHO_GPIO  GPIO_NUM_33
 
-void vSR04Task(void *pvParameters)
+/**
+ * @brief 测距结果回调，在测距任务中执行
+ */
+static void prvSR04ResultCallback(SR04_t *pxSR04, esp_err_t xStatus, int32_t lDistanceMM, void *pvArg)
+{
+    if (xStatus == ESP_OK) {
+        ESP_LOGI(TAG, "Measured distance: %ld mm", lDistanceMM);
+    } else if (xStatus == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(TAG, "Measurement timeout - no echo received");
+    } else if (xStatus == ESP_ERR_INVALID_SIZE) {
+        ESP_LOGW(TAG, "Measurement out of range");
+    } else {
+        ESP_LOGE(TAG, "Measurement failed: %s", esp_err_to_name(xStatus));
+    }
+}
+
+void app_main(void)
 {
-    SR04_t xSR04Sensor;
-    float fDistance_CM;
+    static SR04_t xSR04Sensor;
+    SR04_t *pxSensors[] = { &xSR04Sensor };
     esp_err_t xRet;
 
     ESP_LOGI(TAG, "Initializing HC-SR04 sensor");
@@ -46,29 +62,11 @@ void vSR04Task(void *pvParameters)
 
     ESP_LOGI(TAG, "HC-SR04 sensor initialized successfully");
 
-    while (1) {
-        // 测量距离
-        xRet = xSR04MeasureDistance(&xSR04Sensor, &fDistance_CM, 1000);
-        
-        if (xRet == ESP_OK) {
-            ESP_LOGI(TAG, "Measured distance: %.2f cm", fDistance_CM);
-        } else if (xRet == ESP_ERR_TIMEOUT) {
-            ESP_LOGW(TAG, "Measurement timeout - no echo received");
-        } else if (xRet == ESP_ERR_INVALID_SIZE) {
-            ESP_LOGW(TAG, "Measurement out of range");
-        } else {
-            ESP_LOGE(TAG, "Measurement failed: %s", esp_err_to_name(xRet));
-            }
+    // 默认每个传感器单独一个时间片；朝向不同、互不干扰的传感器可以设置相同的 ucSlot 同时触发
 
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
-
-    // 清理资源（在实际应用中可能需要调用）
-    // sr04_deinit(&sr04_sensor);
-}
+    // 环境温度，有温度传感器时可以周期性更新
+    vSR04SetTemperature(2500);
 
-
-void app_main(void)
-{
-    xTaskCreatePinnedToCore(vSR04Task, "SR04_task", 4096, NULL, 5, NULL, 0);
+    // 每 100 ms 测量一轮
+    ESP_ERROR_CHECK(xSR04RangerStart(pxSensors, 1, 100, prvSR04ResultCallback, NULL));
 }
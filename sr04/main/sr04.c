@@ -7,9 +7,32 @@
 #include "sr04.h"
 #include "esp_log.h"
 #include "esp_private/esp_clk.h"
+#include "soc/soc_caps.h"
 
 static const char *TAG = "SR04";
 
+#define SR04_ECHO_TIMEOUT_MS    40      // 等待回波的超时时间，无障碍物时回波脉宽约 38 ms
+#define SR04_GUARD_MS           20      // 时间片之间的间隔，等待余波衰减，避免串扰
+#define SR04_MAX_PULSE_US       35000   // 有效脉宽上限
+#define SR04_EMA_SHIFT          2       // 平滑系数 1/4
+#define SR04_HAMPEL_K_Q8        768     // 离群点判定阈值 3 倍 MAD
+#define SR04_HAMPEL_MIN_MM      20      // 离群点判定的最小偏差（毫米）
+
+/* 每组 MCPWM 的捕获定时器，同组的所有捕获通道共用 */
+static mcpwm_cap_timer_handle_t s_xCaptureTimer[SOC_MCPWM_GROUPS];
+static uint8_t s_ucCaptureTimerRef[SOC_MCPWM_GROUPS];
+
+/* 环境温度X100，用于修正声速 */
+static volatile int32_t s_lTempX100 = 2000;
+
+/* 测距服务 */
+static SR04_t *s_pxRangerSensors[SR04_MAX_SENSOR];
+static uint8_t s_ucRangerNum = 0;
+static uint32_t s_uxRangerPeriodMS = 0;
+static SR04ResultCallback_t s_pxRangerCallback = NULL;
+static void *s_pvRangerArg = NULL;
+static TaskHandle_t s_xRangerTask = NULL;
+
 /**
  * @brief 生成Trig引脚脉冲以启动测量
  */
@@ -22,37 +45,54 @@ static void prvSR04TrigOutput(gpio_num_t xTrigGPIO)
 
 /**
  * @brief 回声捕获回调函数
+ *
+ * 边沿计数值保存在各自的传感器实例中，多个传感器可以同时测量；
+ * 下降沿时记录脉宽并给等待的任务计数加一，由任务检查各实例的 xEchoDone
  */
 static bool prvSR04EchoCallback(mcpwm_cap_channel_handle_t xCaptureChannel, 
                               const mcpwm_capture_event_data_t *xEventData, 
                               void *pvUserData)
 {
-    static uint32_t uxCaptureBeginValue = 0;
-    static uint32_t uxCaptureEndValue = 0;
     SR04_t *pxSR04 = (SR04_t *)pvUserData;
     BaseType_t xHighTaskWakeup = pdFALSE;
 
     // 判断边沿，上升沿记录捕获的计数值
     if (xEventData->cap_edge == MCPWM_CAP_EDGE_POS) {
         // 存储正边沿检测到的时间戳
-        uxCaptureBeginValue = xEventData->cap_value;
-        uxCaptureEndValue = uxCaptureBeginValue;
-    } else {
-        // 如果是下降沿，也记录捕获的计数值
-        uxCaptureEndValue = xEventData->cap_value;
-
-        // 两个计数值的差值，就是脉宽长度
-        uint32_t uxTofTicks = uxCaptureEndValue - uxCaptureBeginValue;
+        pxSR04->uxCaptureBeginValue = xEventData->cap_value;
+    } else if (!pxSR04->xEchoDone) {
+        // 下降沿的计数值与上升沿的差值，就是脉宽长度
+        pxSR04->uxTofTicks = xEventData->cap_value - pxSR04->uxCaptureBeginValue;
+        pxSR04->xEchoDone = true;
 
-        // 通知测距任务计数差值
+        // 通知测距任务
         if (pxSR04->xTaskHandle) {
-            xTaskNotifyFromISR(pxSR04->xTaskHandle, uxTofTicks, eSetValueWithOverwrite, &xHighTaskWakeup);
+            vTaskNotifyGiveFromISR(pxSR04->xTaskHandle, &xHighTaskWakeup);
         }
     }
 
     return xHighTaskWakeup == pdTRUE;
 }
 
+/**
+ * @brief 脉宽计数转换为距离（毫米），按当前温度修正声速
+ *
+ * 声速 c = 331.3 + 0.606 * T (m/s)，距离 D = c * T脉宽 / 2
+ */
+static esp_err_t prvSR04TicksToMM(uint32_t uxTofTicks, int32_t *plDistanceMM)
+{
+    // 计数转换为微秒，计数时钟为 APB 时钟
+    uint32_t uxPulseWidth_US = (uint64_t)uxTofTicks * 1000000 / esp_clk_apb_freq();
+    if (uxPulseWidth_US > SR04_MAX_PULSE_US) {
+        // 脉宽太长，超出了SR04的计算范围
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // 声速，单位 mm/s
+    int64_t llSpeed = 331300 + (int64_t)606 * s_lTempX100 / 100;
+    *plDistanceMM = (int32_t)(llSpeed * uxPulseWidth_US / 2000000);
+    return ESP_OK;
+}
+
 /**
  * @brief 初始化SR04传感器
  */
@@ -69,23 +109,16 @@ esp_err_t xSR04Init(SR04_t *pxSR04, gpio_num_t xTrigGPIO, gpio_num_t xEchoGPIO)
     pxSR04->xEchoGPIO = xEchoGPIO;
     pxSR04->xCaptureTimer = NULL;
     pxSR04->xCaptureChannel = NULL;
-    pxSR04->xTaskHandle = xTaskGetCurrentTaskHandle();
-
-    ESP_LOGI(TAG, "Install capture timer");
-
-    /* 新建一个捕获定时器，使用默认的时钟源 */
-    mcpwm_capture_timer_config_t xCaptureTimerConfig = {
-        .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
-        .group_id = 0,
-    };
-    xRet = mcpwm_new_capture_timer(&xCaptureTimerConfig, &pxSR04->xCaptureTimer);
-    if (xRet != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create capture timer");
-        return xRet;
-    }
+    pxSR04->xTaskHandle = NULL;
+    pxSR04->ucSlot = SR04_SLOT_AUTO;
+    pxSR04->ucRangerSlot = 0;
+    pxSR04->xEchoDone = false;
+    pxSR04->lDistanceMM = 0;
+    pxSR04->xLastStatus = ESP_ERR_TIMEOUT;
+    filter_hampel_init(&pxSR04->xHampel, pxSR04->lHampelBuf, SR04_HAMPEL_WIN, SR04_HAMPEL_K_Q8, SR04_HAMPEL_MIN_MM);
+    filter_ema_init(&pxSR04->xEma, SR04_EMA_SHIFT);
 
     /* 新建一个捕获通道，把捕获定时器与捕获通道绑定起来，采取双边捕获的策略 */
-    ESP_LOGI(TAG, "Install capture channel");
     mcpwm_capture_channel_config_t xCaptureChannelConfig = {
         .gpio_num = pxSR04->xEchoGPIO,
         .prescale = 1,
@@ -95,8 +128,37 @@ esp_err_t xSR04Init(SR04_t *pxSR04, gpio_num_t xTrigGPIO, gpio_num_t xEchoGPIO)
         // pull up internally
         .flags.pull_up = true,
     };
-    xRet = mcpwm_new_capture_channel(pxSR04->xCaptureTimer, &xCaptureChannelConfig, &pxSR04->xCaptureChannel);
-    if (xRet != ESP_OK) {
+    /* 每组只有 3 个捕获通道，当前组用完时换下一组 */
+    for (int iGroup = 0; iGroup < SOC_MCPWM_GROUPS && pxSR04->xCaptureChannel == NULL; iGroup++) {
+        if (s_xCaptureTimer[iGroup] == NULL) {
+            /* 该组第一个传感器，新建并启动捕获定时器，使用默认的时钟源 */
+            ESP_LOGI(TAG, "Install capture timer of group %d", iGroup);
+            mcpwm_capture_timer_config_t xCaptureTimerConfig = {
+                .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+                .group_id = iGroup,
+            };
+            xRet = mcpwm_new_capture_timer(&xCaptureTimerConfig, &s_xCaptureTimer[iGroup]);
+            if (xRet != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to create capture timer");
+                continue;
+            }
+            mcpwm_capture_timer_enable(s_xCaptureTimer[iGroup]);
+            mcpwm_capture_timer_start(s_xCaptureTimer[iGroup]);
+        }
+        ESP_LOGI(TAG, "Install capture channel");
+        xRet = mcpwm_new_capture_channel(s_xCaptureTimer[iGroup], &xCaptureChannelConfig, &pxSR04->xCaptureChannel);
+        if (xRet == ESP_OK) {
+            pxSR04->xCaptureTimer = s_xCaptureTimer[iGroup];
+            s_ucCaptureTimerRef[iGroup]++;
+        } else if (s_ucCaptureTimerRef[iGroup] == 0) {
+            /* 新建的定时器没有用上，释放掉 */
+            mcpwm_capture_timer_disable(s_xCaptureTimer[iGroup]);
+            mcpwm_capture_timer_stop(s_xCaptureTimer[iGroup]);
+            mcpwm_del_capture_timer(s_xCaptureTimer[iGroup]);
+            s_xCaptureTimer[iGroup] = NULL;
+        }
+    }
+    if (pxSR04->xCaptureChannel == NULL) {
         ESP_LOGE(TAG, "Failed to create capture channel");
         goto error;
     }
@@ -112,20 +174,6 @@ esp_err_t xSR04Init(SR04_t *pxSR04, gpio_num_t xTrigGPIO, gpio_num_t xEchoGPIO)
         goto error;
     }
 
-    /* 使能并开启捕获定时器 */
-    ESP_LOGI(TAG, "Enable and start capture timer");
-    xRet = mcpwm_capture_timer_enable(pxSR04->xCaptureTimer);
-    if (xRet != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to enable capture timer");
-        goto error;
-    }
-    
-    xRet = mcpwm_capture_timer_start(pxSR04->xCaptureTimer);
-    if (xRet != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start capture timer");
-        goto error;
-    }
-
     /* 使能捕获通道 */
     ESP_LOGI(TAG, "Enable capture channel");
     xRet = mcpwm_capture_channel_enable(pxSR04->xCaptureChannel);
@@ -175,10 +223,17 @@ esp_err_t xSR04Deinit(SR04_t *sr04)
         sr04->xCaptureChannel = NULL;
     }
 
-    if (sr04->xCaptureTimer) {
-        mcpwm_capture_timer_disable(sr04->xCaptureTimer);
-        mcpwm_capture_timer_stop(sr04->xCaptureTimer);
-        mcpwm_del_capture_timer(sr04->xCaptureTimer);
+    /* 捕获定时器是同组共用的，最后一个传感器释放时才删除 */
+    for (int iGroup = 0; iGroup < SOC_MCPWM_GROUPS && sr04->xCaptureTimer; iGroup++) {
+        if (s_xCaptureTimer[iGroup] != sr04->xCaptureTimer) {
+            continue;
+        }
+        if (--s_ucCaptureTimerRef[iGroup] == 0) {
+            mcpwm_capture_timer_disable(s_xCaptureTimer[iGroup]);
+            mcpwm_capture_timer_stop(s_xCaptureTimer[iGroup]);
+            mcpwm_del_capture_timer(s_xCaptureTimer[iGroup]);
+            s_xCaptureTimer[iGroup] = NULL;
+        }
         sr04->xCaptureTimer = NULL;
     }
 
@@ -202,46 +257,186 @@ esp_err_t xSR04MeasureDistance(SR04_t *xSR04, float *fDistance_CM, uint32_t uxTi
         return ESP_ERR_INVALID_ARG;
     }
 
-    uint32_t uxTofTicks;
-    
+    int32_t lDistanceMM;
+    esp_err_t xRet;
+
+    /* 回波通知发给当前任务，先清掉之前残留的通知 */
+    xSR04->xTaskHandle = xTaskGetCurrentTaskHandle();
+    xSR04->xEchoDone = false;
+    ulTaskNotifyTake(pdTRUE, 0);
+
     /* 产生一个Trig脉冲，启动一次测距 */
     prvSR04TrigOutput(xSR04->xTrigGPIO);
 
     /* 等待捕获完成信号 */
-    if (xTaskNotifyWait(0x00, ULONG_MAX, &uxTofTicks, pdMS_TO_TICKS(uxTimeout_MS)) == pdTRUE) {
-        // 计算脉宽时间长度
-        /*
-            tof_ticks:计数
-            esp_clk_apb_freq():计数时钟频率
-            1/esp_clk_apb_freq():计数时钟周期，也就是1个tof_ticks时间是多少秒
-            1000000/esp_clk_apb_freq():一个tof_ticks时间是多少us
-            因此tof_ticks * (1000000.0 / esp_clk_apb_freq())就是总的脉宽时长
-        */
-        float fPulseWidth_US = uxTofTicks * (1000000.0 / esp_clk_apb_freq());
-        
-        if (fPulseWidth_US > 35000) {
-            // 脉宽太长，超出了SR04的计算范围
-            ESP_LOGD(TAG, "Pulse width too long: %.2f us", fPulseWidth_US);
-            return ESP_ERR_INVALID_SIZE;
-        }
-        
-        // 计算距离：D = T / 58 cm
-        /*
-            计算公式如下：
-            距离D=音速V*T/2;(T是上述的脉宽时间，因为是来回时间，所以要除以2才是单程时间)
-            D(单位cm)=340m/s*Tus/2;(Tus是以微秒为单位的时间)
-            D=34000cm/s*(10^-6)Ts/2;(1us=(10^-6)s)
-            D=17000cm*(10^-6)*T
-            D=0.017cm*T
-            D=T/58cm
-            所以下面这个公式/58是这样来的
-        */
-        *fDistance_CM = fPulseWidth_US / 58.0f;
-        
-        ESP_LOGD(TAG, "Measured distance: %.2f cm, pulse width: %.2f us", *fDistance_CM, fPulseWidth_US);
-        return ESP_OK;
-    } else {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(uxTimeout_MS)) == 0 || !xSR04->xEchoDone) {
         ESP_LOGD(TAG, "Measurement timeout");
         return ESP_ERR_TIMEOUT;
     }
-}
\ No newline at end of file
+
+    // 计算距离
+    /*
+        tof_ticks:计数，1/esp_clk_apb_freq() 为一个计数的时间，由此得到脉宽 T(us)
+        距离D=音速V*T/2;(T是上述的脉宽时间，因为是来回时间，所以要除以2才是单程时间)
+        常温下 V 约 340m/s，D=T/58cm；这里按环境温度修正声速
+    */
+    xRet = prvSR04TicksToMM(xSR04->uxTofTicks, &lDistanceMM);
+    if (xRet != ESP_OK) {
+        ESP_LOGD(TAG, "Pulse width too long: %lu ticks", xSR04->uxTofTicks);
+        return xRet;
+    }
+    *fDistance_CM = lDistanceMM / 10.0f;
+
+    ESP_LOGD(TAG, "Measured distance: %.2f cm", *fDistance_CM);
+    return ESP_OK;
+}
+
+/**
+ * @brief 设置环境温度，用于修正声速
+ */
+void vSR04SetTemperature(int32_t lTempX100)
+{
+    s_lTempX100 = lTempX100;
+}
+
+/**
+ * @brief 获取测距服务最近一次滤波后的距离
+ */
+esp_err_t xSR04GetDistance(SR04_t *pxSR04, int32_t *plDistanceMM)
+{
+    if (pxSR04 == NULL || plDistanceMM == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *plDistanceMM = pxSR04->lDistanceMM;
+    return pxSR04->xLastStatus;
+}
+
+/**
+ * @brief 处理一次测量结果：换算距离、剔除离群点、平滑，然后发布
+ */
+static void prvSR04Publish(SR04_t *pxSR04)
+{
+    int32_t lDistanceMM = 0;
+    esp_err_t xRet = ESP_ERR_TIMEOUT;
+
+    if (pxSR04->xEchoDone) {
+        xRet = prvSR04TicksToMM(pxSR04->uxTofTicks, &lDistanceMM);
+    }
+    if (xRet == ESP_OK) {
+        lDistanceMM = filter_hampel_update(&pxSR04->xHampel, lDistanceMM);
+        pxSR04->lDistanceMM = filter_ema_update(&pxSR04->xEma, lDistanceMM);
+    }
+    pxSR04->xLastStatus = xRet;
+
+    if (s_pxRangerCallback) {
+        s_pxRangerCallback(pxSR04, xRet, pxSR04->lDistanceMM, s_pvRangerArg);
+    }
+}
+
+/**
+ * @brief 测距任务：按时间片轮流触发，同一时间片的传感器同时测量
+ */
+static void prvSR04RangerTask(void *pvParameters)
+{
+    TickType_t xLastWake = xTaskGetTickCount();
+    uint8_t ucSlotNum = 0;
+
+    for (int i = 0; i < s_ucRangerNum; i++) {
+        if (s_pxRangerSensors[i]->ucRangerSlot + 1 > ucSlotNum) {
+            ucSlotNum = s_pxRangerSensors[i]->ucRangerSlot + 1;
+        }
+    }
+
+    while (1) {
+        for (uint8_t ucSlot = 0; ucSlot < ucSlotNum; ucSlot++) {
+            uint32_t uxTriggered = 0, uxReceived = 0;
+
+            /* 准备本时间片的传感器，清掉残留的通知 */
+            ulTaskNotifyTake(pdTRUE, 0);
+            for (int i = 0; i < s_ucRangerNum; i++) {
+                SR04_t *pxSR04 = s_pxRangerSensors[i];
+                if (pxSR04->ucRangerSlot == ucSlot) {
+                    pxSR04->xTaskHandle = s_xRangerTask;
+                    pxSR04->xEchoDone = false;
+                    uxTriggered++;
+                }
+            }
+            if (uxTriggered == 0) {
+                continue;
+            }
+            /* 几乎同时触发，每个 Trig 脉冲只有 10 us */
+            for (int i = 0; i < s_ucRangerNum; i++) {
+                if (s_pxRangerSensors[i]->ucRangerSlot == ucSlot) {
+                    prvSR04TrigOutput(s_pxRangerSensors[i]->xTrigGPIO);
+                }
+            }
+
+            /* 等齐所有回波或超时 */
+            TickType_t xStart = xTaskGetTickCount();
+            TickType_t xTimeout = pdMS_TO_TICKS(SR04_ECHO_TIMEOUT_MS) + 1;
+            while (uxReceived < uxTriggered) {
+                TickType_t xElapsed = xTaskGetTickCount() - xStart;
+                if (xElapsed >= xTimeout || ulTaskNotifyTake(pdFALSE, xTimeout - xElapsed) == 0) {
+                    break;
+                }
+                uxReceived++;
+            }
+
+            for (int i = 0; i < s_ucRangerNum; i++) {
+                if (s_pxRangerSensors[i]->ucRangerSlot == ucSlot) {
+                    prvSR04Publish(s_pxRangerSensors[i]);
+                }
+            }
+
+            /* 等待余波衰减再触发下一个时间片 */
+            if (ucSlotNum > 1) {
+                vTaskDelay(pdMS_TO_TICKS(SR04_GUARD_MS) + 1);
+            }
+        }
+        vTaskDelayUntil(&xLastWake, pdMS_TO_TICKS(s_uxRangerPeriodMS));
+    }
+}
+
+/**
+ * @brief 启动连续测距服务
+ */
+esp_err_t xSR04RangerStart(SR04_t **ppxSensors, uint8_t ucNum, uint32_t uxCyclePeriod_MS, SR04ResultCallback_t pxCallback, void *pvArg)
+{
+    if (ppxSensors == NULL || ucNum == 0 || ucNum > SR04_MAX_SENSOR) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_xRangerTask) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* 显式指定的时间片原样使用，共用时间片需要调用者明确选择 */
+    uint8_t ucNextSlot = 0;
+    for (int i = 0; i < ucNum; i++) {
+        uint8_t ucSlot = ppxSensors[i]->ucSlot;
+        if (ucSlot == SR04_SLOT_AUTO) {
+            continue;
+        }
+        if (ucSlot >= SR04_MAX_SENSOR) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (ucSlot + 1 > ucNextSlot) {
+            ucNextSlot = ucSlot + 1;
+        }
+    }
+    /* 其余传感器排在后面，每个单独一个时间片，默认不会同时触发 */
+    for (int i = 0; i < ucNum; i++) {
+        SR04_t *pxSR04 = ppxSensors[i];
+        pxSR04->ucRangerSlot = pxSR04->ucSlot == SR04_SLOT_AUTO ? ucNextSlot++ : pxSR04->ucSlot;
+        s_pxRangerSensors[i] = pxSR04;
+    }
+    s_ucRangerNum = ucNum;
+    s_uxRangerPeriodMS = uxCyclePeriod_MS;
+    s_pxRangerCallback = pxCallback;
+    s_pvRangerArg = pvArg;
+
+    if (xTaskCreatePinnedToCore(prvSR04RangerTask, "SR04_ranger", 3072, NULL, 5, &s_xRangerTask, 0) != pdPASS) {
+        s_xRangerTask = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
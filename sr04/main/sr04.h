@@ -5,19 +5,45 @@
 #include "freertos/task.h"
 #include "driver/mcpwm_cap.h"
 #include "driver/gpio.h"
+#include "sensor_filter.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SR04_MAX_SENSOR     6       // 测距服务最多管理的传感器数（ESP32 共 2 组 x 3 个捕获通道）
+#define SR04_HAMPEL_WIN     5       // 离群点剔除窗口长度
+#define SR04_SLOT_AUTO      0xFF    // 测距服务自动分配时间片：每个传感器单独一个时间片
+
 typedef struct {
     gpio_num_t xTrigGPIO;
     gpio_num_t xEchoGPIO;
-    mcpwm_cap_timer_handle_t xCaptureTimer;
+    mcpwm_cap_timer_handle_t xCaptureTimer;     // 同一组的传感器共用一个捕获定时器
     mcpwm_cap_channel_handle_t xCaptureChannel;
-    TaskHandle_t xTaskHandle;
+    TaskHandle_t xTaskHandle;                   // 等待回波的任务，每次测量时设置
+    uint8_t ucSlot;                             // 测距服务的时间片，默认 SR04_SLOT_AUTO 单独一个时间片；设置相同的值(小于 SR04_MAX_SENSOR)时同时触发，只用于互不干扰(朝向不同)的传感器
+    /* 以下由驱动内部使用 */
+    uint8_t ucRangerSlot;                       // 测距服务实际使用的时间片
+    uint32_t uxCaptureBeginValue;               // 回波上升沿的计数值
+    volatile uint32_t uxTofTicks;               // 回波脉宽计数
+    volatile bool xEchoDone;                    // 本次测量是否已收到回波
+    filter_hampel_t xHampel;                    // 离群点剔除
+    int32_t lHampelBuf[SR04_HAMPEL_WIN];
+    filter_ema_t xEma;                          // 平滑
+    int32_t lDistanceMM;                        // 最近一次滤波后的距离（毫米）
+    esp_err_t xLastStatus;                      // 最近一次测量的结果
 } SR04_t;
 
+/**
+ * @brief 测距服务结果回调，在测距任务中执行
+ *
+ * @param pxSR04 传感器
+ * @param xStatus ESP_OK、ESP_ERR_TIMEOUT（无回波）或 ESP_ERR_INVALID_SIZE（超出量程）
+ * @param lDistanceMM 滤波后的距离（毫米），失败时为上一次的有效值
+ * @param pvArg 用户参数
+ */
+typedef void (*SR04ResultCallback_t)(SR04_t *pxSR04, esp_err_t xStatus, int32_t lDistanceMM, void *pvArg);
+
 /**
  * @brief 初始化HC-SR04超声波传感器
  * 
@@ -46,6 +72,38 @@ esp_err_t xSR04Deinit(SR04_t *sr04);
  */
 esp_err_t xSR04MeasureDistance(SR04_t *sr04, float *distance_cm, uint32_t timeout_ms);
 
+/**
+ * @brief 启动连续测距服务
+ *
+ * 一个任务按时间片轮流触发所有传感器：同一时间片内的传感器同时触发，不同时间片之间
+ * 留出余波衰减时间，避免相互串扰。结果经离群点剔除和平滑后通过回调发布
+ * ucSlot 为 SR04_SLOT_AUTO(默认)的传感器各自排在显式指定的时间片之后，每个单独一个时间片
+ *
+ * @param ppxSensors 已初始化的传感器数组
+ * @param ucNum 传感器个数，不超过 SR04_MAX_SENSOR
+ * @param uxCyclePeriod_MS 一轮测量的周期（毫秒）
+ * @param pxCallback 结果回调，可以为 NULL
+ * @param pvArg 回调的用户参数
+ * @return esp_err_t 错误代码，ucSlot 不是 SR04_SLOT_AUTO 且不小于 SR04_MAX_SENSOR 时返回 ESP_ERR_INVALID_ARG
+ */
+esp_err_t xSR04RangerStart(SR04_t **ppxSensors, uint8_t ucNum, uint32_t uxCyclePeriod_MS, SR04ResultCallback_t pxCallback, void *pvArg);
+
+/**
+ * @brief 获取测距服务最近一次滤波后的距离
+ *
+ * @param pxSR04 传感器
+ * @param plDistanceMM 距离（毫米）
+ * @return esp_err_t 最近一次测量的结果
+ */
+esp_err_t xSR04GetDistance(SR04_t *pxSR04, int32_t *plDistanceMM);
+
+/**
+ * @brief 设置环境温度，用于修正声速
+ *
+ * @param lTempX100 温度X100（℃）
+ */
+void vSR04SetTemperature(int32_t lTempX100);
+
 #ifdef __cplusplus
 }
 #endif
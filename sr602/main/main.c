@@ -3,12 +3,35 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
+#include "pir.h"
 
 static const char* TAG = "main";
 
 #define LED_GPIO    GPIO_NUM_27
 #define SR602_GPIO  GPIO_NUM_34
 
+/** PIR 事件回调，有人时点亮 LED，无人时熄灭
+ * @param event 事件
+ * @param arg 无
+ * @return 无
+*/
+static void pir_led_cb(const pir_event_t *event, void *arg)
+{
+    switch (event->type)
+    {
+    case PIR_EVENT_OCCUPIED:
+        gpio_set_level(LED_GPIO,1);
+        break;
+    case PIR_EVENT_RETRIGGER:
+        ESP_LOGI(TAG,"retrigger %lu", event->trigger_cnt);
+        break;
+    case PIR_EVENT_VACANT:
+        gpio_set_level(LED_GPIO,0);
+        break;
+    default:break;
+    }
+}
+
 void app_main(void)
 {
     gpio_config_t led_gpio = 
@@ -23,22 +46,12 @@ void app_main(void)
     
     gpio_set_level(LED_GPIO,0);
 
-    gpio_config_t sr602_gpio = 
+    pir_config_t pir_cfg = 
     {
-        .intr_type = GPIO_INTR_DISABLE,
-        .mode = GPIO_MODE_INPUT,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pin_bit_mask = (1ull<<SR602_GPIO)
+        .gpio_num = SR602_GPIO,
+        .active_level = 1,
+        .hold_time_ms = 5000,       //SR602 输出无效后，5 秒内没有再次触发才认为无人
     };
-    gpio_config(&sr602_gpio);
-
-    while(1)
-    {
-        if(gpio_get_level(SR602_GPIO))
-            gpio_set_level(LED_GPIO,1);
-        else
-            gpio_set_level(LED_GPIO,0);
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
+    pir_subscribe(pir_led_cb, NULL);
+    ESP_ERROR_CHECK(pir_init(&pir_cfg));
 }
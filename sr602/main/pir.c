@@ -0,0 +1,269 @@
+#include "pir.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+static const char* TAG = "pir";
+
+#define PIR_QUEUE_LEN   16      //边沿事件队列长度
+
+//中断里记录的边沿
+typedef struct
+{
+    int64_t time_us;        //发生时刻
+    int level;              //边沿之后的电平
+}pir_edge_t;
+
+//订阅者
+typedef struct
+{
+    pir_event_cb cb;
+    void *arg;
+}pir_subscriber_t;
+
+static pir_config_t s_pir_cfg;
+static QueueHandle_t s_edge_queue = NULL;
+static volatile uint32_t s_hold_time_ms = 0;
+static volatile uint32_t s_dropped = 0;
+
+//占用状态机，只在 PIR 任务中修改
+static volatile pir_state_t s_state = PIR_STATE_VACANT;
+static bool s_sensor_active = false;        //传感器当前是否输出有效电平
+static int64_t s_vacant_deadline = 0;       //传感器无效后，到这个时刻还没有再次触发就变为无人
+static int64_t s_occupied_us = 0;
+static uint32_t s_trigger_cnt = 0;
+static volatile int64_t s_last_motion = -1;
+
+static pir_subscriber_t s_subscriber[PIR_MAX_SUBSCRIBER];
+static portMUX_TYPE s_subscriber_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** gpio 中断，记录时刻和电平后交给 PIR 任务
+ * @param arg 无
+ * @return 无
+*/
+static void IRAM_ATTR pir_isr_handler(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    pir_edge_t edge =
+    {
+        .time_us = esp_timer_get_time(),
+        .level = gpio_get_level(s_pir_cfg.gpio_num),
+    };
+    if (xQueueSendFromISR(s_edge_queue, &edge, &woken) != pdTRUE)
+        s_dropped++;
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+/** 通知所有订阅者，回调在锁外执行，回调里可以订阅/取消订阅
+ * @param type 事件类型
+ * @param time_us 事件时刻
+ * @return 无
+*/
+static void pir_publish(pir_event_type_t type, int64_t time_us)
+{
+    pir_subscriber_t subscriber[PIR_MAX_SUBSCRIBER];
+    pir_event_t event =
+    {
+        .type = type,
+        .time_us = time_us,
+        .occupied_us = s_occupied_us,
+        .trigger_cnt = s_trigger_cnt,
+    };
+    portENTER_CRITICAL(&s_subscriber_lock);
+    memcpy(subscriber, s_subscriber, sizeof(subscriber));
+    portEXIT_CRITICAL(&s_subscriber_lock);
+    for (int i = 0; i < PIR_MAX_SUBSCRIBER; i++)
+    {
+        if (subscriber[i].cb)
+            subscriber[i].cb(&event, subscriber[i].arg);
+    }
+}
+
+/** 处理一个边沿
+ * @param edge 边沿
+ * @return 无
+*/
+static void pir_handle_edge(const pir_edge_t *edge)
+{
+    bool active = (edge->level == s_pir_cfg.active_level);
+    //抖动或者中断来得比读电平晚，电平没有变化的边沿忽略
+    if (active == s_sensor_active)
+        return;
+    s_sensor_active = active;
+    if (active)
+    {
+        s_last_motion = edge->time_us;
+        if (s_state == PIR_STATE_VACANT)
+        {
+            s_state = PIR_STATE_OCCUPIED;
+            s_occupied_us = edge->time_us;
+            s_trigger_cnt = 1;
+            ESP_LOGI(TAG, "occupied");
+            pir_publish(PIR_EVENT_OCCUPIED, edge->time_us);
+        }
+        else
+        {
+            s_trigger_cnt++;
+            pir_publish(PIR_EVENT_RETRIGGER, edge->time_us);
+        }
+    }
+    else
+    {
+        //传感器输出无效，开始计算保持时间
+        s_vacant_deadline = edge->time_us + (int64_t)s_hold_time_ms * 1000;
+    }
+}
+
+/** PIR 任务，无人时一直阻塞在队列上，有人时最多阻塞到保持时间结束
+ * @param param 无
+ * @return 无
+*/
+static void pir_task(void *param)
+{
+    pir_edge_t edge;
+    while (1)
+    {
+        TickType_t wait = portMAX_DELAY;
+        if (s_state == PIR_STATE_OCCUPIED && !s_sensor_active)
+        {
+            int64_t remain = s_vacant_deadline - esp_timer_get_time();
+            wait = remain > 0 ? pdMS_TO_TICKS((remain + 999) / 1000) + 1 : 0;
+        }
+        if (xQueueReceive(s_edge_queue, &edge, wait) == pdTRUE)
+        {
+            pir_handle_edge(&edge);
+            continue;
+        }
+        if (s_state == PIR_STATE_OCCUPIED && !s_sensor_active && esp_timer_get_time() >= s_vacant_deadline)
+        {
+            s_state = PIR_STATE_VACANT;
+            ESP_LOGI(TAG, "vacant, %lu triggers in %lld ms", s_trigger_cnt, (s_vacant_deadline - s_occupied_us) / 1000);
+            pir_publish(PIR_EVENT_VACANT, s_vacant_deadline);
+        }
+    }
+}
+
+/** 初始化 PIR 检测，gpio 双边沿中断驱动，没有事件时任务一直阻塞
+ * @param cfg 配置
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t pir_init(const pir_config_t *cfg)
+{
+    if (s_edge_queue)
+        return ESP_FAIL;
+    s_pir_cfg = *cfg;
+    s_hold_time_ms = cfg->hold_time_ms;
+    s_edge_queue = xQueueCreate(PIR_QUEUE_LEN, sizeof(pir_edge_t));
+    if (!s_edge_queue)
+        return ESP_FAIL;
+
+    gpio_config_t pir_gpio =
+    {
+        .intr_type = GPIO_INTR_ANYEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pin_bit_mask = (1ull<<cfg->gpio_num)
+    };
+    ESP_ERROR_CHECK(gpio_config(&pir_gpio));
+
+    //中断服务可能已经被其他模块安装过
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+        return ESP_FAIL;
+
+    if (xTaskCreatePinnedToCore(pir_task, "pir", 3072, NULL, 5, NULL, 1) != pdPASS)
+        return ESP_FAIL;
+
+    ESP_ERROR_CHECK(gpio_isr_handler_add(cfg->gpio_num, pir_isr_handler, NULL));
+
+    //上电时传感器可能已经在输出有效电平，补一个边沿
+    pir_edge_t edge =
+    {
+        .time_us = esp_timer_get_time(),
+        .level = gpio_get_level(cfg->gpio_num),
+    };
+    xQueueSend(s_edge_queue, &edge, 0);
+    return ESP_OK;
+}
+
+/** 订阅事件
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int pir_subscribe(pir_event_cb cb, void *arg)
+{
+    int id = -1;
+    if (!cb)
+        return -1;
+    portENTER_CRITICAL(&s_subscriber_lock);
+    for (int i = 0; i < PIR_MAX_SUBSCRIBER; i++)
+    {
+        if (!s_subscriber[i].cb)
+        {
+            s_subscriber[i].cb = cb;
+            s_subscriber[i].arg = arg;
+            id = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_subscriber_lock);
+    return id;
+}
+
+/** 取消订阅
+ * @param id pir_subscribe 返回的订阅编号
+ * @return 无
+*/
+void pir_unsubscribe(int id)
+{
+    if (id < 0 || id >= PIR_MAX_SUBSCRIBER)
+        return;
+    portENTER_CRITICAL(&s_subscriber_lock);
+    s_subscriber[id].cb = NULL;
+    s_subscriber[id].arg = NULL;
+    portEXIT_CRITICAL(&s_subscriber_lock);
+}
+
+/** 修改保持时间，下一次传感器输出变为无效时生效
+ * @param hold_time_ms 保持时间
+ * @return 无
+*/
+void pir_set_hold_time(uint32_t hold_time_ms)
+{
+    s_hold_time_ms = hold_time_ms;
+}
+
+/** 获取当前占用状态
+ * @param 无
+ * @return 状态
+*/
+pir_state_t pir_get_state(void)
+{
+    return s_state;
+}
+
+/** 获取最后一次检测到移动的时刻
+ * @param 无
+ * @return 时刻(us)，从未检测到时返回-1
+*/
+int64_t pir_get_last_motion(void)
+{
+    return s_last_motion;
+}
+
+/** 获取因事件队列满而丢弃的边沿个数
+ * @param 无
+ * @return 个数
+*/
+uint32_t pir_get_dropped(void)
+{
+    return s_dropped;
+}
@@ -0,0 +1,90 @@
+#ifndef _PIR_H_
+#define _PIR_H_
+#include <stdint.h>
+#include "esp_err.h"
+
+#define PIR_MAX_SUBSCRIBER  4       //最多订阅者个数
+
+//占用状态
+typedef enum
+{
+    PIR_STATE_VACANT,       //无人
+    PIR_STATE_OCCUPIED,     //有人
+}pir_state_t;
+
+//事件类型
+typedef enum
+{
+    PIR_EVENT_OCCUPIED,     //无人->有人
+    PIR_EVENT_RETRIGGER,    //有人期间再次检测到移动，保持时间重新计算
+    PIR_EVENT_VACANT,       //传感器输出无效并且超过保持时间，有人->无人
+}pir_event_type_t;
+
+//事件
+typedef struct
+{
+    pir_event_type_t type;  //事件类型
+    int64_t time_us;        //触发时刻(esp_timer_get_time)，OCCUPIED/RETRIGGER 为中断发生的时刻
+    int64_t occupied_us;    //本次有人的起始时刻
+    uint32_t trigger_cnt;   //本次有人期间的触发次数(包括第一次)
+}pir_event_t;
+
+/** 事件回调函数，在 PIR 任务中执行，不要长时间阻塞
+ * @param event 事件
+ * @param arg 用户参数
+ * @return 无
+*/
+typedef void (*pir_event_cb)(const pir_event_t *event, void *arg);
+
+//配置
+typedef struct
+{
+    int gpio_num;           //传感器输出的gpio号
+    int active_level;       //检测到人时的电平
+    uint32_t hold_time_ms;  //传感器输出变为无效后，持续多久没有再次触发才认为无人
+}pir_config_t;
+
+/** 初始化 PIR 检测，gpio 双边沿中断驱动，没有事件时任务一直阻塞
+ * @param cfg 配置
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t pir_init(const pir_config_t *cfg);
+
+/** 订阅事件
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int pir_subscribe(pir_event_cb cb, void *arg);
+
+/** 取消订阅
+ * @param id pir_subscribe 返回的订阅编号
+ * @return 无
+*/
+void pir_unsubscribe(int id);
+
+/** 修改保持时间，下一次传感器输出变为无效时生效
+ * @param hold_time_ms 保持时间
+ * @return 无
+*/
+void pir_set_hold_time(uint32_t hold_time_ms);
+
+/** 获取当前占用状态
+ * @param 无
+ * @return 状态
+*/
+pir_state_t pir_get_state(void);
+
+/** 获取最后一次检测到移动的时刻
+ * @param 无
+ * @return 时刻(us)，从未检测到时返回-1
+*/
+int64_t pir_get_last_motion(void);
+
+/** 获取因事件队列满而丢弃的边沿个数
+ * @param 无
+ * @return 个数
+*/
+uint32_t pir_get_dropped(void);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * rollup 的主机测试
+ *  1、随机时间间隔(含长时间没有数据)和随机数值写入，每一级保留的桶与暴力聚合的结果一致，覆盖环形缓存的覆盖
+ *  2、随机窗口的 rollup_window 与暴力合并窗口内的桶一致
+ *  3、rollup_mean 四舍五入，负数远离0
+ *  4、比当前桶早的数据丢弃，参数错误返回 ESP_ERR_INVALID_ARG
+ *
+ * 用法: rollup_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "rollup.h"
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __func__, __LINE__); printf(__VA_ARGS__); printf("\n"); return 1; } } while (0)
+
+#define TEST_TS0            1700000000000ll     //起始时间戳(ms)
+
+//桶很少，随机数据很快就会覆盖旧桶
+static const rollup_level_cfg_t s_cfg[] =
+{
+    {.width_ms = 1000, .len = 16},
+    {.width_ms = 60 * 1000, .len = 8},
+    {.width_ms = 60 * 60 * 1000, .len = 4},
+};
+#define LEVEL_NUM   ((int)(sizeof(s_cfg) / sizeof(s_cfg[0])))
+
+typedef struct
+{
+    int64_t ts;
+    int32_t value;
+}sample_t;
+
+static uint32_t s_seed = 1;
+
+static uint32_t rand_u32(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 8;
+}
+
+/** 暴力聚合：按桶宽度把全部采样分组，返回最近 len 个有数据的桶
+ * @param samples 采样，时间不减
+ * @param num 采样个数
+ * @param cfg 级的配置
+ * @param out 输出，至少 cfg->len 个
+ * @return 桶个数
+*/
+static int expect_buckets(const sample_t *samples, int num, const rollup_level_cfg_t *cfg, rollup_bucket_t *out)
+{
+    int total = 0;
+    rollup_bucket_t *all = malloc(sizeof(rollup_bucket_t) * (num + 1));
+    for (int i = 0; i < num; i++)
+    {
+        int64_t start = samples[i].ts - samples[i].ts % cfg->width_ms;
+        if (total == 0 || all[total - 1].start != start)
+        {
+            all[total].start = start;
+            all[total].sum = 0;
+            all[total].min = samples[i].value;
+            all[total].max = samples[i].value;
+            all[total].count = 0;
+            total++;
+        }
+        rollup_bucket_t *b = &all[total - 1];
+        b->sum += samples[i].value;
+        if (samples[i].value < b->min)
+            b->min = samples[i].value;
+        if (samples[i].value > b->max)
+            b->max = samples[i].value;
+        b->count++;
+    }
+    int keep = total < cfg->len ? total : cfg->len;
+    memcpy(out, &all[total - keep], sizeof(rollup_bucket_t) * keep);
+    free(all);
+    return keep;
+}
+
+static bool bucket_equal(const rollup_bucket_t *a, const rollup_bucket_t *b)
+{
+    if (a->count != b->count)
+        return false;
+    if (a->count == 0)
+        return true;
+    return a->start == b->start && a->sum == b->sum && a->min == b->min && a->max == b->max;
+}
+
+/** 每一级的桶、随机窗口的聚合与暴力结果比较
+ * @param series 序列
+ * @param samples 已经写入的采样
+ * @param num 采样个数
+ * @return 失败个数
+*/
+static int check_series(rollup_series_t *series, const sample_t *samples, int num)
+{
+    rollup_bucket_t got[64], expect[64];
+    for (int level = 0; level < LEVEL_NUM; level++)
+    {
+        int n = rollup_buckets(series, level, got, 64);
+        int e = expect_buckets(samples, num, &s_cfg[level], expect);
+        CHECK(n == e, "level %d after %d samples: %d buckets, expect %d", level, num, n, e);
+        for (int i = 0; i < n; i++)
+        {
+            CHECK(bucket_equal(&got[i], &expect[i]), "level %d bucket %d: start %lld count %u sum %lld min %d max %d, "
+                  "expect start %lld count %u sum %lld min %d max %d", level, i,
+                  (long long)got[i].start, (unsigned)got[i].count, (long long)got[i].sum, (int)got[i].min, (int)got[i].max,
+                  (long long)expect[i].start, (unsigned)expect[i].count, (long long)expect[i].sum, (int)expect[i].min, (int)expect[i].max);
+            int32_t mean = (int32_t)llround((double)expect[i].sum / expect[i].count);
+            CHECK(rollup_mean(&got[i]) == mean, "level %d bucket %d: mean %d, expect %d", level, i, (int)rollup_mean(&got[i]), (int)mean);
+        }
+        //最近几个桶只取一部分
+        if (e > 1)
+        {
+            n = rollup_buckets(series, level, got, e - 1);
+            CHECK(n == e - 1 && bucket_equal(&got[0], &expect[1]), "level %d: last %d buckets", level, e - 1);
+        }
+        if (e == 0)
+            continue;
+
+        //随机窗口，边界在保留的时间范围前后各延伸一些
+        int64_t lo = expect[0].start - s_cfg[level].width_ms * 2;
+        int64_t span = expect[e - 1].start - lo + s_cfg[level].width_ms * 3;
+        for (int k = 0; k < 8; k++)
+        {
+            int64_t from = lo + (int64_t)(rand_u32() % (uint32_t)span);
+            int64_t to = from + (int64_t)(rand_u32() % (uint32_t)span);
+            //一半的窗口边界正好落在桶的开始时间上
+            if (k & 1)
+            {
+                from = expect[rand_u32() % e].start;
+                to = expect[rand_u32() % e].start;
+                if (to < from)
+                {
+                    int64_t t = from;
+                    from = to;
+                    to = t;
+                }
+            }
+            rollup_bucket_t window, sum = {0};
+            CHECK(rollup_window(series, level, from, to, &window) == ESP_OK, "window");
+            for (int i = 0; i < e; i++)
+            {
+                if (expect[i].start < from || expect[i].start >= to)
+                    continue;
+                if (sum.count == 0)
+                {
+                    sum.start = expect[i].start;
+                    sum.min = expect[i].min;
+                    sum.max = expect[i].max;
+                }
+                if (expect[i].min < sum.min)
+                    sum.min = expect[i].min;
+                if (expect[i].max > sum.max)
+                    sum.max = expect[i].max;
+                sum.sum += expect[i].sum;
+                sum.count += expect[i].count;
+            }
+            CHECK(bucket_equal(&window, &sum), "level %d window [%lld, %lld): start %lld count %u sum %lld, expect start %lld count %u sum %lld",
+                  level, (long long)from, (long long)to, (long long)window.start, (unsigned)window.count, (long long)window.sum,
+                  (long long)sum.start, (unsigned)sum.count, (long long)sum.sum);
+        }
+    }
+    return 0;
+}
+
+/** 随机采样写入，每写入一些就和暴力聚合比较一次
+ * @param 无
+ * @return 失败个数
+*/
+static int test_random(void)
+{
+    enum { NUM = 4000 };
+    rollup_series_t series;
+    sample_t *samples = malloc(sizeof(sample_t) * NUM);
+    int64_t ts = TEST_TS0;
+    CHECK(rollup_init(&series, "random", s_cfg, LEVEL_NUM) == ESP_OK, "init");
+    for (int i = 0; i < NUM; i++)
+    {
+        //大部分间隔在1秒左右，偶尔同一时刻、几分钟或几小时没有数据
+        uint32_t r = rand_u32() % 100;
+        if (r < 5)
+            ts += 0;
+        else if (r < 90)
+            ts += 200 + rand_u32() % 2000;
+        else if (r < 98)
+            ts += 60 * 1000 + rand_u32() % (10 * 60 * 1000);
+        else
+            ts += 60 * 60 * 1000 + rand_u32() % (5 * 60 * 60 * 1000);
+        samples[i].ts = ts;
+        samples[i].value = (int32_t)(rand_u32() % 2001) - 1000;
+        rollup_add(&series, samples[i].ts, samples[i].value);
+        if (i % 7 == 0 || i == NUM - 1)
+        {
+            if (check_series(&series, samples, i + 1))
+            {
+                free(samples);
+                return 1;
+            }
+        }
+    }
+    printf("rollup random: %d samples ok\n", NUM);
+    free(samples);
+    for (int level = 0; level < LEVEL_NUM; level++)
+        free(series.level[level].buckets);
+    return 0;
+}
+
+/** 平均值四舍五入、旧数据丢弃和参数检查
+ * @param 无
+ * @return 失败个数
+*/
+static int test_edges(void)
+{
+    static const struct { int64_t sum; uint32_t count; int32_t mean; } means[] =
+    {
+        {0, 0, 0}, {3, 2, 2}, {-3, 2, -2}, {5, 4, 1}, {-5, 4, -1}, {7, 4, 2}, {-7, 4, -2},
+        {(int64_t)INT32_MAX * 3, 3, INT32_MAX}, {(int64_t)INT32_MIN * 3, 3, INT32_MIN},
+    };
+    for (size_t i = 0; i < sizeof(means) / sizeof(means[0]); i++)
+    {
+        rollup_bucket_t b = {.sum = means[i].sum, .count = means[i].count};
+        CHECK(rollup_mean(&b) == means[i].mean, "mean %lld/%u = %d, expect %d", (long long)means[i].sum,
+              (unsigned)means[i].count, (int)rollup_mean(&b), (int)means[i].mean);
+    }
+
+    rollup_series_t series;
+    rollup_bucket_t got[4], window;
+    CHECK(rollup_init(&series, "order", s_cfg, LEVEL_NUM) == ESP_OK, "init");
+    rollup_add(&series, TEST_TS0 + 5000, 10);
+    rollup_add(&series, TEST_TS0 + 3000, 99);       //比当前秒桶早，秒级丢弃
+    rollup_add(&series, TEST_TS0 + 5999, 20);
+    CHECK(rollup_buckets(&series, 0, got, 4) == 1 && got[0].count == 2 && got[0].sum == 30, "older sample kept in level 0");
+    //分钟桶还是同一个，旧数据照样计入
+    CHECK(rollup_buckets(&series, 1, got, 4) == 1 && got[0].count == 3 && got[0].max == 99, "level 1");
+    CHECK(rollup_window(&series, LEVEL_NUM, 0, INT64_MAX, &window) == ESP_ERR_INVALID_ARG, "bad level");
+    CHECK(rollup_window(&series, -1, 0, INT64_MAX, &window) == ESP_ERR_INVALID_ARG, "bad level");
+    CHECK(rollup_buckets(&series, LEVEL_NUM, got, 4) == 0, "bad level");
+    CHECK(rollup_window(&series, 0, TEST_TS0 + 6000, INT64_MAX, &window) == ESP_OK && window.count == 0, "empty window");
+    for (int level = 0; level < LEVEL_NUM; level++)
+        free(series.level[level].buckets);
+
+    static const rollup_level_cfg_t bad[] = {{.width_ms = 1000, .len = 4}, {.width_ms = 0, .len = 4}};
+    CHECK(rollup_init(&series, "bad", bad, 2) == ESP_ERR_INVALID_ARG, "zero width accepted");
+    CHECK(rollup_init(&series, "bad", bad, 0) == ESP_ERR_INVALID_ARG, "no level accepted");
+    CHECK(rollup_init(&series, "bad", s_cfg, ROLLUP_MAX_LEVEL + 1) == ESP_ERR_INVALID_ARG, "too many levels accepted");
+    return 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+    fail += test_edges();
+    fail += test_random();
+    if (fail)
+        printf("%d test(s) failed\n", fail);
+    return fail ? 1 : 0;
+}
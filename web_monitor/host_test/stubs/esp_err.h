@@ -0,0 +1,17 @@
+#ifndef _HOST_ESP_ERR_H_
+#define _HOST_ESP_ERR_H_
+//主机测试用的 esp_err.h，只有用到的错误码
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+
+#define ESP_ERROR_CHECK(x)      do { esp_err_t err_rc_ = (x); (void)err_rc_; } while (0)
+
+#endif
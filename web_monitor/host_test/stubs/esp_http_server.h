@@ -0,0 +1,91 @@
+#ifndef _HOST_ESP_HTTP_SERVER_H_
+#define _HOST_ESP_HTTP_SERVER_H_
+//主机测试用的 esp_http_server.h，只有 ws.c 用到的接口
+//WebSocket 帧在 socket 上的格式简化为 [类型 1字节][长度 2字节大端][数据]
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_work_fn_t)(void *arg);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+typedef enum
+{
+    HTTP_GET = 1,
+    HTTP_POST = 3,
+}httpd_method_t;
+
+//请求，fd和payload由测试程序填写，代替真实的连接
+typedef struct httpd_req
+{
+    httpd_handle_t handle;
+    int method;
+    const char uri[64];
+    int fd;
+    const uint8_t *payload;
+    size_t payload_len;
+}httpd_req_t;
+
+typedef struct
+{
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+}httpd_uri_t;
+
+typedef struct
+{
+    httpd_close_func_t close_fn;
+    uint16_t send_wait_timeout;
+    httpd_uri_match_func_t uri_match_fn;
+}httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG()  { .close_fn = NULL, .send_wait_timeout = 5, .uri_match_fn = NULL }
+#define HTTPD_RESP_USE_STRLEN   -1
+
+typedef enum
+{
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+}httpd_ws_type_t;
+
+typedef enum
+{
+    HTTPD_WS_CLIENT_INVALID = 0x0,
+    HTTPD_WS_CLIENT_HTTP = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+}httpd_ws_client_info_t;
+
+typedef struct
+{
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+}httpd_ws_frame_t;
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+int httpd_req_to_sockfd(httpd_req_t *r);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd);
+
+#endif
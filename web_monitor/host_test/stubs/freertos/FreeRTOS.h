@@ -0,0 +1,18 @@
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+//主机上用一把全局互斥锁代替 portMUX 临界区
+#include <stdint.h>
+#include <pthread.h>
+
+typedef uint32_t TickType_t;
+#define portMAX_DELAY                   ((TickType_t)0xffffffffUL)
+
+typedef int portMUX_TYPE;
+extern pthread_mutex_t host_critical_mutex;
+
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define portMUX_INITIALIZE(mux)         (*(mux) = portMUX_INITIALIZER_UNLOCKED)
+#define portENTER_CRITICAL(mux)         do { (void)(mux); pthread_mutex_lock(&host_critical_mutex); } while (0)
+#define portEXIT_CRITICAL(mux)          do { (void)(mux); pthread_mutex_unlock(&host_critical_mutex); } while (0)
+
+#endif
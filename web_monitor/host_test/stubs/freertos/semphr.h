@@ -0,0 +1,27 @@
+#ifndef _HOST_SEMPHR_H_
+#define _HOST_SEMPHR_H_
+//主机上用 pthread 互斥锁代替 FreeRTOS 互斥信号量，只支持一直等待
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t mutex = malloc(sizeof(pthread_mutex_t));
+    if (mutex)
+        pthread_mutex_init(mutex, NULL);
+    return mutex;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return pthread_mutex_lock(sem) == 0;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pthread_mutex_unlock(sem) == 0;
+}
+
+#endif
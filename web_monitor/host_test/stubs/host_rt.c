@@ -0,0 +1,279 @@
+/*
+ * 主机上的 httpd / esp_timer 替身
+ * httpd：一个工作线程按顺序执行 httpd_queue_work 排队的工作，与httpd任务一致
+ * esp_timer：一个线程按到期时间依次执行回调，与 ESP_TIMER_TASK 一致
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+
+#define HOST_WORK_QUEUE_LEN     1024
+#define HOST_MAX_FD             1024
+#define HOST_MAX_TIMER          8
+#define HOST_TIMER_TICK_US      100
+
+pthread_mutex_t host_critical_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct
+{
+    httpd_work_fn_t fn;
+    void *arg;
+}host_work_t;
+
+static host_work_t s_work[HOST_WORK_QUEUE_LEN];
+static int s_work_head = 0, s_work_tail = 0;
+static pthread_mutex_t s_work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_work_cond = PTHREAD_COND_INITIALIZER;
+static httpd_close_func_t s_close_fn = NULL;
+static bool s_closed[HOST_MAX_FD];
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t due;            //0 表示没有启动
+    int64_t period;
+};
+
+static struct esp_timer s_timers[HOST_MAX_TIMER];
+static int s_timer_num = 0;
+static pthread_mutex_t s_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 0;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 0;
+}
+
+static void *host_httpd_task(void *arg)
+{
+    while (1)
+    {
+        pthread_mutex_lock(&s_work_mutex);
+        while (s_work_head == s_work_tail)
+            pthread_cond_wait(&s_work_cond, &s_work_mutex);
+        host_work_t work = s_work[s_work_head];
+        s_work_head = (s_work_head + 1) % HOST_WORK_QUEUE_LEN;
+        pthread_mutex_unlock(&s_work_mutex);
+        work.fn(work.arg);
+    }
+    return NULL;
+}
+
+static void *host_timer_task(void *arg)
+{
+    while (1)
+    {
+        esp_timer_cb_t callback = NULL;
+        void *cb_arg = NULL;
+        pthread_mutex_lock(&s_timer_mutex);
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < s_timer_num; i++)
+        {
+            struct esp_timer *timer = &s_timers[i];
+            if (timer->due && timer->due <= now)
+            {
+                callback = timer->callback;
+                cb_arg = timer->arg;
+                timer->due = timer->period ? now + timer->period : 0;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&s_timer_mutex);
+        if (callback)
+            callback(cb_arg);
+        else
+            usleep(HOST_TIMER_TICK_US);
+    }
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    pthread_t thread;
+    s_close_fn = config->close_fn;
+    *handle = (httpd_handle_t)&s_work;
+    pthread_create(&thread, NULL, host_httpd_task, NULL);
+    pthread_detach(thread);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    return false;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_work_mutex);
+    if ((s_work_tail + 1) % HOST_WORK_QUEUE_LEN == s_work_head)
+    {
+        ret = ESP_FAIL;
+    }
+    else
+    {
+        s_work[s_work_tail].fn = work;
+        s_work[s_work_tail].arg = arg;
+        s_work_tail = (s_work_tail + 1) % HOST_WORK_QUEUE_LEN;
+        pthread_cond_signal(&s_work_cond);
+    }
+    pthread_mutex_unlock(&s_work_mutex);
+    return ret;
+}
+
+//与httpd一样，在httpd任务中关闭连接并调用close_fn
+static void host_close_work(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    if (s_closed[fd])
+        return;
+    s_closed[fd] = true;
+    if (s_close_fn)
+        s_close_fn(NULL, fd);
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    return httpd_queue_work(handle, host_close_work, (void *)(intptr_t)sockfd);
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return r->fd;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    return ESP_OK;
+}
+
+//max_len为0时只返回长度，与httpd相同
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    pkt->type = HTTPD_WS_TYPE_TEXT;
+    pkt->len = req->payload_len;
+    if (max_len == 0)
+        return ESP_OK;
+    if (req->payload_len > max_len)
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(pkt->payload, req->payload, req->payload_len);
+    return ESP_OK;
+}
+
+static bool host_send_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len)
+    {
+        ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return false;
+        data += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    uint8_t head[3] = {(uint8_t)frame->type, (uint8_t)(frame->len >> 8), (uint8_t)frame->len};
+    if (!host_send_all(fd, head, sizeof(head)) || !host_send_all(fd, frame->payload, frame->len))
+        return ESP_FAIL;
+    return ESP_OK;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    return s_closed[fd] ? HTTPD_WS_CLIENT_INVALID : HTTPD_WS_CLIENT_WEBSOCKET;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    static pthread_t thread;
+    pthread_mutex_lock(&s_timer_mutex);
+    if (s_timer_num == HOST_MAX_TIMER)
+    {
+        pthread_mutex_unlock(&s_timer_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    struct esp_timer *timer = &s_timers[s_timer_num];
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->due = 0;
+    timer->period = 0;
+    if (s_timer_num++ == 0)
+    {
+        pthread_create(&thread, NULL, host_timer_task, NULL);
+        pthread_detach(thread);
+    }
+    pthread_mutex_unlock(&s_timer_mutex);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+//已经在运行时返回 ESP_ERR_INVALID_STATE，与esp_timer相同
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_mutex);
+    if (timer->due)
+        ret = ESP_ERR_INVALID_STATE;
+    else
+        timer->due = esp_timer_get_time() + timeout_us;
+    pthread_mutex_unlock(&s_timer_mutex);
+    return ret;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_mutex);
+    if (timer->due)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        timer->period = period;
+        timer->due = esp_timer_get_time() + period;
+    }
+    pthread_mutex_unlock(&s_timer_mutex);
+    return ret;
+}
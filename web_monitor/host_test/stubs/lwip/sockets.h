@@ -0,0 +1,6 @@
+#ifndef _HOST_LWIP_SOCKETS_H_
+#define _HOST_LWIP_SOCKETS_H_
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
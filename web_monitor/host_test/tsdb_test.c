@@ -0,0 +1,359 @@
+/*
+ * tsdb 的主机测试和压测
+ *  1、往返：写入的点按原样读回，覆盖编码分档的边界值、int32 极值、超过 int32 的时间间隔
+ *  2、块用完后覆盖最旧的块，读回的是最近的点，evicted 与丢弃的点数一致
+ *  3、随机范围查询与暴力过滤结果比较
+ *  4、--bench N：几种典型数据写入/读出 N 个点的速度和每个点占用的字节数
+ *
+ * 用法: tsdb_test [--bench N] [--max-bpp BYTES]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tsdb.h"
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __func__, __LINE__); printf(__VA_ARGS__); printf("\n"); return 1; } } while (0)
+
+#define TEST_TS0            1700000000000ll     //起始时间戳(ms)
+
+static uint32_t s_seed = 1;
+
+static uint32_t rand_u32(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 8;
+}
+
+//读回序列中的全部点
+static int read_all(tsdb_series_t *series, tsdb_point_t *out, int max)
+{
+    tsdb_iter_t it;
+    int num = 0;
+    tsdb_lock(series);
+    tsdb_iter_init(&it, series, INT64_MIN, INT64_MAX);
+    while (num < max && tsdb_iter_next(&it, &out[num]))
+        num++;
+    tsdb_unlock(series);
+    return num;
+}
+
+/** 写入 points 后全部读回并逐点比较
+ * @param name 用例名
+ * @param points 数据
+ * @param num 点数
+ * @param block_num 块个数，足够放下全部点
+ * @return 失败个数
+*/
+static int roundtrip(const char *name, const tsdb_point_t *points, int num, uint16_t block_num)
+{
+    tsdb_series_t series;
+    tsdb_point_t *out = malloc(sizeof(tsdb_point_t) * (num + 1));
+    CHECK(tsdb_series_init(&series, name, block_num) == ESP_OK, "%s: init", name);
+    for (int i = 0; i < num; i++)
+        CHECK(tsdb_append(&series, points[i].ts, points[i].value) == ESP_OK, "%s: append %d", name, i);
+    int got = read_all(&series, out, num + 1);
+    CHECK(series.evicted == 0, "%s: %u points evicted", name, (unsigned)series.evicted);
+    CHECK(got == num && tsdb_count(&series) == (uint32_t)num, "%s: read %d of %d", name, got, num);
+    for (int i = 0; i < num; i++)
+        CHECK(out[i].ts == points[i].ts && out[i].value == points[i].value, "%s: point %d: %lld,%d != %lld,%d", name, i,
+              (long long)out[i].ts, (int)out[i].value, (long long)points[i].ts, (int)points[i].value);
+    printf("roundtrip %-12s %5d points, %3u blocks, %.2f bytes/point\n", name, num, series.used,
+           (double)tsdb_used_bytes(&series) / num);
+    free(out);
+    free(series.blocks);
+    return 0;
+}
+
+/** 编码分档边界：时间二阶差分和数值差值正好落在每一档的两端，以及 int32 极值
+ * @param 无
+ * @return 失败个数
+*/
+static int test_edges(void)
+{
+    static const int32_t dods[] = {0, 1, -1, -63, 64, -64, 65, -255, 256, -256, 257, -2047, 2048, -2048, 2049,
+                                   100000, -100000, 0, 0};
+    static const int32_t deltas[] = {0, -32, 31, 32, -33, -2048, 2047, 2048, -2049, 1, -1};
+    static const int32_t extremes[] = {INT32_MAX, INT32_MIN, INT32_MAX, 0, -1, INT32_MIN, 1, INT32_MIN + 1, INT32_MAX - 1};
+    enum { NUM = 600 };
+    tsdb_point_t points[NUM];
+    int64_t ts = TEST_TS0;
+    int32_t interval = 200000, value = 0;
+    for (int i = 0; i < NUM; i++)
+    {
+        //间隔逐步按 dods 变化，保持为正
+        interval += dods[i % (sizeof(dods) / sizeof(dods[0]))];
+        if (interval < 0)
+            interval = -interval;
+        ts += interval;
+        if (i % 50 < 10)
+            value = extremes[i % (sizeof(extremes) / sizeof(extremes[0]))];
+        else
+            value += deltas[i % (sizeof(deltas) / sizeof(deltas[0]))];
+        points[i].ts = ts;
+        points[i].value = value;
+    }
+    if (roundtrip("edges", points, NUM, 16))
+        return 1;
+
+    //相同时间戳、间隔为 0 的点
+    for (int i = 0; i < 8; i++)
+    {
+        points[i].ts = TEST_TS0 + (i / 3);
+        points[i].value = i;
+    }
+    return roundtrip("same_ts", points, 8, 1);
+}
+
+/** 超过 int32 的时间间隔开始新块，新块前后的点都能读回；早于上一个点的时间戳被拒绝
+ * @param 无
+ * @return 失败个数
+*/
+static int test_gaps(void)
+{
+    static const int64_t gaps[] = {1000, 1000, (int64_t)INT32_MAX, 1000, (int64_t)INT32_MAX + 1, 5, 1ll << 40, 1000, 1000, 3};
+    tsdb_point_t points[10];
+    tsdb_series_t series;
+    int64_t ts = -TEST_TS0;
+    for (int i = 0; i < 10; i++)
+    {
+        ts += gaps[i];
+        points[i].ts = ts;
+        points[i].value = -i * 1000;
+    }
+    if (roundtrip("gaps", points, 10, 4))
+        return 1;
+
+    CHECK(tsdb_series_init(&series, "order", 2) == ESP_OK, "init");
+    CHECK(tsdb_append(&series, 1000, 1) == ESP_OK, "append");
+    CHECK(tsdb_append(&series, 999, 2) == ESP_ERR_INVALID_ARG, "older point accepted");
+    CHECK(tsdb_append(&series, 1000, 3) == ESP_OK, "same timestamp rejected");
+    CHECK(tsdb_count(&series) == 2, "count %u", (unsigned)tsdb_count(&series));
+    free(series.blocks);
+    return 0;
+}
+
+/** 写入远多于容量的点：保留最近的整块数据，旧块被覆盖，evicted + 保留点数 = 写入点数
+ * @param 无
+ * @return 失败个数
+*/
+static int test_eviction(void)
+{
+    enum { NUM = 20000, BLOCKS = 4 };
+    static tsdb_point_t points[NUM], out[NUM];
+    tsdb_series_t series;
+    CHECK(tsdb_series_init(&series, "evict", BLOCKS) == ESP_OK, "init");
+    for (int i = 0; i < NUM; i++)
+    {
+        points[i].ts = TEST_TS0 + i * 1000 + rand_u32() % 50;
+        points[i].value = 250 + (int32_t)(rand_u32() % 200) - 100;
+        CHECK(tsdb_append(&series, points[i].ts, points[i].value) == ESP_OK, "append %d", i);
+        uint32_t kept = tsdb_count(&series);
+        CHECK(kept + series.evicted == (uint32_t)i + 1, "point %d: kept %u + evicted %u", i, (unsigned)kept, (unsigned)series.evicted);
+    }
+    CHECK(series.used == BLOCKS, "used %u", series.used);
+    int got = read_all(&series, out, NUM);
+    CHECK(got == (int)tsdb_count(&series) && got > 0, "read %d", got);
+    //读回的是最后 got 个点
+    for (int i = 0; i < got; i++)
+    {
+        const tsdb_point_t *p = &points[NUM - got + i];
+        CHECK(out[i].ts == p->ts && out[i].value == p->value, "point %d", i);
+    }
+    printf("eviction: %d points kept in %d blocks, %u evicted\n", got, BLOCKS, (unsigned)series.evicted);
+    free(series.blocks);
+    return 0;
+}
+
+typedef struct
+{
+    int num;
+    int stop;           //取到这么多点后停止
+}query_ctx_t;
+
+static bool query_cb(const tsdb_point_t *point, void *arg)
+{
+    query_ctx_t *ctx = arg;
+    return ++ctx->num < ctx->stop;
+}
+
+/** 随机范围查询(包括空范围、反向范围、范围两端正好是点、整段在数据之前/之后)，与暴力过滤结果比较
+ * @param 无
+ * @return 失败个数
+*/
+static int test_range(void)
+{
+    enum { NUM = 3000 };
+    static tsdb_point_t points[NUM], out[NUM];
+    tsdb_series_t series;
+    CHECK(tsdb_series_init(&series, "range", 128) == ESP_OK, "init");
+    int64_t ts = TEST_TS0;
+    for (int i = 0; i < NUM; i++)
+    {
+        ts += (i % 500 == 499) ? 3600000 : 1000 + rand_u32() % 3;
+        points[i].ts = ts;
+        points[i].value = (int32_t)(rand_u32() % 65536) - 32768;
+        CHECK(tsdb_append(&series, points[i].ts, points[i].value) == ESP_OK, "append %d", i);
+    }
+    CHECK(series.evicted == 0, "evicted");
+    int64_t first = points[0].ts, last = points[NUM - 1].ts;
+    for (int round = 0; round < 2000; round++)
+    {
+        int64_t from, to;
+        switch (round % 5)
+        {
+        case 0:     //两端正好是点
+            from = points[rand_u32() % NUM].ts;
+            to = points[rand_u32() % NUM].ts;
+            break;
+        case 1:     //整段之前或之后
+            from = (round & 8) ? last + 1 + rand_u32() % 1000 : first - 1000 - rand_u32() % 1000;
+            to = from + rand_u32() % 900;
+            break;
+        default:
+            from = first - 5000 + (int64_t)(rand_u32() % (uint32_t)(last - first + 10000));
+            to = from + (int64_t)(rand_u32() % 200000) - 1000;
+            break;
+        }
+        tsdb_iter_t it;
+        int got = 0, expect = 0;
+        tsdb_lock(&series);
+        tsdb_iter_init(&it, &series, from, to);
+        while (tsdb_iter_next(&it, &out[got]))
+            got++;
+        tsdb_unlock(&series);
+        for (int i = 0; i < NUM; i++)
+        {
+            if (points[i].ts < from || points[i].ts > to)
+                continue;
+            CHECK(expect < got && out[expect].ts == points[i].ts && out[expect].value == points[i].value,
+                  "range [%lld, %lld] point %d", (long long)from, (long long)to, expect);
+            expect++;
+        }
+        CHECK(got == expect, "range [%lld, %lld]: %d points, expect %d", (long long)from, (long long)to, got, expect);
+    }
+
+    //回调返回 false 时停止，返回值包含最后一个点
+    query_ctx_t ctx = {.num = 0, .stop = 10};
+    CHECK(tsdb_query(&series, first, last, query_cb, &ctx) == 10 && ctx.num == 10, "query stop");
+    ctx.stop = NUM + 1;
+    ctx.num = 0;
+    CHECK(tsdb_query(&series, first, last, query_cb, &ctx) == NUM, "query all");
+    printf("range: ok\n");
+    free(series.blocks);
+    return 0;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum
+{
+    BENCH_STEADY,       //1s 等间隔，温度X10 缓慢变化
+    BENCH_JITTER,       //1s 间隔带 ±20ms 抖动，数值小幅波动
+    BENCH_RANDOM,       //随机间隔、随机数值，最坏情况
+    BENCH_KIND_NUM,
+}bench_kind_t;
+
+static const char *s_bench_name[BENCH_KIND_NUM] = {"steady", "jitter", "random"};
+
+static void bench_point(bench_kind_t kind, int i, int64_t *ts, int32_t *value)
+{
+    switch (kind)
+    {
+    case BENCH_STEADY:
+        *ts += 1000;
+        if (i % 30 == 0)
+            *value += (int32_t)(rand_u32() % 3) - 1;
+        break;
+    case BENCH_JITTER:
+        *ts += 980 + rand_u32() % 41;
+        *value += (int32_t)(rand_u32() % 21) - 10;
+        break;
+    default:
+        *ts += rand_u32() % 100000;
+        *value = (int32_t)rand_u32();
+        break;
+    }
+}
+
+/** 每种数据写入 num 个点，统计写入和全量读出的速度、每个点占用的字节数(含块头)
+ * @param num 点数
+ * @param max_bpp steady 数据允许的最大字节数/点，0 不检查
+ * @return 失败个数
+*/
+static int bench(int num, double max_bpp)
+{
+    int fail = 0;
+    for (int kind = 0; kind < BENCH_KIND_NUM; kind++)
+    {
+        tsdb_series_t series;
+        tsdb_point_t point;
+        tsdb_iter_t it;
+        int64_t ts = TEST_TS0;
+        int32_t value = 250;
+        //块数足够放下全部点，统计的是压缩率而不是覆盖
+        uint16_t blocks = (uint16_t)(num / 16 + 1 > UINT16_MAX ? UINT16_MAX : num / 16 + 1);
+        CHECK(tsdb_series_init(&series, s_bench_name[kind], blocks) == ESP_OK, "init");
+        double start = now_s();
+        for (int i = 0; i < num; i++)
+        {
+            bench_point(kind, i, &ts, &value);
+            tsdb_append(&series, ts, value);
+        }
+        double append_s = now_s() - start;
+        int read = 0;
+        volatile int64_t sink = 0;
+        start = now_s();
+        tsdb_lock(&series);
+        tsdb_iter_init(&it, &series, INT64_MIN, INT64_MAX);
+        while (tsdb_iter_next(&it, &point))
+        {
+            sink += point.value;
+            read++;
+        }
+        tsdb_unlock(&series);
+        double read_s = now_s() - start;
+        double bpp = (double)tsdb_used_bytes(&series) / num;
+        printf("bench %-7s %d points: append %.2f Mpoints/s, scan %.2f Mpoints/s, %.3f bytes/point (raw 12), evicted %u\n",
+               s_bench_name[kind], num, num / append_s / 1e6, read / read_s / 1e6, bpp, (unsigned)series.evicted);
+        if (read + series.evicted != (uint32_t)num)
+        {
+            printf("bench %s: read %d points\n", s_bench_name[kind], read);
+            fail++;
+        }
+        if (kind == BENCH_STEADY && max_bpp > 0 && bpp > max_bpp)
+        {
+            printf("bench steady: %.3f bytes/point exceeds %.3f\n", bpp, max_bpp);
+            fail++;
+        }
+        free(series.blocks);
+    }
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0, bench_num = 0;
+    double max_bpp = 0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "--bench"))
+            bench_num = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--max-bpp"))
+            max_bpp = atof(argv[i + 1]);
+    }
+    fail += test_edges();
+    fail += test_gaps();
+    fail += test_eviction();
+    fail += test_range();
+    if (bench_num > 0)
+        fail += bench(bench_num, max_bpp);
+    if (fail)
+        printf("%d test(s) failed\n", fail);
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,343 @@
+/*
+ * ws.c 广播压测，在主机上运行
+ * N 个客户端通过 socketpair 连接，一半切换到二进制帧，可以指定若干个不读数据的慢客户端
+ * 生产者按固定频率改变数据并调用 web_monitor_notify，httpd任务上同时有模拟的页面请求
+ * 输出广播延迟 p50/p99、吞吐量、广播帧占用内存的峰值，超过阈值时返回非0
+ *
+ * 用法: ws_load [--clients N] [--slow N] [--rate HZ] [--seconds S] [--fetch-hz HZ]
+ *               [--max-p99-us US] [--min-fps N] [--max-heap BYTES]
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+//统计 ws.c 中的分配，得到广播帧占用内存的峰值
+#define HOST_ALLOC_HEAD     16
+static pthread_mutex_t s_heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t s_heap_used = 0;
+static size_t s_heap_high = 0;
+
+static void *host_malloc(size_t size)
+{
+    uint8_t *p = malloc(HOST_ALLOC_HEAD + size);
+    if (!p)
+        return NULL;
+    *(size_t *)p = size;
+    pthread_mutex_lock(&s_heap_mutex);
+    s_heap_used += size;
+    if (s_heap_used > s_heap_high)
+        s_heap_high = s_heap_used;
+    pthread_mutex_unlock(&s_heap_mutex);
+    return p + HOST_ALLOC_HEAD;
+}
+
+static void host_free(void *ptr)
+{
+    if (!ptr)
+        return;
+    uint8_t *p = (uint8_t *)ptr - HOST_ALLOC_HEAD;
+    pthread_mutex_lock(&s_heap_mutex);
+    s_heap_used -= *(size_t *)p;
+    pthread_mutex_unlock(&s_heap_mutex);
+    free(p);
+}
+
+//直接编译 ws.c，测试程序可以调用其中的 handle_ws_req 模拟连接和接收
+#define malloc host_malloc
+#define free host_free
+#include "ws.c"
+#undef malloc
+#undef free
+
+typedef struct
+{
+    int fd;
+    bool slow;
+    bool binary;
+    long frames;
+    long last_value;
+    int64_t *latency;       //文本帧的端到端延迟(us)
+    long latency_num;
+    long latency_cap;
+}load_client_t;
+
+typedef struct
+{
+    int clients;
+    int slow;
+    int rate;
+    int seconds;
+    int fetch_hz;
+    long max_p99_us;
+    long min_fps;           //0 表示按客户端个数和频率计算
+    long max_heap;
+}load_cfg_t;
+
+//生产者修改的数据，由 ws.c 在esp_timer线程中读取
+static pthread_mutex_t s_data_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long s_value = 0;
+static int64_t s_changed_us = 0;
+
+static void load_send_fn(char *send_buf, int *len)
+{
+    pthread_mutex_lock(&s_data_mutex);
+    *len = snprintf(send_buf, WS_FRAME_MAX, "{\"t\":%lld,\"v\":%ld,\"pad\":\"0123456789012345678901234567890123456789\"}",
+                    (long long)s_changed_us, s_value);
+    pthread_mutex_unlock(&s_data_mutex);
+}
+
+static int load_fields_fn(int32_t *values, int max)
+{
+    pthread_mutex_lock(&s_data_mutex);
+    values[0] = (int32_t)s_value;
+    values[1] = (int32_t)(s_value / 7);
+    values[2] = 1;
+    pthread_mutex_unlock(&s_data_mutex);
+    return 3;
+}
+
+static bool load_recv_all(int fd, uint8_t *buf, size_t len)
+{
+    return recv(fd, buf, len, MSG_WAITALL) == (ssize_t)len;
+}
+
+static void *load_client_task(void *arg)
+{
+    load_client_t *client = arg;
+    uint8_t buf[WS_FRAME_MAX + 1];
+    if (client->slow)
+    {
+        //慢客户端不读数据，等服务端发现后断开
+        pause();
+        return NULL;
+    }
+    while (1)
+    {
+        uint8_t head[3];
+        if (!load_recv_all(client->fd, head, sizeof(head)))
+            break;
+        int len = (head[1] << 8) | head[2];
+        if (len > WS_FRAME_MAX || !load_recv_all(client->fd, buf, len))
+            break;
+        int64_t now = esp_timer_get_time();
+        long long changed;
+        long value;
+        buf[len] = '\0';
+        if (head[0] == HTTPD_WS_TYPE_TEXT && sscanf((char *)buf, "{\"t\":%lld,\"v\":%ld", &changed, &value) == 2)
+        {
+            client->last_value = value;
+            if (changed && client->latency_num < client->latency_cap)
+                client->latency[client->latency_num++] = now - changed;
+        }
+        client->frames++;
+    }
+    return NULL;
+}
+
+//模拟在httpd任务中处理一次页面请求
+static void load_fetch_work(void *arg)
+{
+    usleep(2000);
+}
+
+static void load_connect(load_client_t *client)
+{
+    int sv[2];
+    int sndbuf = 4096;
+    struct timeval tv = {.tv_sec = WS_SEND_TIMEOUT_S};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        perror("socketpair");
+        exit(2);
+    }
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    client->fd = sv[1];
+
+    httpd_req_t req = {.method = HTTP_GET, .fd = sv[0]};
+    handle_ws_req(&req);
+    if (client->binary)
+    {
+        httpd_req_t bin = {.method = HTTP_POST, .fd = sv[0], .payload = (const uint8_t *)WS_PROTO_BIN, .payload_len = strlen(WS_PROTO_BIN)};
+        handle_ws_req(&bin);
+    }
+}
+
+static int load_cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void load_parse_args(int argc, char **argv, load_cfg_t *cfg)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        long v = atol(argv[i + 1]);
+        if (strcmp(argv[i], "--clients") == 0)
+            cfg->clients = v;
+        else if (strcmp(argv[i], "--slow") == 0)
+            cfg->slow = v;
+        else if (strcmp(argv[i], "--rate") == 0)
+            cfg->rate = v;
+        else if (strcmp(argv[i], "--seconds") == 0)
+            cfg->seconds = v;
+        else if (strcmp(argv[i], "--fetch-hz") == 0)
+            cfg->fetch_hz = v;
+        else if (strcmp(argv[i], "--max-p99-us") == 0)
+            cfg->max_p99_us = v;
+        else if (strcmp(argv[i], "--min-fps") == 0)
+            cfg->min_fps = v;
+        else if (strcmp(argv[i], "--max-heap") == 0)
+            cfg->max_heap = v;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            exit(2);
+        }
+    }
+    if (cfg->clients < 1 || cfg->clients > WS_MAX_CLIENT || cfg->slow > cfg->clients || cfg->rate < 1 || cfg->seconds < 1)
+    {
+        fprintf(stderr, "bad options, clients 1..%d\n", WS_MAX_CLIENT);
+        exit(2);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    load_cfg_t cfg = {
+        .clients = WS_MAX_CLIENT,
+        .slow = 0,
+        .rate = 100,
+        .seconds = 3,
+        .fetch_hz = 20,
+        .max_p99_us = 20000,
+        .min_fps = 0,
+        .max_heap = 4096,
+    };
+    load_parse_args(argc, argv, &cfg);
+    int fast = cfg.clients - cfg.slow;
+    if (cfg.min_fps == 0)
+        cfg.min_fps = (long)fast * cfg.rate * 8 / 10;
+
+    ws_cfg_t ws_cfg = {
+        .html_code = NULL,
+        .send_fn = load_send_fn,
+        .fields_fn = load_fields_fn,
+        .intervel_ms = 1000,
+        .coalesce_ms = 1,
+    };
+    web_monitor_init(&ws_cfg);
+
+    load_client_t *clients = calloc(cfg.clients, sizeof(load_client_t));
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        load_client_t *client = &clients[i];
+        pthread_t thread;
+        client->slow = i < cfg.slow;
+        client->binary = !client->slow && (i % 2);
+        client->latency_cap = (long)cfg.rate * cfg.seconds + 64;
+        client->latency = calloc(client->latency_cap, sizeof(int64_t));
+        load_connect(client);
+        pthread_create(&thread, NULL, load_client_task, client);
+        pthread_detach(thread);
+    }
+    //连接时的首帧不计入
+    usleep(100000);
+    web_monitor_reset_stats();
+
+    int64_t start = esp_timer_get_time();
+    int64_t next_notify = start, next_fetch = start;
+    long notifies = 0;
+    while (esp_timer_get_time() - start < cfg.seconds * 1000000ll)
+    {
+        int64_t now = esp_timer_get_time();
+        if (now >= next_notify)
+        {
+            pthread_mutex_lock(&s_data_mutex);
+            s_value++;
+            s_changed_us = now;
+            pthread_mutex_unlock(&s_data_mutex);
+            web_monitor_notify();
+            notifies++;
+            next_notify += 1000000 / cfg.rate;
+        }
+        if (cfg.fetch_hz && now >= next_fetch)
+        {
+            httpd_queue_work(server, load_fetch_work, NULL);
+            next_fetch += 1000000 / cfg.fetch_hz;
+        }
+        usleep(50);
+    }
+    //等待队列中的帧发送完
+    usleep(300000);
+
+    ws_stats_t st;
+    web_monitor_get_stats(&st);
+    long latency_num = 0, frames = 0;
+    for (int i = 0; i < cfg.clients; i++)
+        latency_num += clients[i].latency_num;
+    int64_t *latency = calloc(latency_num + 1, sizeof(int64_t));
+    latency_num = 0;
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        frames += clients[i].frames;
+        memcpy(&latency[latency_num], clients[i].latency, clients[i].latency_num * sizeof(int64_t));
+        latency_num += clients[i].latency_num;
+    }
+    qsort(latency, latency_num, sizeof(int64_t), load_cmp_i64);
+    int64_t p50 = latency_num ? latency[latency_num / 2] : 0;
+    int64_t p99 = latency_num ? latency[latency_num * 99 / 100] : 0;
+    double fps = st.sent / (double)cfg.seconds;
+    pthread_mutex_lock(&s_heap_mutex);
+    size_t heap_high = s_heap_high;
+    pthread_mutex_unlock(&s_heap_mutex);
+
+    printf("clients %d (slow %d), %d Hz for %d s: notify %ld, frames %lu, sent %lu (%.0f frames/s, %.1f KB/s), received %ld\n",
+           cfg.clients, cfg.slow, cfg.rate, cfg.seconds, notifies, (unsigned long)st.frames, (unsigned long)st.sent,
+           fps, st.sent_bytes / 1024.0 / cfg.seconds, frames);
+    printf("fan-out latency p50 %lld us, p99 %lld us, max %lld us (server p50 <= %lu us, p99 <= %lu us)\n",
+           (long long)p50, (long long)p99, latency_num ? (long long)latency[latency_num - 1] : 0,
+           (unsigned long)web_monitor_latency_percentile(&st, 50), (unsigned long)web_monitor_latency_percentile(&st, 99));
+    printf("heap high-water %zu bytes (frames alive max %lu, %lu bytes), slow_drop %lu, tx_busy %lu, send_fail %lu\n",
+           heap_high, (unsigned long)st.frames_alive_max, (unsigned long)st.frames_bytes_max,
+           (unsigned long)st.slow_drop, (unsigned long)st.tx_busy, (unsigned long)st.send_fail);
+
+    int fail = 0;
+    if (p99 > cfg.max_p99_us)
+    {
+        printf("FAIL: p99 %lld us > %ld us\n", (long long)p99, cfg.max_p99_us);
+        fail = 1;
+    }
+    if (fps < cfg.min_fps)
+    {
+        printf("FAIL: %.0f frames/s < %ld\n", fps, cfg.min_fps);
+        fail = 1;
+    }
+    if ((long)heap_high > cfg.max_heap)
+    {
+        printf("FAIL: heap high-water %zu > %ld bytes\n", heap_high, cfg.max_heap);
+        fail = 1;
+    }
+    if (st.slow_drop < (uint32_t)cfg.slow || st.send_fail)
+    {
+        printf("FAIL: slow_drop %lu (expect %d), send_fail %lu\n", (unsigned long)st.slow_drop, cfg.slow, (unsigned long)st.send_fail);
+        fail = 1;
+    }
+    //快客户端最后都应该收到最新的数据，没有帧卡在队列里
+    for (int i = 0; i < cfg.clients; i++)
+    {
+        load_client_t *client = &clients[i];
+        if (!client->slow && !client->binary && client->last_value != s_value)
+        {
+            printf("FAIL: client %d last value %ld, expect %ld\n", i, client->last_value, s_value);
+            fail = 1;
+        }
+    }
+    printf("%s\n", fail ? "FAILED" : "PASSED");
+    return fail;
+}
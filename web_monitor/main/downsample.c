@@ -0,0 +1,150 @@
+#include "downsample.h"
+
+//带一个预读点的迭代器
+typedef struct
+{
+    tsdb_iter_t it;
+    bool has_peek;
+    tsdb_point_t peek;
+}ds_cursor_t;
+
+//桶的划分：(t0, to] 等分成 bucket_num 份
+typedef struct
+{
+    int64_t t0;
+    int64_t span;
+    int bucket_num;
+}ds_grid_t;
+
+static bool ds_peek(ds_cursor_t *cur, tsdb_point_t *point)
+{
+    if (!cur->has_peek)
+    {
+        if (!tsdb_iter_next(&cur->it, &cur->peek))
+            return false;
+        cur->has_peek = true;
+    }
+    *point = cur->peek;
+    return true;
+}
+
+static inline void ds_pop(ds_cursor_t *cur)
+{
+    cur->has_peek = false;
+}
+
+static inline int ds_bucket(const ds_grid_t *grid, int64_t ts)
+{
+    int64_t idx = (ts - grid->t0 - 1) * grid->bucket_num / grid->span;
+    return idx < grid->bucket_num ? (int)idx : grid->bucket_num - 1;
+}
+
+/** 读完下一个非空桶，计算平均点
+ * @param cur 领先的迭代器
+ * @param grid 桶的划分
+ * @param idx 输出，桶序号
+ * @param avg_ts 输出，平均时间(相对t0)
+ * @param avg_value 输出，平均值
+ * @param last 输出，桶中最后一个点
+ * @return true 读到，false 没有更多的点
+*/
+static bool ds_next_bucket(ds_cursor_t *cur, const ds_grid_t *grid, int *idx, float *avg_ts, float *avg_value, tsdb_point_t *last)
+{
+    tsdb_point_t point;
+    if (!ds_peek(cur, &point))
+        return false;
+    int64_t sum_ts = 0, sum_value = 0;
+    int num = 0;
+    *idx = ds_bucket(grid, point.ts);
+    while (ds_peek(cur, &point) && ds_bucket(grid, point.ts) == *idx)
+    {
+        sum_ts += point.ts - grid->t0;
+        sum_value += point.value;
+        num++;
+        *last = point;
+        ds_pop(cur);
+    }
+    *avg_ts = (float)sum_ts / num;
+    *avg_value = (float)sum_value / num;
+    return true;
+}
+
+/** LTTB(Largest-Triangle-Three-Buckets)降采样，最多输出 max_num 个点
+ * 时间范围内第一个点和最后一个点总是保留，中间按时间等分成 max_num-2 个桶，
+ * 每个桶选出与前一个选中点、后一个桶平均点组成三角形面积最大的点
+ * 直接在压缩数据上用两个迭代器流式计算，不需要把整个序列解压出来
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param out 输出
+ * @param max_num 最多输出的点数，不小于3
+ * @return 实际输出的点数
+*/
+int downsample_lttb(tsdb_series_t *series, int64_t from, int64_t to, tsdb_point_t *out, int max_num)
+{
+    ds_cursor_t lead = {0}, lag = {0};
+    ds_grid_t grid;
+    tsdb_point_t first, last, point;
+    int num = 0;
+    if (max_num < 3 || to < from)
+        return 0;
+
+    tsdb_lock(series);
+    //lead 先读完下一个桶求平均点，lag 跟在后面从当前桶中选点
+    tsdb_iter_init(&lead.it, series, from, to);
+    tsdb_iter_init(&lag.it, series, from, to);
+    if (!ds_peek(&lead, &first))
+        goto out;
+    ds_pop(&lead);
+    ds_peek(&lag, &point);
+    ds_pop(&lag);
+    out[num++] = first;
+    last = first;
+
+    grid.t0 = first.ts;
+    grid.span = to - first.ts;
+    grid.bucket_num = max_num - 2;
+    if (grid.span <= 0)
+        goto out;
+
+    int cur_idx, next_idx;
+    float c_ts, c_value;
+    tsdb_point_t a = first;
+    bool has_cur = ds_next_bucket(&lead, &grid, &cur_idx, &c_ts, &c_value, &last);
+    while (has_cur)
+    {
+        bool has_next = ds_next_bucket(&lead, &grid, &next_idx, &c_ts, &c_value, &last);
+        if (!has_next)
+        {
+            //最后一个桶，第三个点取整个范围的最后一个点
+            c_ts = last.ts - grid.t0;
+            c_value = last.value;
+        }
+        float a_ts = a.ts - grid.t0;
+        float best = -1.0f;
+        tsdb_point_t selected = a;
+        while (ds_peek(&lag, &point) && ds_bucket(&grid, point.ts) == cur_idx)
+        {
+            float p_ts = point.ts - grid.t0;
+            //三角形面积的两倍
+            float area = (a_ts - c_ts) * ((float)point.value - a.value) - (a_ts - p_ts) * (c_value - a.value);
+            if (area < 0)
+                area = -area;
+            if (area > best)
+            {
+                best = area;
+                selected = point;
+            }
+            ds_pop(&lag);
+        }
+        out[num++] = selected;
+        a = selected;
+        cur_idx = next_idx;
+        has_cur = has_next;
+    }
+    if (last.ts != out[num - 1].ts)
+        out[num++] = last;
+out:
+    tsdb_unlock(series);
+    return num;
+}
@@ -0,0 +1,18 @@
+#ifndef _DOWNSAMPLE_H_
+#define _DOWNSAMPLE_H_
+#include "tsdb.h"
+
+/** LTTB(Largest-Triangle-Three-Buckets)降采样，最多输出 max_num 个点
+ * 时间范围内第一个点和最后一个点总是保留，中间按时间等分成 max_num-2 个桶，
+ * 每个桶选出与前一个选中点、后一个桶平均点组成三角形面积最大的点
+ * 直接在压缩数据上用两个迭代器流式计算，不需要把整个序列解压出来
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param out 输出
+ * @param max_num 最多输出的点数，不小于3
+ * @return 实际输出的点数
+*/
+int downsample_lttb(tsdb_series_t *series, int64_t from, int64_t to, tsdb_point_t *out, int max_num);
+
+#endif
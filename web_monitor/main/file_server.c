@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "file_server.h"
+#include "ws.h"
+
+static const char *TAG = "file_server";
+
+//每次读取发送的块大小
+#define FILE_CHUNK_SIZE     1024
+//文件路径最大长度
+#define FILE_PATH_MAX       64
+//缓存ETag的文件个数
+#define FILE_ETAG_NUM       8
+
+//文件的ETag缓存，大小变化时重新计算
+typedef struct
+{
+    char path[FILE_PATH_MAX];
+    long size;
+    uint32_t hash;
+}file_etag_t;
+
+static const char *s_base_path = NULL;
+static const char *s_index = NULL;
+static file_etag_t s_etag[FILE_ETAG_NUM];
+static int s_etag_next = 0;
+//读文件的缓存，处理函数都在httpd任务中执行，共用一块
+static char s_chunk[FILE_CHUNK_SIZE];
+
+/** 根据扩展名获取Content-Type
+ * @param path 路径
+ * @return Content-Type
+*/
+static const char *file_content_type(const char *path)
+{
+    static const struct
+    {
+        const char *ext;
+        const char *type;
+    }types[] =
+    {
+        {".html", "text/html"},
+        {".js", "application/javascript"},
+        {".css", "text/css"},
+        {".json", "application/json"},
+        {".png", "image/png"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"},
+    };
+    const char *ext = strrchr(path, '.');
+    if(ext)
+    {
+        for(int i = 0;i < sizeof(types) / sizeof(types[0]);i++)
+        {
+            if(strcmp(ext, types[i].ext) == 0)
+                return types[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+/** 获取文件内容的哈希(FNV-1a)，结果缓存
+ * @param path 路径
+ * @param size 文件大小
+ * @param hash 输出
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t file_get_etag(const char *path, long size, uint32_t *hash)
+{
+    for(int i = 0;i < FILE_ETAG_NUM;i++)
+    {
+        if(s_etag[i].size == size && strcmp(s_etag[i].path, path) == 0)
+        {
+            *hash = s_etag[i].hash;
+            return ESP_OK;
+        }
+    }
+    FILE *fp = fopen(path, "r");
+    if(!fp)
+        return ESP_FAIL;
+    uint32_t h = 2166136261u;
+    size_t len;
+    while((len = fread(s_chunk, 1, sizeof(s_chunk), fp)) > 0)
+    {
+        for(size_t i = 0;i < len;i++)
+            h = (h ^ (uint8_t)s_chunk[i]) * 16777619u;
+    }
+    fclose(fp);
+    file_etag_t *etag = &s_etag[s_etag_next];
+    s_etag_next = (s_etag_next + 1) % FILE_ETAG_NUM;
+    snprintf(etag->path, sizeof(etag->path), "%s", path);
+    etag->size = size;
+    etag->hash = h;
+    *hash = h;
+    return ESP_OK;
+}
+
+/** 请求头中是否包含某个值
+ * @param req http请求
+ * @param field 头名称
+ * @param value 值
+ * @return true 包含
+*/
+static bool file_header_contains(httpd_req_t *req, const char *field, const char *value)
+{
+    char buf[64];
+    size_t len = httpd_req_get_hdr_value_len(req, field);
+    if(len == 0 || len >= sizeof(buf))
+        return false;
+    if(httpd_req_get_hdr_value_str(req, field, buf, sizeof(buf)) != ESP_OK)
+        return false;
+    return strstr(buf, value) != NULL;
+}
+
+/** HTTP GET 静态文件
+ * @param req http请求
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t file_get_handler(httpd_req_t *req)
+{
+    char path[FILE_PATH_MAX];
+    char etag[16];
+    struct stat st;
+    const char *uri = req->uri;
+    size_t uri_len = strcspn(uri, "?#");
+    if(uri_len == 1 && uri[0] == '/')
+    {
+        uri = s_index;
+        uri_len = strlen(s_index);
+    }
+    //留出 ".gz" 的位置，拒绝访问挂载点之外的文件
+    if(strlen(s_base_path) + uri_len + 4 > sizeof(path))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+        return ESP_FAIL;
+    }
+    int path_len = snprintf(path, sizeof(path), "%s%.*s", s_base_path, (int)uri_len, uri);
+    if(strstr(path, ".."))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+        return ESP_FAIL;
+    }
+    const char *type = file_content_type(path);
+
+    //优先发送压缩的文件
+    bool gzip = false;
+    if(file_header_contains(req, "Accept-Encoding", "gzip"))
+    {
+        strcpy(path + path_len, ".gz");
+        gzip = stat(path, &st) == 0;
+        path[path_len] = '\0';
+    }
+    if(gzip)
+        strcpy(path + path_len, ".gz");
+    else if(stat(path, &st) != 0)
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+        return ESP_FAIL;
+    }
+
+    uint32_t hash;
+    if(file_get_etag(path, st.st_size, &hash) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+        return ESP_FAIL;
+    }
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)hash);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", strcmp(type, "text/html") == 0 ? "no-cache" : "max-age=86400");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if(file_header_contains(req, "If-None-Match", etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    FILE *fp = fopen(path, "r");
+    if(!fp)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, type);
+    if(gzip)
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    esp_err_t ret = ESP_OK;
+    size_t len;
+    while((len = fread(s_chunk, 1, sizeof(s_chunk), fp)) > 0)
+    {
+        ret = httpd_resp_send_chunk(req, s_chunk, len);
+        if(ret != ESP_OK)
+        {
+            ESP_LOGW(TAG, "send %s failed", path);
+            break;
+        }
+    }
+    fclose(fp);
+    if(ret == ESP_OK)
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    return ret;
+}
+
+/** 注册静态文件服务
+ * @param base_path 文件系统挂载点，例如 "/spiffs"
+ * @param index 访问 "/" 时返回的文件，例如 "/esp.html"
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t file_server_register(const char *base_path, const char *index)
+{
+    static const httpd_uri_t uri_file = {
+        .uri = "/*",
+        .method = HTTP_GET,
+        .handler = file_get_handler,
+        .user_ctx = NULL};
+    if(base_path == NULL || index == NULL)
+        return ESP_FAIL;
+    s_base_path = base_path;
+    s_index = index;
+    return web_monitor_register_uri(&uri_file);
+}
@@ -0,0 +1,20 @@
+#ifndef _FILE_SERVER_H_
+#define _FILE_SERVER_H_
+#include "esp_err.h"
+
+/*
+ * 静态文件服务：从已挂载的文件系统(spiffs)按块读取文件发送，不需要把整个文件放在内存中
+ *  客户端支持gzip并且存在编译时生成的 xxx.gz 时发送压缩的文件
+ *  ETag 为文件内容的哈希，第一次访问时计算并缓存，If-None-Match 相同时返回304
+ *  html 每次都需要验证(no-cache)，其他资源缓存一天
+ * 使用通配符匹配，需要在其他接口注册之后最后注册
+ */
+
+/** 注册静态文件服务
+ * @param base_path 文件系统挂载点，例如 "/spiffs"
+ * @param index 访问 "/" 时返回的文件，例如 "/esp.html"
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t file_server_register(const char *base_path, const char *index);
+
+#endif
@@ -0,0 +1,519 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "history.h"
+#include "downsample.h"
+#include "ws.h"
+
+static const char *TAG = "history";
+
+//每分钟一个点，12个块可以保存24小时以上
+#define HISTORY_PERIOD_MS   60000
+#define HISTORY_BLOCK_NUM   12
+
+#define HISTORY_DEFAULT_SPAN_S  3600
+#define HISTORY_DEFAULT_POINTS  200
+
+//响应分块发送的缓存大小
+#define HISTORY_CHUNK_SIZE  512
+//导出时每次加锁读取的点数和导出任务的栈大小
+#define HISTORY_EXPORT_BATCH    64
+#define HISTORY_EXPORT_STACK    4096
+
+static tsdb_series_t s_hist_temp;
+static tsdb_series_t s_hist_humidity;
+
+//聚合：最近1小时的分钟桶、2天的小时桶、30天的天桶
+static const rollup_level_cfg_t s_rollup_cfg[] =
+{
+    {.width_ms = 60 * 1000, .len = 60},
+    {.width_ms = 60 * 60 * 1000, .len = 48},
+    {.width_ms = 24 * 60 * 60 * 1000, .len = 30},
+};
+static rollup_series_t s_rollup_temp;
+static rollup_series_t s_rollup_humidity;
+
+//上次记录历史的时间
+static int64_t s_last_hist_ms = -HISTORY_PERIOD_MS;
+
+/** 初始化历史记录
+ * @param 无
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t history_init(void)
+{
+    esp_err_t ret = tsdb_series_init(&s_hist_temp,"temp",HISTORY_BLOCK_NUM);
+    if(ret == ESP_OK)
+        ret = tsdb_series_init(&s_hist_humidity,"humidity",HISTORY_BLOCK_NUM);
+    if(ret == ESP_OK)
+        ret = rollup_init(&s_rollup_temp,"temp",s_rollup_cfg,sizeof(s_rollup_cfg)/sizeof(s_rollup_cfg[0]));
+    if(ret == ESP_OK)
+        ret = rollup_init(&s_rollup_humidity,"humidity",s_rollup_cfg,sizeof(s_rollup_cfg)/sizeof(s_rollup_cfg[0]));
+    return ret;
+}
+
+/** 记录一次温湿度采样
+ * @param ts 时间戳(ms)
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @return 无
+*/
+void history_record(int64_t ts, int32_t temp_x10, int32_t humidity)
+{
+    //每个采样值都计入聚合
+    rollup_add(&s_rollup_temp,ts,temp_x10);
+    rollup_add(&s_rollup_humidity,ts,humidity);
+
+    //每分钟记录一次历史
+    if(ts - s_last_hist_ms >= HISTORY_PERIOD_MS)
+    {
+        s_last_hist_ms = ts;
+        tsdb_append(&s_hist_temp,ts,temp_x10);
+        tsdb_append(&s_hist_humidity,ts,humidity);
+    }
+}
+
+/** 按名称查找历史序列
+ * @param name 名称
+ * @return 序列，找不到返回NULL
+*/
+tsdb_series_t *history_find(const char *name)
+{
+    if(strcmp(name,s_hist_temp.name) == 0)
+        return &s_hist_temp;
+    if(strcmp(name,s_hist_humidity.name) == 0)
+        return &s_hist_humidity;
+    return NULL;
+}
+
+/** 按名称查找聚合序列
+ * @param name 名称
+ * @return 序列，找不到返回NULL
+*/
+rollup_series_t *history_rollup_find(const char *name)
+{
+    if(strcmp(name,s_rollup_temp.name) == 0)
+        return &s_rollup_temp;
+    if(strcmp(name,s_rollup_humidity.name) == 0)
+        return &s_rollup_humidity;
+    return NULL;
+}
+
+/** 读取一个整数查询参数
+ * @param query 查询字符串
+ * @param key 参数名
+ * @param value 输出
+ * @return true 存在且是整数
+*/
+static bool history_query_int(const char *query, const char *key, int64_t *value)
+{
+    char buf[24];
+    char *end;
+    if(httpd_query_key_value(query,key,buf,sizeof(buf)) != ESP_OK)
+        return false;
+    long long v = strtoll(buf,&end,10);
+    if(end == buf || *end)
+        return false;
+    *value = v;
+    return true;
+}
+
+/** HTTP GET /history 查询历史，降采样后分块返回JSON
+ * @param req http请求
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t history_get_handler(httpd_req_t *req)
+{
+    char query[128] = {0};
+    char name[16] = {0};
+    int64_t now = esp_timer_get_time() / 1000;
+    int64_t from, to = now, span = HISTORY_DEFAULT_SPAN_S, n = HISTORY_DEFAULT_POINTS;
+
+    if(httpd_req_get_url_query_str(req,query,sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query,"series",name,sizeof(name)) != ESP_OK)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"series required");
+        return ESP_FAIL;
+    }
+    tsdb_series_t *series = history_find(name);
+    if(!series)
+    {
+        httpd_resp_send_err(req,HTTPD_404_NOT_FOUND,"unknown series");
+        return ESP_FAIL;
+    }
+    history_query_int(query,"n",&n);
+    if(n < 3)
+        n = 3;
+    if(n > HISTORY_MAX_POINTS)
+        n = HISTORY_MAX_POINTS;
+    //from/to 优先，否则取最近 span 秒
+    history_query_int(query,"to",&to);
+    if(!history_query_int(query,"from",&from))
+    {
+        history_query_int(query,"span",&span);
+        from = to - span * 1000;
+    }
+    if(from > to)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"bad range");
+        return ESP_FAIL;
+    }
+
+    tsdb_point_t *points = malloc(n * sizeof(tsdb_point_t));
+    if(!points)
+    {
+        httpd_resp_send_err(req,HTTPD_500_INTERNAL_SERVER_ERROR,"no memory");
+        return ESP_ERR_NO_MEM;
+    }
+    int num = downsample_lttb(series,from,to,points,n);
+    ESP_LOGD(TAG,"%s [%lld,%lld] %d points",name,from,to,num);
+
+    //拼到缓存里，满了就发送一块，不在内存中生成整个响应
+    char chunk[HISTORY_CHUNK_SIZE];
+    int len = snprintf(chunk,sizeof(chunk),"{\"series\":\"%s\",\"now\":%lld,\"points\":[",series->name,now);
+    esp_err_t ret = ESP_OK;
+    httpd_resp_set_type(req,"application/json");
+    for(int i = 0;i < num && ret == ESP_OK;i++)
+    {
+        if(len > HISTORY_CHUNK_SIZE - 40)
+        {
+            ret = httpd_resp_send_chunk(req,chunk,len);
+            len = 0;
+        }
+        len += snprintf(chunk + len,sizeof(chunk) - len,"%s[%lld,%ld]",i ? "," : "",points[i].ts,points[i].value);
+    }
+    free(points);
+    if(ret == ESP_OK)
+    {
+        len += snprintf(chunk + len,sizeof(chunk) - len,"]}");
+        ret = httpd_resp_send_chunk(req,chunk,len);
+    }
+    if(ret == ESP_OK)
+        ret = httpd_resp_send_chunk(req,NULL,0);
+    return ret;
+}
+
+/** HTTP GET /rollup 查询一级聚合，返回时间范围内的桶和整个范围的合计
+ * @param req http请求
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t history_rollup_handler(httpd_req_t *req)
+{
+    char query[128] = {0};
+    char name[16] = {0};
+    int64_t now = esp_timer_get_time() / 1000;
+    int64_t level = 0, from = INT64_MIN, to = INT64_MAX;
+    rollup_bucket_t window;
+
+    if(httpd_req_get_url_query_str(req,query,sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query,"series",name,sizeof(name)) != ESP_OK)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"series required");
+        return ESP_FAIL;
+    }
+    rollup_series_t *series = history_rollup_find(name);
+    if(!series)
+    {
+        httpd_resp_send_err(req,HTTPD_404_NOT_FOUND,"unknown series");
+        return ESP_FAIL;
+    }
+    history_query_int(query,"level",&level);
+    history_query_int(query,"from",&from);
+    history_query_int(query,"to",&to);
+    if(level < 0 || level >= series->level_num)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"bad level");
+        return ESP_FAIL;
+    }
+    if(from > to)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"bad range");
+        return ESP_FAIL;
+    }
+
+    //桶个数有上限，一次取出再按时间过滤
+    int len = series->level[level].len;
+    rollup_bucket_t *buckets = malloc(len * sizeof(rollup_bucket_t));
+    if(!buckets)
+    {
+        httpd_resp_send_err(req,HTTPD_500_INTERNAL_SERVER_ERROR,"no memory");
+        return ESP_ERR_NO_MEM;
+    }
+    int num = rollup_buckets(series,level,buckets,len);
+    rollup_window(series,level,from,to,&window);
+
+    char chunk[HISTORY_CHUNK_SIZE];
+    int pos = snprintf(chunk,sizeof(chunk),"{\"series\":\"%s\",\"level\":%d,\"width\":%lu,\"now\":%lld,"
+        "\"window\":{\"start\":%lld,\"count\":%lu,\"min\":%ld,\"max\":%ld,\"mean\":%ld},\"buckets\":[",
+        series->name,(int)level,series->level[level].width_ms,now,
+        window.start,window.count,window.min,window.max,rollup_mean(&window));
+    esp_err_t ret = ESP_OK;
+    bool first = true;
+    httpd_resp_set_type(req,"application/json");
+    for(int i = 0;i < num && ret == ESP_OK;i++)
+    {
+        if(buckets[i].start < from || buckets[i].start >= to)
+            continue;
+        if(pos > HISTORY_CHUNK_SIZE - 80)
+        {
+            ret = httpd_resp_send_chunk(req,chunk,pos);
+            pos = 0;
+        }
+        pos += snprintf(chunk + pos,sizeof(chunk) - pos,"%s[%lld,%lu,%ld,%ld,%ld]",first ? "" : ",",
+            buckets[i].start,buckets[i].count,buckets[i].min,buckets[i].max,rollup_mean(&buckets[i]));
+        first = false;
+    }
+    free(buckets);
+    if(ret == ESP_OK)
+    {
+        pos += snprintf(chunk + pos,sizeof(chunk) - pos,"]}");
+        ret = httpd_resp_send_chunk(req,chunk,pos);
+    }
+    if(ret == ESP_OK)
+        ret = httpd_resp_send_chunk(req,NULL,0);
+    return ret;
+}
+
+//导出任务的参数
+typedef struct
+{
+    httpd_req_t *req;       //异步请求
+    tsdb_series_t *series;
+    int64_t from;
+    int64_t to;
+    bool binary;
+    char disposition[48];   //响应头，请求完成前需要有效
+}history_export_t;
+
+//同时只允许一个导出
+static atomic_bool s_export_busy = false;
+
+/** 写入zig-zag变长整数
+ * @param buf 输出
+ * @param v 数值
+ * @return 写入的字节数
+*/
+static int history_put_varint(uint8_t *buf, int64_t v)
+{
+    uint64_t zz = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    int len = 0;
+    while(zz >= 0x80)
+    {
+        buf[len++] = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    buf[len++] = (uint8_t)zz;
+    return len;
+}
+
+/** 分段读取点，每段只短时间持有序列的锁，不阻塞采样写入
+ * @param exp 导出参数
+ * @param cursor 下一段的开始时间，读完后更新
+ * @param skip 开始时间上需要跳过的点数(时间相同的点)，读完后更新
+ * @param points 输出
+ * @param max_num 最多点数
+ * @return 点数，0表示已经读完
+*/
+static int history_export_read(history_export_t *exp, int64_t *cursor, int *skip, tsdb_point_t *points, int max_num)
+{
+    tsdb_iter_t it;
+    tsdb_point_t point;
+    int num = 0;
+    int skipped = *skip;
+    tsdb_lock(exp->series);
+    tsdb_iter_init(&it, exp->series, *cursor, exp->to);
+    while(num < max_num && tsdb_iter_next(&it, &point))
+    {
+        if(point.ts == *cursor && *skip > 0)
+        {
+            (*skip)--;
+            continue;
+        }
+        points[num++] = point;
+    }
+    tsdb_unlock(exp->series);
+    if(num == 0)
+        return 0;
+    //下一段从最后一个点的时间开始，跳过已经读过的同一时间的点
+    int64_t last = points[num - 1].ts;
+    int same = 0;
+    for(int i = num - 1;i >= 0 && points[i].ts == last;i--)
+        same++;
+    *skip = last == *cursor ? skipped + same : same;
+    *cursor = last;
+    return num;
+}
+
+/** 导出任务，在httpd任务之外编码和发送，不阻塞WebSocket广播
+ * @param arg history_export_t
+ * @return 无
+*/
+static void history_export_task(void *arg)
+{
+    history_export_t *exp = arg;
+    httpd_req_t *req = exp->req;
+    tsdb_point_t points[HISTORY_EXPORT_BATCH];
+    uint8_t chunk[HISTORY_CHUNK_SIZE];
+    int64_t cursor = exp->from;
+    int64_t prev_ts = 0;
+    int32_t prev_value = 0;
+    int skip = 0, num, len = 0;
+    uint32_t total = 0;
+    esp_err_t ret = ESP_OK;
+
+    //文件头
+    int64_t now = esp_timer_get_time() / 1000;
+    if(exp->binary)
+    {
+        memcpy(chunk, HISTORY_EXPORT_MAGIC, 2);
+        chunk[2] = HISTORY_EXPORT_VERSION;
+        chunk[3] = 0;
+        for(int i = 0;i < 8;i++)
+            chunk[4 + i] = (uint8_t)(now >> (8 * i));
+        len = 12;
+    }
+    else
+        len = snprintf((char*)chunk, sizeof(chunk), "# series=%s now_ms=%lld\ntime_ms,%s\n", exp->series->name, now, exp->series->name);
+
+    while(ret == ESP_OK && (num = history_export_read(exp, &cursor, &skip, points, HISTORY_EXPORT_BATCH)) > 0)
+    {
+        for(int i = 0;i < num && ret == ESP_OK;i++)
+        {
+            //缓存放不下一个点时先发送
+            if(len > HISTORY_CHUNK_SIZE - 32)
+            {
+                ret = httpd_resp_send_chunk(req, (const char*)chunk, len);
+                len = 0;
+            }
+            if(exp->binary)
+            {
+                len += history_put_varint(&chunk[len], points[i].ts - prev_ts);
+                len += history_put_varint(&chunk[len], (int64_t)points[i].value - prev_value);
+                prev_ts = points[i].ts;
+                prev_value = points[i].value;
+            }
+            else
+                len += snprintf((char*)&chunk[len], sizeof(chunk) - len, "%lld,%ld\n", points[i].ts, points[i].value);
+        }
+        total += num;
+    }
+    if(ret == ESP_OK && len)
+        ret = httpd_resp_send_chunk(req, (const char*)chunk, len);
+    if(ret == ESP_OK)
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    ESP_LOGI(TAG, "export %s: %lu points, %s", exp->series->name, total, esp_err_to_name(ret));
+
+    httpd_req_async_handler_complete(req);
+    free(exp);
+    atomic_store(&s_export_busy, false);
+    vTaskDelete(NULL);
+}
+
+/** HTTP GET /export 导出原始历史，分块传输，占用的内存与数据量无关
+ * @param req http请求
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t history_export_handler(httpd_req_t *req)
+{
+    char query[128] = {0};
+    char name[16] = {0};
+    char format[8] = "csv";
+    int64_t from = INT64_MIN, to = INT64_MAX;
+
+    if(httpd_req_get_url_query_str(req,query,sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query,"series",name,sizeof(name)) != ESP_OK)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"series required");
+        return ESP_FAIL;
+    }
+    tsdb_series_t *series = history_find(name);
+    if(!series)
+    {
+        httpd_resp_send_err(req,HTTPD_404_NOT_FOUND,"unknown series");
+        return ESP_FAIL;
+    }
+    httpd_query_key_value(query,"format",format,sizeof(format));
+    bool binary = strcmp(format,"bin") == 0;
+    if(!binary && strcmp(format,"csv") != 0)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"format: csv or bin");
+        return ESP_FAIL;
+    }
+    history_query_int(query,"from",&from);
+    history_query_int(query,"to",&to);
+    if(from > to)
+    {
+        httpd_resp_send_err(req,HTTPD_400_BAD_REQUEST,"bad range");
+        return ESP_FAIL;
+    }
+    if(atomic_exchange(&s_export_busy,true))
+    {
+        httpd_resp_set_status(req,"503 Service Unavailable");
+        httpd_resp_set_hdr(req,"Retry-After","5");
+        httpd_resp_send(req,"export busy",HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+
+    history_export_t *exp = calloc(1,sizeof(history_export_t));
+    httpd_req_t *async_req = NULL;
+    if(!exp || httpd_req_async_handler_begin(req,&async_req) != ESP_OK)
+    {
+        free(exp);
+        atomic_store(&s_export_busy,false);
+        httpd_resp_send_err(req,HTTPD_500_INTERNAL_SERVER_ERROR,"no memory");
+        return ESP_FAIL;
+    }
+    exp->req = async_req;
+    exp->series = series;
+    exp->from = from;
+    exp->to = to;
+    exp->binary = binary;
+    //响应头在这里设置，复制的请求会带上
+    snprintf(exp->disposition,sizeof(exp->disposition),"attachment; filename=\"%s.%s\"",series->name,binary ? "bin" : "csv");
+    httpd_resp_set_type(async_req,binary ? "application/octet-stream" : "text/csv");
+    httpd_resp_set_hdr(async_req,"Content-Disposition",exp->disposition);
+    if(xTaskCreate(history_export_task,"hist_export",HISTORY_EXPORT_STACK,exp,3,NULL) != pdPASS)
+    {
+        httpd_resp_send_err(async_req,HTTPD_500_INTERNAL_SERVER_ERROR,"no memory");
+        httpd_req_async_handler_complete(async_req);
+        free(exp);
+        atomic_store(&s_export_busy,false);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/** 注册 HTTP 查询、聚合和导出接口，需要在 web_monitor_init 之后调用
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t history_register_uri(void)
+{
+    static const httpd_uri_t uri_history = {
+        .uri = "/history",
+        .method = HTTP_GET,
+        .handler = history_get_handler,
+        .user_ctx = NULL};
+    static const httpd_uri_t uri_rollup = {
+        .uri = "/rollup",
+        .method = HTTP_GET,
+        .handler = history_rollup_handler,
+        .user_ctx = NULL};
+    static const httpd_uri_t uri_export = {
+        .uri = "/export",
+        .method = HTTP_GET,
+        .handler = history_export_handler,
+        .user_ctx = NULL};
+    esp_err_t ret = web_monitor_register_uri(&uri_history);
+    if(ret == ESP_OK)
+        ret = web_monitor_register_uri(&uri_rollup);
+    if(ret == ESP_OK)
+        ret = web_monitor_register_uri(&uri_export);
+    return ret;
+}
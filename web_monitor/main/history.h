@@ -0,0 +1,67 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+#include <stdint.h>
+#include "esp_err.h"
+#include "tsdb.h"
+#include "rollup.h"
+
+/*
+ * 温湿度历史：每分钟一个点存入压缩序列，每个采样值计入多级聚合
+ * 提供 HTTP 查询接口 GET /history?series=temp&span=3600&n=200
+ *  series  序列名称，temp 或 humidity
+ *  span    最近多少秒，默认3600；也可以用 from/to 指定开机以来的毫秒时间范围
+ *  n       最多返回的点数，默认200，不超过 HISTORY_MAX_POINTS
+ * 点数超过 n 时用 LTTB 降采样，无论时间范围多大返回的数据量都是有上限的
+ * 返回 {"series":"temp","now":毫秒,"points":[[毫秒,数值],...]}
+ *
+ * 聚合查询 GET /rollup?series=temp&level=0&from=毫秒&to=毫秒，from/to 可以省略
+ *  level   聚合级别，0 分钟桶(最近1小时)，1 小时桶(2天)，2 天桶(30天)
+ * 返回开始时间在 [from, to) 内的桶和整个范围的合计，count 为0表示没有数据
+ * {"series":"temp","level":0,"width":桶宽度毫秒,"now":毫秒,"window":{"start":毫秒,"count":个数,"min":..,"max":..,"mean":..},
+ *  "buckets":[[开始毫秒,个数,最小,最大,平均],...]}
+ *
+ * 导出原始数据 GET /export?series=temp&format=csv|bin&from=毫秒&to=毫秒，from/to 可以省略
+ * 在单独的任务中分段读取、边编码边分块发送，占用的内存固定，同时只允许一个导出
+ *  csv  "# series=temp now_ms=毫秒" 注释行，"time_ms,temp" 表头，之后每行 "毫秒,数值"
+ *  bin  12字节头："HX"、版本、保留、now_ms(int64小端)；之后每个点两个zig-zag变长整数，
+ *       与上一个点的时间差和数值差，第一个点与0相比
+ */
+
+#define HISTORY_EXPORT_MAGIC    "HX"
+#define HISTORY_EXPORT_VERSION  1
+
+#define HISTORY_MAX_POINTS      500
+
+/** 初始化历史记录
+ * @param 无
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t history_init(void);
+
+/** 记录一次温湿度采样
+ * @param ts 时间戳(ms)
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @return 无
+*/
+void history_record(int64_t ts, int32_t temp_x10, int32_t humidity);
+
+/** 按名称查找历史序列
+ * @param name 名称
+ * @return 序列，找不到返回NULL
+*/
+tsdb_series_t *history_find(const char *name);
+
+/** 按名称查找聚合序列
+ * @param name 名称
+ * @return 序列，找不到返回NULL
+*/
+rollup_series_t *history_rollup_find(const char *name);
+
+/** 注册 HTTP 查询、聚合和导出接口，需要在 web_monitor_init 之后调用
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t history_register_uri(void);
+
+#endif
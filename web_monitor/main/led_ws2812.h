@@ -29,7 +29,7 @@ esp_err_t ws2812_init(gpio_num_t gpio,int maxled,ws2812_strip_handle_t* led_hand
 */
 esp_err_t ws2812_deinit(ws2812_strip_handle_t handle);
 
-/** 向某个WS2812写入RGB数据
+/** 向某个WS2812写入RGB数据，每次调用都发送整条灯带，连续修改多个灯时用ws2812_set + ws2812_refresh
  * @param handle 句柄
  * @param index 第几个WS2812（0开始）
  * @param r,g,b RGB数据
@@ -37,6 +37,27 @@ esp_err_t ws2812_deinit(ws2812_strip_handle_t handle);
 */
 esp_err_t ws2812_write(ws2812_strip_handle_t handle,uint32_t index,uint32_t r,uint32_t g,uint32_t b);
 
+/** 修改某个WS2812的RGB数据，只写缓存，不发送，改完后调用ws2812_refresh一次发送
+ * @param handle 句柄
+ * @param index 第几个WS2812（0开始）
+ * @param r,g,b RGB数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_set(ws2812_strip_handle_t handle,uint32_t index,uint32_t r,uint32_t g,uint32_t b);
+
+/** 所有WS2812设置成同一个颜色，只发送一次
+ * @param handle 句柄
+ * @param r,g,b RGB数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_fill(ws2812_strip_handle_t handle,uint32_t r,uint32_t g,uint32_t b);
+
+/** 把缓存中的RGB数据一次发送给整条灯带
+ * @param handle 句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t ws2812_refresh(ws2812_strip_handle_t handle);
+
 
 #ifdef __cplusplus
 }
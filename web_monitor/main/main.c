@@ -14,6 +14,12 @@
 #include "ws.h"
 #include "cJSON.h"
 #include "led_ws2812.h"
+#include "sensor_hub.h"
+#include "telemetry.h"
+#include "history.h"
+#include "file_server.h"
+#include "ws_cmd.h"
+#include "esp_timer.h"
 
 //LED GPIO
 #define LED_PIN     GPIO_NUM_27
@@ -27,70 +33,126 @@
 
 #define TAG     "main"
 
-//LED状态
+//WebSocket二进制帧的字段ID
+enum
+{
+    WS_FIELD_TEMP = 0,      //温度X10
+    WS_FIELD_HUMIDITY,      //湿度
+    WS_FIELD_LED,           //LED状态
+    WS_FIELD_NUM,
+};
+
+//LED状态，只在WebSocket接收回调中修改，读者通过telemetry获取
 static int led_state = 0;
-//温度
-static float s_fTemp = 0.0f;
-//湿度
-static int s_iHumidity = 0;
+//LED亮度
+static int32_t led_bright = 80;
 
-#define INDEX_HTML_PATH "/spiffs/esp.html"
-char index_html[8192];
+#define SPIFFS_BASE_PATH    "/spiffs"
+#define INDEX_HTML_PATH     "/esp.html"
 
 static ws2812_strip_handle_t ws2812_handle;
 
-/** 从spiffs中加载html页面到内存
+/** 挂载spiffs，网页文件由静态文件服务按需读取
  * @param 无
  * @return 无 
 */
-static void initi_web_page_buffer(void)
+static void init_web_fs(void)
 {
     //定义挂载点
     esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
+        .base_path = SPIFFS_BASE_PATH,
         .partition_label = NULL,
         .max_files = 5,
         .format_if_mount_failed = true
         };
     //挂载spiffs
     ESP_ERROR_CHECK(esp_vfs_spiffs_register(&conf));
-    memset((void *)index_html, 0, sizeof(index_html));
     //查找文件是否存在
     struct stat st;
-    if (stat(INDEX_HTML_PATH, &st))
+    if (stat(SPIFFS_BASE_PATH INDEX_HTML_PATH, &st))
     {
         ESP_LOGE(TAG, "esp.html not found");
-        return;
-    }
-    //打开html文件并且读取到内存中
-    FILE *fp = fopen(INDEX_HTML_PATH, "r");
-    if (fread(index_html, st.st_size, 1, fp) == 0)
-    {
-        ESP_LOGE(TAG, "fread failed");
     }
-    fclose(fp);
 }
 
+/** 按LED状态和亮度刷新WS2812，亮度没有变化时不刷新
+ * @param 无
+ * @return 无
+*/
+static void led_apply(void)
+{
+    static int32_t s_applied = -1;
+    int32_t value = led_state ? led_bright : 0;
+    if(value == s_applied)
+        return;
+    s_applied = value;
+    //整条灯带一次发送，逐个写入会发送 WS2812_NUM 帧，超过RMT发送队列深度
+    ws2812_fill(ws2812_handle,value,value,value);
+    //gpio_set_level(LED_PIN,led_state);
+}
+
+/** 命令：toggle，切换LED
+ * @param argc 参数个数
+ * @param argv 参数
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+static esp_err_t cmd_toggle(int argc, char **argv)
+{
+    led_state = led_state?0:1;
+    led_apply();
+    telemetry_set_led(led_state);
+    return ESP_OK;
+}
+
+/** 命令：led <0|1>，设置LED开关
+ * @param argc 参数个数
+ * @param argv 参数
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+static esp_err_t cmd_led(int argc, char **argv)
+{
+    int32_t on;
+    if(ws_cmd_parse_int(argv[1],0,1,&on) != ESP_OK)
+        return ESP_ERR_INVALID_ARG;
+    led_state = on;
+    led_apply();
+    telemetry_set_led(led_state);
+    return ESP_OK;
+}
+
+/** 命令：bright <0-255>，设置LED亮度，网页滑块拖动时会连续发送
+ * @param argc 参数个数
+ * @param argv 参数
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+static esp_err_t cmd_bright(int argc, char **argv)
+{
+    int32_t bright;
+    if(ws_cmd_parse_int(argv[1],0,255,&bright) != ESP_OK)
+        return ESP_ERR_INVALID_ARG;
+    led_bright = bright;
+    led_apply();
+    return ESP_OK;
+}
+
+//WebSocket命令表
+static const ws_cmd_t s_ws_cmds[] =
+{
+    {.name = "toggle", .min_args = 0, .max_args = 0, .fn = cmd_toggle},
+    {.name = "led", .min_args = 1, .max_args = 1, .fn = cmd_led},
+    {.name = "bright", .min_args = 1, .max_args = 1, .fn = cmd_bright},
+};
+
 /** 接收到WebSocket数据，触发此回调函数
- * @param payload 数据
+ * @param payload 数据，在接收缓存上原地解析
  * @param len 值
  * @return 无 
 */
 void esp_ws_receive(uint8_t* payload,int len)
 {
-    ESP_LOGI(TAG,"ws receive:%s",payload);
-    if(strstr((const char*)payload,"toggle"))
-    {
-        led_state = led_state?0:1;
-        uint32_t value = 0;
-        if(led_state)
-            value = 80;
-        for(int i = 0;i < WS2812_NUM;i++)
-        {
-            ws2812_write(ws2812_handle,i,value,value,value);
-        }
-        //gpio_set_level(LED_PIN,led_state);
-    }
+    esp_err_t ret = ws_cmd_dispatch(s_ws_cmds,sizeof(s_ws_cmds)/sizeof(s_ws_cmds[0]),(char*)payload,len);
+    if(ret != ESP_OK)
+        ESP_LOGW(TAG,"ws command failed:%s",esp_err_to_name(ret));
 }
 
 /** WebSocket服务器需要周期发送的数据
@@ -100,6 +162,20 @@ void esp_ws_receive(uint8_t* payload,int len)
 */
 void esp_ws_send(char* send_buf,int *len)
 {
+    //上次生成的数据和对应的版本号，没有变化时直接复用
+    static char s_last_json[128];
+    static int s_last_len = 0;
+    static uint32_t s_last_version = UINT32_MAX;
+
+    telemetry_t snap;
+    uint32_t version = telemetry_read(&snap);
+    if(s_last_len && version == s_last_version)
+    {
+        memcpy(send_buf,s_last_json,s_last_len + 1);
+        *len = s_last_len;
+        return;
+    }
+
     cJSON *js = cJSON_CreateObject();
     if(!js)
     {
@@ -108,42 +184,116 @@ void esp_ws_send(char* send_buf,int *len)
     }
     char str_buf[16] = {0};
     //led
-    if(led_state)
+    if(snap.led)
         snprintf(str_buf,16,"%s","ON");
     else
         snprintf(str_buf,16,"%s","OFF");
     cJSON_AddStringToObject(js,"led",str_buf);
 
     //温度
-    snprintf(str_buf,16,"%.1f°",s_fTemp);
+    snprintf(str_buf,16,"%.1f°",(float)snap.temp_x10/10.0);
     cJSON_AddStringToObject(js,"temp",str_buf);
 
     //湿度
-    snprintf(str_buf,16,"%d%%",s_iHumidity);
+    snprintf(str_buf,16,"%ld%%",snap.humidity);
     cJSON_AddStringToObject(js,"humidity",str_buf);
 
     char * js_value = cJSON_PrintUnformatted(js);
     sprintf(send_buf,"%s",js_value);
     *len = strlen(send_buf);
     ESP_LOGD(TAG,"ws send:%s",send_buf);
+    if(*len < sizeof(s_last_json))
+    {
+        memcpy(s_last_json,send_buf,*len + 1);
+        s_last_len = *len;
+        s_last_version = version;
+    }
 
     cJSON_free(js_value);
     cJSON_Delete(js);
 }
 
+/** WebSocket二进制帧的字段，字段ID与esp.html中的解码一致
+ * @param values 输出，下标即字段ID
+ * @param max 最多字段个数
+ * @return 字段个数
+*/
+int esp_ws_fields(int32_t *values,int max)
+{
+    telemetry_t snap;
+    if(max < WS_FIELD_NUM)
+        return 0;
+    telemetry_read(&snap);
+    values[WS_FIELD_TEMP] = snap.temp_x10;
+    values[WS_FIELD_HUMIDITY] = snap.humidity;
+    values[WS_FIELD_LED] = snap.led;
+    return WS_FIELD_NUM;
+}
+
+
+//DHT11的温度和湿度通道
+static int s_temp_chan = -1;
+static int s_humidity_chan = -1;
+
+/** DHT11采集完成回调，可能在RMT中断中执行，结果交给传感器中心
+ * @param result 1 成功，0 失败
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @param arg 无
+ * @return 是否唤醒了更高优先级的任务
+*/
+static bool dht11_done(int result, int temp_x10, int humidity, void *arg)
+{
+    int32_t values[2] = {temp_x10,humidity};
+    return sensor_hub_complete(s_temp_chan,values,result ? ESP_OK : ESP_FAIL);
+}
 
-void dht11_task(void* param)
+/** 传感器中心读取DHT11的函数，只启动采集，不等待
+ * @param values 无，结果由dht11_done交回
+ * @param arg 无
+ * @return ESP_ERR_NOT_FINISHED or ESP_FAIL
+*/
+static esp_err_t dht11_read(int32_t *values, void *arg)
 {
-    while(1)
-    {
-        int temp_x10 = 0;
-        vTaskDelay(pdMS_TO_TICKS(2500));
-        if(DHT11_StartGet(&temp_x10,&s_iHumidity))
-        {
-            s_fTemp = (float)temp_x10/10.0;
-            //ESP_LOGI(TAG,"temp:%.1f,humidity:%d",s_fTemp,s_iHumidity);
-        }
-    }
+    if(xDht11StartAsync(dht11_done,NULL) != ESP_OK)
+        return ESP_FAIL;
+    return ESP_ERR_NOT_FINISHED;
+}
+
+/** 温度通道每次采样的回调，在传感器中心的任务中执行，数值不变时也要计入历史和聚合
+ * 温湿度是同一次采样一起记录的，湿度取最新值即可
+ * @param channel 温度通道
+ * @param sample 温度采样值
+ * @param arg 无
+ * @return 无
+*/
+static void env_sampled(int channel, const sensor_sample_t *sample, void *arg)
+{
+    sensor_sample_t humidity;
+    if(sensor_hub_latest(s_humidity_chan,&humidity) != ESP_OK)
+        return;
+    history_record(sample->time_us / 1000,sample->value,humidity.value);
+}
+
+/** 温湿度变化的订阅回调，在传感器中心的任务中执行，温湿度成对写入遥测快照
+ * @param channel 变化的通道
+ * @param sample 采样值
+ * @param arg 无
+ * @return 无
+*/
+static void env_changed(int channel, const sensor_sample_t *sample, void *arg)
+{
+    //温湿度同时变化时会回调两次，同一次采样只处理一次
+    static int64_t last_time_us = -1;
+    sensor_sample_t temp,humidity;
+    if(sample->time_us == last_time_us)
+        return;
+    if(sensor_hub_latest(s_temp_chan,&temp) != ESP_OK || sensor_hub_latest(s_humidity_chan,&humidity) != ESP_OK)
+        return;
+    last_time_us = sample->time_us;
+
+    telemetry_set_env(temp.value,humidity.value,sample->time_us);
+    web_monitor_notify();
 }
 
 void app_main()
@@ -172,24 +322,52 @@ void app_main()
     ws2812_init(WS2812_PIN,WS2812_NUM,&ws2812_handle);
 
     led_state = 0;
+    telemetry_set_led(led_state);
 
     /*初始化DHT11*/
-    DHT11_Init(DHT11_PIN);
+    vDht11Init(DHT11_PIN);
 
     /*初始化SOFTAP*/
     softap_init();
 
-    /*加载html页面*/
-    initi_web_page_buffer();
+    /*挂载网页文件*/
+    init_web_fs();
 
     /*初始化WebSocket*/
     ws_cfg_t    ws;
-    ws.html_code = index_html;
+    ws.html_code = NULL;
     ws.intervel_ms = 2000;
+    ws.coalesce_ms = 100;
     ws.send_fn = esp_ws_send;
+    ws.fields_fn = esp_ws_fields;
     ws.receive_fn = esp_ws_receive;
     web_monitor_init(&ws);
 
     ESP_LOGI(TAG, "ESP32 ESP-IDF WebSocket Web Server is running ... ...\n");
-    xTaskCreatePinnedToCore(dht11_task,"dht11",4096,NULL,4,NULL,1);
+
+    /*历史记录*/
+    ESP_ERROR_CHECK(history_init());
+    history_register_uri();
+
+    /*静态文件，通配符匹配，最后注册*/
+    file_server_register(SPIFFS_BASE_PATH,INDEX_HTML_PATH);
+
+    /*传感器中心，DHT11每2.5秒采样一次*/
+    sensor_desc_t dht11_desc =
+    {
+        .name = "dht11",
+        .period_ms = 2500,
+        .read = dht11_read,
+        .arg = NULL,
+        .chan_num = 2,
+        .chan = {
+            {.name = "temp", .deadband = 0},        //温度X10
+            {.name = "humidity", .deadband = 0},    //湿度
+        },
+    };
+    s_temp_chan = sensor_hub_add(&dht11_desc);
+    s_humidity_chan = s_temp_chan + 1;
+    sensor_hub_subscribe((1u << s_temp_chan) | (1u << s_humidity_chan),env_changed,NULL);
+    sensor_hub_subscribe_samples(1u << s_temp_chan,env_sampled,NULL);
+    sensor_hub_start();
 }
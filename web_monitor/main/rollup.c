@@ -0,0 +1,167 @@
+#include "rollup.h"
+#include <string.h>
+#include <stdlib.h>
+
+/** 初始化序列
+ * @param series 序列
+ * @param name 名称
+ * @param cfg 每一级的配置，桶宽度从小到大
+ * @param level_num 级数
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t rollup_init(rollup_series_t *series, const char *name, const rollup_level_cfg_t *cfg, int level_num)
+{
+    if (level_num <= 0 || level_num > ROLLUP_MAX_LEVEL)
+        return ESP_ERR_INVALID_ARG;
+    memset(series, 0, sizeof(rollup_series_t));
+    for (int i = 0; i < level_num; i++)
+    {
+        if (cfg[i].width_ms == 0 || cfg[i].len == 0)
+        {
+            while (i--)
+                free(series->level[i].buckets);
+            return ESP_ERR_INVALID_ARG;
+        }
+        series->level[i].buckets = calloc(cfg[i].len, sizeof(rollup_bucket_t));
+        if (!series->level[i].buckets)
+        {
+            while (i--)
+                free(series->level[i].buckets);
+            return ESP_ERR_NO_MEM;
+        }
+        series->level[i].width_ms = cfg[i].width_ms;
+        series->level[i].len = cfg[i].len;
+    }
+    series->name = name;
+    series->level_num = level_num;
+    portMUX_INITIALIZE(&series->lock);
+    return ESP_OK;
+}
+
+/** 加入一个采样值，时间不能早于当前桶
+ * @param series 序列
+ * @param ts 时间戳(ms)
+ * @param value 数值
+ * @return 无
+*/
+void rollup_add(rollup_series_t *series, int64_t ts, int32_t value)
+{
+    portENTER_CRITICAL(&series->lock);
+    for (int i = 0; i < series->level_num; i++)
+    {
+        rollup_level_t *level = &series->level[i];
+        int64_t start = ts - ts % level->width_ms;
+        rollup_bucket_t *bucket = &level->buckets[level->head];
+        if (level->num == 0 || start > bucket->start)
+        {
+            //进入新的桶，没有数据的时间段不占用桶
+            if (level->num)
+                level->head = (level->head + 1) % level->len;
+            if (level->num < level->len)
+                level->num++;
+            bucket = &level->buckets[level->head];
+            bucket->start = start;
+            bucket->sum = 0;
+            bucket->min = value;
+            bucket->max = value;
+            bucket->count = 0;
+        }
+        else if (start < bucket->start)
+        {
+            //比当前桶还早的数据丢弃
+            continue;
+        }
+        bucket->sum += value;
+        if (value < bucket->min)
+            bucket->min = value;
+        if (value > bucket->max)
+            bucket->max = value;
+        bucket->count++;
+    }
+    portEXIT_CRITICAL(&series->lock);
+}
+
+/** 从旧到新第k个桶
+ * @param level 级
+ * @param k 序号
+ * @return 桶
+*/
+static inline rollup_bucket_t *rollup_bucket_at(rollup_level_t *level, int k)
+{
+    return &level->buckets[(level->head + level->len - level->num + 1 + k) % level->len];
+}
+
+/** 聚合一个时间窗口，合并开始时间在 [from, to) 内的桶
+ * @param series 序列
+ * @param level 级别
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param out 输出，out->start 为第一个桶的开始时间，count 为0表示窗口内没有数据
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t rollup_window(rollup_series_t *series, int level, int64_t from, int64_t to, rollup_bucket_t *out)
+{
+    if (level < 0 || level >= series->level_num)
+        return ESP_ERR_INVALID_ARG;
+    memset(out, 0, sizeof(rollup_bucket_t));
+    rollup_level_t *lv = &series->level[level];
+    portENTER_CRITICAL(&series->lock);
+    //从新到旧，桶的开始时间早于窗口就可以停止
+    for (int k = lv->num - 1; k >= 0; k--)
+    {
+        rollup_bucket_t *bucket = rollup_bucket_at(lv, k);
+        if (bucket->start < from)
+            break;
+        if (bucket->start >= to || bucket->count == 0)
+            continue;
+        if (out->count == 0)
+        {
+            out->min = bucket->min;
+            out->max = bucket->max;
+        }
+        else
+        {
+            if (bucket->min < out->min)
+                out->min = bucket->min;
+            if (bucket->max > out->max)
+                out->max = bucket->max;
+        }
+        out->start = bucket->start;
+        out->sum += bucket->sum;
+        out->count += bucket->count;
+    }
+    portEXIT_CRITICAL(&series->lock);
+    return ESP_OK;
+}
+
+/** 获取最近的若干个桶，按时间从旧到新
+ * @param series 序列
+ * @param level 级别
+ * @param buf 输出
+ * @param max_num 最多个数
+ * @return 实际个数
+*/
+int rollup_buckets(rollup_series_t *series, int level, rollup_bucket_t *buf, int max_num)
+{
+    if (level < 0 || level >= series->level_num || max_num <= 0)
+        return 0;
+    rollup_level_t *lv = &series->level[level];
+    portENTER_CRITICAL(&series->lock);
+    int num = lv->num < max_num ? lv->num : max_num;
+    for (int i = 0; i < num; i++)
+        buf[i] = *rollup_bucket_at(lv, lv->num - num + i);
+    portEXIT_CRITICAL(&series->lock);
+    return num;
+}
+
+/** 桶的平均值
+ * @param bucket 桶
+ * @return 平均值(四舍五入)，没有数据时返回0
+*/
+int32_t rollup_mean(const rollup_bucket_t *bucket)
+{
+    if (bucket->count == 0)
+        return 0;
+    int64_t half = bucket->count / 2;
+    return (int32_t)((bucket->sum >= 0 ? bucket->sum + half : bucket->sum - half) / (int64_t)bucket->count);
+}
@@ -0,0 +1,93 @@
+#ifndef _ROLLUP_H_
+#define _ROLLUP_H_
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/*
+ * 多级聚合：每来一个采样值，同时更新每一级(例如分钟、小时、天)当前桶的最小/最大/和/个数，
+ * 每个采样值的开销是固定的，不需要从原始数据重新计算
+ * 每一级是固定长度的环形缓存，保存最近 len 个桶
+ */
+
+#define ROLLUP_MAX_LEVEL    4       //最多级数
+
+//聚合桶
+typedef struct
+{
+    int64_t start;          //桶的开始时间(ms)，对齐到桶宽度
+    int64_t sum;            //和
+    int32_t min;            //最小值
+    int32_t max;            //最大值
+    uint32_t count;         //个数，0表示没有数据
+}rollup_bucket_t;
+
+//一级的配置
+typedef struct
+{
+    uint32_t width_ms;      //桶宽度，例如 60000 为每分钟一个桶
+    uint16_t len;           //保存的桶个数
+}rollup_level_cfg_t;
+
+//一级
+typedef struct
+{
+    uint32_t width_ms;
+    uint16_t len;
+    uint16_t head;          //当前桶
+    uint16_t num;           //有效的桶个数
+    rollup_bucket_t *buckets;
+}rollup_level_t;
+
+//序列
+typedef struct
+{
+    const char *name;
+    uint8_t level_num;
+    rollup_level_t level[ROLLUP_MAX_LEVEL];
+    portMUX_TYPE lock;
+}rollup_series_t;
+
+/** 初始化序列
+ * @param series 序列
+ * @param name 名称
+ * @param cfg 每一级的配置，桶宽度从小到大
+ * @param level_num 级数
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t rollup_init(rollup_series_t *series, const char *name, const rollup_level_cfg_t *cfg, int level_num);
+
+/** 加入一个采样值，时间不能早于当前桶
+ * @param series 序列
+ * @param ts 时间戳(ms)
+ * @param value 数值
+ * @return 无
+*/
+void rollup_add(rollup_series_t *series, int64_t ts, int32_t value);
+
+/** 聚合一个时间窗口，合并开始时间在 [from, to) 内的桶
+ * @param series 序列
+ * @param level 级别
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param out 输出，out->start 为第一个桶的开始时间，count 为0表示窗口内没有数据
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t rollup_window(rollup_series_t *series, int level, int64_t from, int64_t to, rollup_bucket_t *out);
+
+/** 获取最近的若干个桶，按时间从旧到新
+ * @param series 序列
+ * @param level 级别
+ * @param buf 输出
+ * @param max_num 最多个数
+ * @return 实际个数
+*/
+int rollup_buckets(rollup_series_t *series, int level, rollup_bucket_t *buf, int max_num);
+
+/** 桶的平均值
+ * @param bucket 桶
+ * @return 平均值(四舍五入)，没有数据时返回0
+*/
+int32_t rollup_mean(const rollup_bucket_t *bucket);
+
+#endif
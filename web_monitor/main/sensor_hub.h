@@ -0,0 +1,147 @@
+#ifndef _SENSOR_HUB_H_
+#define _SENSOR_HUB_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * 传感器中心：所有传感器由一个任务按各自的周期采样(不管有多少个使用者，每个周期只读一次)，
+ * 每个采样值带单调时间戳放入所在通道的历史环形缓存，数值变化时通知订阅者
+ * 一个传感器可以有多个通道(例如温度、湿度)，通道编号全局唯一
+ */
+
+#define SENSOR_HUB_MAX_SENSOR       6       //最多传感器个数
+#define SENSOR_HUB_MAX_CHANNEL      8       //最多通道个数
+#define SENSOR_HUB_SENSOR_CHANNEL   4       //每个传感器最多通道个数
+#define SENSOR_HUB_MAX_SUBSCRIBER   6       //最多订阅者个数
+#define SENSOR_HUB_HISTORY_LEN      32      //每个通道的历史记录长度
+
+//采样值
+typedef struct
+{
+    int64_t time_us;        //采样时刻(esp_timer_get_time)
+    int32_t value;          //数值，单位由传感器决定(例如温度X10)
+}sensor_sample_t;
+
+/** 读取传感器，在传感器中心的任务中执行
+ * 需要等待硬件的传感器可以只启动采集并返回ESP_ERR_NOT_FINISHED，
+ * 完成后调用sensor_hub_complete交回结果，在这之前不会再次读取
+ * @param values 输出，每个通道一个值
+ * @param arg 用户参数
+ * @return ESP_OK、ESP_ERR_NOT_FINISHED or 失败原因，失败时本次不记录
+*/
+typedef esp_err_t (*sensor_read_fn)(int32_t *values, void *arg);
+
+/** 订阅回调，在传感器中心的任务中执行，不要长时间阻塞
+ * 回调时同一传感器所有通道都已经记录了本次采样，可以用sensor_hub_latest成对读取
+ * @param channel 通道编号
+ * @param sample 采样值
+ * @param arg 用户参数
+ * @return 无
+*/
+typedef void (*sensor_hub_cb)(int channel, const sensor_sample_t *sample, void *arg);
+
+//通道描述
+typedef struct
+{
+    const char *name;       //通道名称
+    int32_t deadband;       //与上次通知的值相差超过这个值才通知订阅者，0表示每次变化都通知
+}sensor_chan_desc_t;
+
+//传感器描述
+typedef struct
+{
+    const char *name;               //传感器名称
+    uint32_t period_ms;             //采样周期
+    sensor_read_fn read;            //读取函数
+    void *arg;                      //读取函数的用户参数
+    uint8_t chan_num;               //通道个数
+    sensor_chan_desc_t chan[SENSOR_HUB_SENSOR_CHANNEL];
+}sensor_desc_t;
+
+//传感器统计
+typedef struct
+{
+    uint32_t reads;         //读取次数
+    uint32_t errors;        //读取失败次数
+    uint32_t overruns;      //错过的周期数(读取太慢或任务被阻塞)
+    uint32_t max_lateness_us;   //实际读取时刻比计划时刻晚的最大值
+}sensor_hub_stats_t;
+
+/** 添加传感器，需要在sensor_hub_start之前调用
+ * @param desc 描述，内容会被拷贝
+ * @return 第一个通道的编号，其余通道依次加1，失败返回-1
+*/
+int sensor_hub_add(const sensor_desc_t *desc);
+
+/** 启动采样任务
+ * @param 无
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t sensor_hub_start(void);
+
+/** 异步读取完成，交回结果，可以在中断中调用
+ * @param channel 传感器的第一个通道编号
+ * @param values 每个通道一个值
+ * @param result ESP_OK or 失败原因
+ * @return 是否唤醒了更高优先级的任务（在中断中调用时用于决定是否切换任务）
+*/
+bool sensor_hub_complete(int channel, const int32_t *values, esp_err_t result);
+
+/** 按名称查找通道
+ * @param name 通道名称
+ * @return 通道编号，没有找到返回-1
+*/
+int sensor_hub_find(const char *name);
+
+/** 获取通道名称
+ * @param channel 通道编号
+ * @return 名称，通道不存在返回NULL
+*/
+const char *sensor_hub_channel_name(int channel);
+
+/** 订阅通道的数值变化
+ * @param channel_mask 关心的通道，第n位对应通道n
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int sensor_hub_subscribe(uint32_t channel_mask, sensor_hub_cb cb, void *arg);
+
+/** 订阅通道的每次采样，数值不变或在死区内也回调，用于记录历史、统计等需要完整采样的场合
+ * @param channel_mask 关心的通道，第n位对应通道n
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 订阅编号，失败返回-1
+*/
+int sensor_hub_subscribe_samples(uint32_t channel_mask, sensor_hub_cb cb, void *arg);
+
+/** 取消订阅
+ * @param id sensor_hub_subscribe 返回的订阅编号
+ * @return 无
+*/
+void sensor_hub_unsubscribe(int id);
+
+/** 获取通道最新的采样值
+ * @param channel 通道编号
+ * @param sample 输出
+ * @return ESP_OK，还没有采样值时返回ESP_ERR_NOT_FOUND
+*/
+esp_err_t sensor_hub_latest(int channel, sensor_sample_t *sample);
+
+/** 获取通道的历史记录，按时间从旧到新
+ * @param channel 通道编号
+ * @param buf 输出
+ * @param max_num 最多取出的个数，超过历史记录个数时取最新的max_num个
+ * @return 实际取出的个数
+*/
+int sensor_hub_history(int channel, sensor_sample_t *buf, int max_num);
+
+/** 获取传感器统计信息
+ * @param channel 传感器的任一通道编号
+ * @param stats 输出
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t sensor_hub_get_stats(int channel, sensor_hub_stats_t *stats);
+
+#endif
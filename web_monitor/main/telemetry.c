@@ -0,0 +1,94 @@
+#include "telemetry.h"
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+
+/*
+ * 顺序锁：序号为奇数表示正在写
+ * 写者：序号+1(变奇数) -> 修改数据 -> 序号+1(变偶数)
+ * 读者：读序号(偶数) -> 拷贝数据 -> 再读序号，两次相同说明拷贝期间没有写，否则重读
+ * 写者在临界区内完成，不会被同一个核上的读者打断，读者最多等另一个核写完几个字段
+ */
+static atomic_uint s_seq;
+static telemetry_t s_data;
+
+//写者之间互斥
+static portMUX_TYPE s_write_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** 开始写
+ * @param 无
+ * @return 无
+*/
+static inline void telemetry_write_begin(void)
+{
+    portENTER_CRITICAL(&s_write_lock);
+    atomic_fetch_add_explicit(&s_seq, 1, memory_order_relaxed);
+    //序号先于数据可见
+    atomic_thread_fence(memory_order_release);
+}
+
+/** 结束写
+ * @param 无
+ * @return 无
+*/
+static inline void telemetry_write_end(void)
+{
+    atomic_fetch_add_explicit(&s_seq, 1, memory_order_release);
+    portEXIT_CRITICAL(&s_write_lock);
+}
+
+/** 更新温湿度
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @param time_us 采样时刻
+ * @return 无
+*/
+void telemetry_set_env(int32_t temp_x10, int32_t humidity, int64_t time_us)
+{
+    telemetry_write_begin();
+    s_data.temp_x10 = temp_x10;
+    s_data.humidity = humidity;
+    s_data.env_time_us = time_us;
+    telemetry_write_end();
+}
+
+/** 更新LED状态
+ * @param led LED状态
+ * @return 无
+*/
+void telemetry_set_led(int32_t led)
+{
+    telemetry_write_begin();
+    s_data.led = led;
+    telemetry_write_end();
+}
+
+/** 读取一份一致的快照，不会阻塞
+ * @param out 输出
+ * @return 快照的版本号，每次更新加1
+*/
+uint32_t telemetry_read(telemetry_t *out)
+{
+    unsigned seq1, seq2;
+    do
+    {
+        seq1 = atomic_load_explicit(&s_seq, memory_order_acquire);
+        if (seq1 & 1)
+            continue;
+        *out = *(volatile telemetry_t *)&s_data;
+        //数据读完之后再读序号
+        atomic_thread_fence(memory_order_acquire);
+        seq2 = atomic_load_explicit(&s_seq, memory_order_relaxed);
+        if (seq1 == seq2)
+            break;
+    } while (1);
+    return seq1 / 2;
+}
+
+/** 获取当前版本号，与上次读取的版本号相同说明没有变化
+ * @param 无
+ * @return 版本号
+*/
+uint32_t telemetry_version(void)
+{
+    return atomic_load_explicit(&s_seq, memory_order_acquire) / 2;
+}
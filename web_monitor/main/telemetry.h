@@ -0,0 +1,45 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+#include <stdint.h>
+
+/*
+ * 遥测快照：多个任务写不同的字段，网页推送等读者每次拷贝一份完整一致的记录
+ * 写者之间用自旋锁互斥，读者不加锁(顺序锁)，写的过程中读到的数据会被丢弃重读
+ */
+
+//遥测记录
+typedef struct
+{
+    int32_t temp_x10;       //温度X10
+    int32_t humidity;       //湿度
+    int64_t env_time_us;    //温湿度采样时刻
+    int32_t led;            //LED状态
+}telemetry_t;
+
+/** 更新温湿度
+ * @param temp_x10 温度X10
+ * @param humidity 湿度
+ * @param time_us 采样时刻
+ * @return 无
+*/
+void telemetry_set_env(int32_t temp_x10, int32_t humidity, int64_t time_us);
+
+/** 更新LED状态
+ * @param led LED状态
+ * @return 无
+*/
+void telemetry_set_led(int32_t led);
+
+/** 读取一份一致的快照，不会阻塞
+ * @param out 输出
+ * @return 快照的版本号，每次更新加1
+*/
+uint32_t telemetry_read(telemetry_t *out);
+
+/** 获取当前版本号，与上次读取的版本号相同说明没有变化
+ * @param 无
+ * @return 版本号
+*/
+uint32_t telemetry_version(void);
+
+#endif
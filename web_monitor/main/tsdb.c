@@ -0,0 +1,402 @@
+#include "tsdb.h"
+#include <string.h>
+#include <stdlib.h>
+
+//一个点最多占用的位数：时间 4+32，数值 3+32
+#define TSDB_POINT_MAX_BITS     71
+
+/** 向数据区写入若干位，高位在前
+ * @param block 块
+ * @param v 数据
+ * @param n 位数，不超过32
+ * @return 无
+*/
+static void tsdb_put_bits(tsdb_block_t *block, uint32_t v, int n)
+{
+    while (n > 0)
+    {
+        int free_bits = 8 - (block->bits & 7);
+        int take = n < free_bits ? n : free_bits;
+        uint32_t part = (v >> (n - take)) & ((1u << take) - 1);
+        block->data[block->bits >> 3] |= part << (free_bits - take);
+        block->bits += take;
+        n -= take;
+    }
+}
+
+/** 从数据区读出若干位
+ * @param data 数据区
+ * @param pos 读位置，读完后更新
+ * @param n 位数，不超过32
+ * @return 数据
+*/
+static uint32_t tsdb_get_bits(const uint8_t *data, uint16_t *pos, int n)
+{
+    uint32_t v = 0;
+    while (n > 0)
+    {
+        int left = 8 - (*pos & 7);
+        int take = n < left ? n : left;
+        uint32_t part = (data[*pos >> 3] >> (left - take)) & ((1u << take) - 1);
+        v = (v << take) | part;
+        *pos += take;
+        n -= take;
+    }
+    return v;
+}
+
+/** 读出一位
+ * @param data 数据区
+ * @param pos 读位置，读完后更新
+ * @return 0 or 1
+*/
+static inline int tsdb_get_bit(const uint8_t *data, uint16_t *pos)
+{
+    int bit = (data[*pos >> 3] >> (7 - (*pos & 7))) & 1;
+    (*pos)++;
+    return bit;
+}
+
+//zig-zag：小的正负数都变成小的非负数
+static inline uint32_t tsdb_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t tsdb_unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/** 写入时间的二阶差分
+ * '0'            0
+ * '10'   + 7位   [-63, 64]
+ * '110'  + 9位   [-255, 256]
+ * '1110' + 12位  [-2047, 2048]
+ * '1111' + 32位  其他
+*/
+static void tsdb_put_dod(tsdb_block_t *block, int32_t dod)
+{
+    if (dod == 0)
+        tsdb_put_bits(block, 0x0, 1);
+    else if (dod >= -63 && dod <= 64)
+    {
+        tsdb_put_bits(block, 0x2, 2);
+        tsdb_put_bits(block, dod + 63, 7);
+    }
+    else if (dod >= -255 && dod <= 256)
+    {
+        tsdb_put_bits(block, 0x6, 3);
+        tsdb_put_bits(block, dod + 255, 9);
+    }
+    else if (dod >= -2047 && dod <= 2048)
+    {
+        tsdb_put_bits(block, 0xE, 4);
+        tsdb_put_bits(block, dod + 2047, 12);
+    }
+    else
+    {
+        tsdb_put_bits(block, 0xF, 4);
+        tsdb_put_bits(block, (uint32_t)dod, 32);
+    }
+}
+
+static int32_t tsdb_get_dod(const uint8_t *data, uint16_t *pos)
+{
+    if (!tsdb_get_bit(data, pos))
+        return 0;
+    if (!tsdb_get_bit(data, pos))
+        return (int32_t)tsdb_get_bits(data, pos, 7) - 63;
+    if (!tsdb_get_bit(data, pos))
+        return (int32_t)tsdb_get_bits(data, pos, 9) - 255;
+    if (!tsdb_get_bit(data, pos))
+        return (int32_t)tsdb_get_bits(data, pos, 12) - 2047;
+    return (int32_t)tsdb_get_bits(data, pos, 32);
+}
+
+/** 写入数值
+ * '0'            与上一个值相同
+ * '10'  + 6位    差值 zig-zag < 64
+ * '110' + 12位   差值 zig-zag < 4096
+ * '111' + 32位   原值
+*/
+static void tsdb_put_value(tsdb_block_t *block, int32_t value)
+{
+    int64_t delta = (int64_t)value - block->last_value;
+    uint32_t zz = tsdb_zigzag((int32_t)delta);
+    if (delta == 0)
+        tsdb_put_bits(block, 0x0, 1);
+    else if (delta >= -32 && delta < 32)
+    {
+        tsdb_put_bits(block, 0x2, 2);
+        tsdb_put_bits(block, zz, 6);
+    }
+    else if (delta >= -2048 && delta < 2048)
+    {
+        tsdb_put_bits(block, 0x6, 3);
+        tsdb_put_bits(block, zz, 12);
+    }
+    else
+    {
+        tsdb_put_bits(block, 0x7, 3);
+        tsdb_put_bits(block, (uint32_t)value, 32);
+    }
+}
+
+static int32_t tsdb_get_value(const uint8_t *data, uint16_t *pos, int32_t last)
+{
+    if (!tsdb_get_bit(data, pos))
+        return last;
+    if (!tsdb_get_bit(data, pos))
+        return last + tsdb_unzigzag(tsdb_get_bits(data, pos, 6));
+    if (!tsdb_get_bit(data, pos))
+        return last + tsdb_unzigzag(tsdb_get_bits(data, pos, 12));
+    return (int32_t)tsdb_get_bits(data, pos, 32);
+}
+
+/** 初始化序列
+ * @param series 序列
+ * @param name 名称
+ * @param block_num 块个数，占用内存约 block_num * sizeof(tsdb_block_t)
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t tsdb_series_init(tsdb_series_t *series, const char *name, uint16_t block_num)
+{
+    memset(series, 0, sizeof(tsdb_series_t));
+    if (block_num == 0)
+        return ESP_ERR_INVALID_ARG;
+    series->blocks = calloc(block_num, sizeof(tsdb_block_t));
+    if (!series->blocks)
+        return ESP_ERR_NO_MEM;
+    series->lock = xSemaphoreCreateMutex();
+    if (!series->lock)
+    {
+        free(series->blocks);
+        series->blocks = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    series->name = name;
+    series->block_num = block_num;
+    return ESP_OK;
+}
+
+/** 开始一个新块，块用完时覆盖最旧的块
+ * @param series 序列
+ * @return 新块
+*/
+static tsdb_block_t *tsdb_new_block(tsdb_series_t *series)
+{
+    if (series->used == 0)
+    {
+        series->head = 0;
+        series->used = 1;
+    }
+    else
+    {
+        series->head = (series->head + 1) % series->block_num;
+        if (series->used < series->block_num)
+            series->used++;
+        else
+            series->evicted += series->blocks[series->head].count;
+    }
+    tsdb_block_t *block = &series->blocks[series->head];
+    memset(block, 0, sizeof(tsdb_block_t));
+    return block;
+}
+
+/** 追加一个点
+ * @param series 序列
+ * @param ts 时间戳(ms)，不能早于上一个点
+ * @param value 数值
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t tsdb_append(tsdb_series_t *series, int64_t ts, int32_t value)
+{
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(series->lock, portMAX_DELAY);
+    tsdb_block_t *block = series->used ? &series->blocks[series->head] : NULL;
+    if (block && ts < block->last_ts)
+    {
+        ret = ESP_ERR_INVALID_ARG;
+        goto out;
+    }
+    if (block && block->count)
+    {
+        int64_t delta = ts - block->last_ts;
+        int64_t dod = delta - block->last_delta;
+        //块写满、间隔太大或计数溢出时开始新块
+        if (block->bits + TSDB_POINT_MAX_BITS > TSDB_BLOCK_SIZE * 8 ||
+            delta > INT32_MAX || dod > INT32_MAX || dod < INT32_MIN || block->count == UINT16_MAX)
+        {
+            block = NULL;
+        }
+        else
+        {
+            tsdb_put_dod(block, (int32_t)dod);
+            tsdb_put_value(block, value);
+            block->last_delta = (int32_t)delta;
+            block->last_ts = ts;
+            block->last_value = value;
+            block->count++;
+            goto out;
+        }
+    }
+    //块中第一个点原样存放在块头
+    block = tsdb_new_block(series);
+    block->first_ts = ts;
+    block->last_ts = ts;
+    block->first_value = value;
+    block->last_value = value;
+    block->count = 1;
+out:
+    xSemaphoreGive(series->lock);
+    return ret;
+}
+
+/** 加锁，使用迭代器之前调用
+ * @param series 序列
+ * @return 无
+*/
+void tsdb_lock(tsdb_series_t *series)
+{
+    xSemaphoreTake(series->lock, portMAX_DELAY);
+}
+
+/** 解锁
+ * @param series 序列
+ * @return 无
+*/
+void tsdb_unlock(tsdb_series_t *series)
+{
+    xSemaphoreGive(series->lock);
+}
+
+/** 从旧到新第k个块
+ * @param series 序列
+ * @param k 序号
+ * @return 块
+*/
+static const tsdb_block_t *tsdb_block_at(const tsdb_series_t *series, uint16_t k)
+{
+    uint16_t oldest = series->used < series->block_num ? 0 : (series->head + 1) % series->block_num;
+    return &series->blocks[(oldest + k) % series->block_num];
+}
+
+/** 初始化迭代器，按时间从旧到新遍历 [from, to] 内的点
+ * @param it 迭代器
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @return 无
+*/
+void tsdb_iter_init(tsdb_iter_t *it, const tsdb_series_t *series, int64_t from, int64_t to)
+{
+    memset(it, 0, sizeof(tsdb_iter_t));
+    it->series = series;
+    it->from = from;
+    it->to = to;
+}
+
+/** 取下一个点
+ * @param it 迭代器
+ * @param point 输出
+ * @return true 取到，false 没有更多的点
+*/
+bool tsdb_iter_next(tsdb_iter_t *it, tsdb_point_t *point)
+{
+    const tsdb_series_t *series = it->series;
+    while (it->block < series->used)
+    {
+        const tsdb_block_t *block = tsdb_block_at(series, it->block);
+        if (it->index == 0)
+        {
+            //整块都在范围之前的直接跳过，不用解码
+            if (block->last_ts < it->from)
+            {
+                it->block++;
+                continue;
+            }
+            if (block->first_ts > it->to)
+                return false;
+            it->ts = block->first_ts;
+            it->value = block->first_value;
+            it->delta = 0;
+            it->pos = 0;
+        }
+        else if (it->index < block->count)
+        {
+            it->delta += tsdb_get_dod(block->data, &it->pos);
+            it->ts += it->delta;
+            it->value = tsdb_get_value(block->data, &it->pos, it->value);
+        }
+        else
+        {
+            it->block++;
+            it->index = 0;
+            continue;
+        }
+        it->index++;
+        if (it->ts > it->to)
+            return false;
+        if (it->ts >= it->from)
+        {
+            point->ts = it->ts;
+            point->value = it->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** 范围查询，内部加锁，回调中不要访问同一个序列
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 回调的点数
+*/
+int tsdb_query(tsdb_series_t *series, int64_t from, int64_t to, tsdb_point_cb cb, void *arg)
+{
+    tsdb_iter_t it;
+    tsdb_point_t point;
+    int num = 0;
+    tsdb_lock(series);
+    tsdb_iter_init(&it, series, from, to);
+    while (tsdb_iter_next(&it, &point))
+    {
+        num++;
+        if (!cb(&point, arg))
+            break;
+    }
+    tsdb_unlock(series);
+    return num;
+}
+
+/** 获取序列中的点数
+ * @param series 序列
+ * @return 点数
+*/
+uint32_t tsdb_count(tsdb_series_t *series)
+{
+    uint32_t num = 0;
+    tsdb_lock(series);
+    for (int i = 0; i < series->used; i++)
+        num += series->blocks[i].count;
+    tsdb_unlock(series);
+    return num;
+}
+
+/** 获取序列压缩数据占用的字节数(已写入的部分)
+ * @param series 序列
+ * @return 字节数
+*/
+uint32_t tsdb_used_bytes(tsdb_series_t *series)
+{
+    uint32_t bytes = 0;
+    tsdb_lock(series);
+    for (int i = 0; i < series->used; i++)
+        bytes += sizeof(tsdb_block_t) - TSDB_BLOCK_SIZE + (series->blocks[i].bits + 7) / 8;
+    tsdb_unlock(series);
+    return bytes;
+}
@@ -0,0 +1,137 @@
+#ifndef _TSDB_H_
+#define _TSDB_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/*
+ * 内存时间序列：按固定大小的块压缩存放 (时间戳, 整数值)
+ *  时间戳：块内第一个点原样存放，之后存二阶差分(delta-of-delta)，等间隔采样时每个点只占1位
+ *  数值：存与上一个点的差值(zig-zag)，按大小分档变长编码，不变时只占1位
+ * 块写满后开始下一个块，块用完后覆盖最旧的块，所以总是保留最近的数据
+ */
+
+#define TSDB_BLOCK_SIZE     240     //每个块的数据区字节数
+
+//数据点
+typedef struct
+{
+    int64_t ts;             //时间戳(ms)
+    int32_t value;          //数值
+}tsdb_point_t;
+
+//块
+typedef struct
+{
+    int64_t first_ts;       //第一个点的时间戳
+    int64_t last_ts;        //最后一个点的时间戳
+    int32_t last_delta;     //最后两个点的时间间隔
+    int32_t first_value;    //第一个点的数值
+    int32_t last_value;     //最后一个点的数值
+    uint16_t count;         //点数
+    uint16_t bits;          //数据区已用的位数
+    uint8_t data[TSDB_BLOCK_SIZE];
+}tsdb_block_t;
+
+//序列
+typedef struct
+{
+    const char *name;
+    tsdb_block_t *blocks;   //块数组，环形使用
+    uint16_t block_num;     //块个数
+    uint16_t used;          //已使用的块数
+    uint16_t head;          //当前写入的块
+    uint32_t evicted;       //被覆盖丢弃的点数
+    SemaphoreHandle_t lock;
+}tsdb_series_t;
+
+//迭代器，使用期间需要持有序列的锁(tsdb_lock)
+typedef struct
+{
+    const tsdb_series_t *series;
+    int64_t from;           //时间范围
+    int64_t to;
+    uint16_t block;         //当前是从旧到新的第几个块
+    uint16_t index;         //当前块中的第几个点
+    uint16_t pos;           //当前块数据区的读位置(位)
+    int64_t ts;             //上一个点
+    int32_t delta;
+    int32_t value;
+}tsdb_iter_t;
+
+/** 遍历回调
+ * @param point 数据点
+ * @param arg 用户参数
+ * @return true 继续，false 停止
+*/
+typedef bool (*tsdb_point_cb)(const tsdb_point_t *point, void *arg);
+
+/** 初始化序列
+ * @param series 序列
+ * @param name 名称
+ * @param block_num 块个数，占用内存约 block_num * sizeof(tsdb_block_t)
+ * @return ESP_OK or ESP_ERR_NO_MEM
+*/
+esp_err_t tsdb_series_init(tsdb_series_t *series, const char *name, uint16_t block_num);
+
+/** 追加一个点
+ * @param series 序列
+ * @param ts 时间戳(ms)，不能早于上一个点
+ * @param value 数值
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t tsdb_append(tsdb_series_t *series, int64_t ts, int32_t value);
+
+/** 加锁，使用迭代器之前调用
+ * @param series 序列
+ * @return 无
+*/
+void tsdb_lock(tsdb_series_t *series);
+
+/** 解锁
+ * @param series 序列
+ * @return 无
+*/
+void tsdb_unlock(tsdb_series_t *series);
+
+/** 初始化迭代器，按时间从旧到新遍历 [from, to] 内的点
+ * @param it 迭代器
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @return 无
+*/
+void tsdb_iter_init(tsdb_iter_t *it, const tsdb_series_t *series, int64_t from, int64_t to);
+
+/** 取下一个点
+ * @param it 迭代器
+ * @param point 输出
+ * @return true 取到，false 没有更多的点
+*/
+bool tsdb_iter_next(tsdb_iter_t *it, tsdb_point_t *point);
+
+/** 范围查询，内部加锁，回调中不要访问同一个序列
+ * @param series 序列
+ * @param from 开始时间(ms)
+ * @param to 结束时间(ms)
+ * @param cb 回调函数
+ * @param arg 用户参数
+ * @return 回调的点数
+*/
+int tsdb_query(tsdb_series_t *series, int64_t from, int64_t to, tsdb_point_cb cb, void *arg);
+
+/** 获取序列中的点数
+ * @param series 序列
+ * @return 点数
+*/
+uint32_t tsdb_count(tsdb_series_t *series);
+
+/** 获取序列压缩数据占用的字节数(已写入的部分)
+ * @param series 序列
+ * @return 字节数
+*/
+uint32_t tsdb_used_bytes(tsdb_series_t *series);
+
+#endif
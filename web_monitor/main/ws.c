@@ -1,9 +1,15 @@
 
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "lwip/sockets.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 #include "ws.h"
+#include "ws_bin.h"
 
 static const char *TAG = "WebSocket Server";
 //html页面
@@ -12,60 +18,543 @@ static const char* http_html = NULL;
 static ws_receive_cb  ws_receive_fn = NULL;
 //周期发送的数据
 static ws_send_cb   ws_send_fn = NULL;
+//二进制帧的字段
+static ws_fields_cb ws_fields_fn = NULL;
 
-static char ws_async_send_buff[256];
+//广播帧的最大长度
+#define WS_FRAME_MAX            256
+//每个客户端最多排队的帧数，排满说明客户端太慢，直接断开
+#define WS_CLIENT_QUEUE_LEN     4
+//最多客户端个数，与httpd默认的max_open_sockets一致
+#define WS_MAX_CLIENT           7
+//默认合并窗口
+#define WS_COALESCE_MS          50
+//接收缓存个数和大小，超过大小的帧直接断开连接
+#define WS_RX_BUF_NUM           2
+#define WS_RX_BUF_SIZE          128
+//socket发送超时，超时的客户端被断开，避免长时间占住httpd任务
+#define WS_SEND_TIMEOUT_S       2
+//socket发送缓存满时，隔一段时间再尝试发送
+#define WS_TX_RETRY_MS          20
 
-httpd_handle_t server = NULL;
-struct async_resp_arg {
-    httpd_handle_t hd;
+//序列化好的帧，所有客户端共享，引用计数为0时释放
+typedef struct
+{
+    uint32_t ref;
+    int64_t time_us;        //生成时间，用于统计广播延迟
+    httpd_ws_type_t type;
+    int len;
+    uint8_t data[];
+}ws_frame_t;
+
+//客户端及其发送队列
+typedef struct
+{
+    bool used;
+    bool binary;            //已经切换到二进制帧
     int fd;
-};
+    uint8_t head;
+    uint8_t num;
+    ws_frame_t *queue[WS_CLIENT_QUEUE_LEN];
+}ws_client_t;
+
+httpd_handle_t server = NULL;
+
+static ws_client_t s_clients[WS_MAX_CLIENT];
+//最近一次广播的文本帧，新连接的客户端先收到这一帧
+static ws_frame_t *s_last_text = NULL;
+//最近一次的二进制关键帧，切换到二进制的客户端先收到这一帧，之后只收差分帧
+static ws_frame_t *s_last_key = NULL;
+//上一帧二进制字段的值和序号，只在esp_timer任务中使用
+static int32_t s_bin_prev[WS_BIN_MAX_FIELD];
+static int s_bin_num = 0;
+static uint8_t s_bin_seq = 0;
+static portMUX_TYPE s_ws_lock = portMUX_INITIALIZER_UNLOCKED;
+//是否已经有排队的发送工作
+static atomic_bool s_tx_pending = false;
+//生成帧的缓存，只在esp_timer任务中使用
+static char s_build_buff[WS_FRAME_MAX];
+static esp_timer_handle_t s_notify_timer = NULL;
+static esp_timer_handle_t s_retry_timer = NULL;
+static uint32_t s_coalesce_ms = WS_COALESCE_MS;
+static ws_stats_t s_stats;
+//当前存在的帧个数和字节数
+static uint32_t s_frames_alive = 0;
+static uint32_t s_frames_bytes = 0;
+//接收缓存池，多留1字节放'\0'
+static uint8_t s_rx_buf[WS_RX_BUF_NUM][WS_RX_BUF_SIZE + 1];
+static uint32_t s_rx_used = 0;
 
-static void ws_async_send(void *arg)
+static void ws_tx_kick(void);
+static void ws_client_drop(int fd);
+
+/** 释放一次帧的引用
+ * @param frame 帧
+ * @return 无
+*/
+static void ws_frame_release(ws_frame_t *frame)
 {
-    httpd_ws_frame_t ws_pkt;
-    struct async_resp_arg *resp_arg = arg;
-    httpd_handle_t hd = resp_arg->hd;
-    int fd = resp_arg->fd;
+    if(!frame)
+        return;
+    portENTER_CRITICAL(&s_ws_lock);
+    bool last = --frame->ref == 0;
+    if(last)
+    {
+        s_frames_alive--;
+        s_frames_bytes -= sizeof(ws_frame_t) + frame->len;
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    if(last)
+        free(frame);
+}
 
-    int send_len = 0;
-    if(ws_send_fn)
-        ws_send_fn(ws_async_send_buff,&send_len);
-    else
+/** 新建一帧，引用计数为1
+ * @param type 帧类型
+ * @param data 数据
+ * @param len 长度
+ * @return 帧，内存不足时返回NULL
+*/
+static ws_frame_t *ws_frame_new(httpd_ws_type_t type, const void *data, int len)
+{
+    ws_frame_t *frame = malloc(sizeof(ws_frame_t) + len);
+    if(!frame)
+        return NULL;
+    frame->ref = 1;
+    frame->time_us = esp_timer_get_time();
+    frame->type = type;
+    frame->len = len;
+    memcpy(frame->data, data, len);
+    portENTER_CRITICAL(&s_ws_lock);
+    s_frames_alive++;
+    s_frames_bytes += sizeof(ws_frame_t) + len;
+    if(s_frames_alive > s_stats.frames_alive_max)
+        s_stats.frames_alive_max = s_frames_alive;
+    if(s_frames_bytes > s_stats.frames_bytes_max)
+        s_stats.frames_bytes_max = s_frames_bytes;
+    portEXIT_CRITICAL(&s_ws_lock);
+    return frame;
+}
+
+/** 帧放入客户端队列，需要持有锁
+ * @param client 客户端
+ * @param frame 帧
+ * @return false 队列已满
+*/
+static bool ws_client_push(ws_client_t *client, ws_frame_t *frame)
+{
+    if(client->num == WS_CLIENT_QUEUE_LEN)
+        return false;
+    frame->ref++;
+    client->queue[(client->head + client->num) % WS_CLIENT_QUEUE_LEN] = frame;
+    client->num++;
+    return true;
+}
+
+/** 新的客户端，把最近一次的文本帧放入队列
+ * @param fd socket
+ * @return 无
+*/
+static void ws_client_add(int fd)
+{
+    ws_client_t *client = NULL;
+    portENTER_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
     {
-        free(resp_arg);
+        if(s_clients[i].used && s_clients[i].fd == fd)
+        {
+            client = &s_clients[i];
+            break;
+        }
+        if(!client && !s_clients[i].used)
+            client = &s_clients[i];
+    }
+    if(client && !client->used)
+    {
+        if(++s_stats.clients > s_stats.clients_max)
+            s_stats.clients_max = s_stats.clients;
+        memset(client, 0, sizeof(ws_client_t));
+        client->used = true;
+        client->fd = fd;
+        if(s_last_text)
+            ws_client_push(client, s_last_text);
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    if(!client)
+        ESP_LOGW(TAG, "too many clients, fd %d not added", fd);
+    ws_tx_kick();
+}
+
+/** 客户端切换到二进制帧，或者序号不连续时重新请求，先发送最近的关键帧
+ * @param fd socket
+ * @return 无
+*/
+static void ws_client_set_binary(int fd)
+{
+    bool full = false;
+    portENTER_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
+    {
+        ws_client_t *client = &s_clients[i];
+        if(client->used && client->fd == fd)
+        {
+            client->binary = true;
+            if(s_last_key)
+                full = !ws_client_push(client, s_last_key);
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    if(full)
+    {
+        ws_client_drop(fd);
         return;
     }
-    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-    ws_pkt.payload = (uint8_t *)ws_async_send_buff;
-    ws_pkt.len = strlen(ws_async_send_buff);
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    
-    static size_t max_clients = CONFIG_LWIP_MAX_LISTENING_TCP;
-    size_t fds = max_clients;
-    int client_fds[max_clients];
-
-    //将消息推送到所有客户端
-    esp_err_t ret = httpd_get_client_list(server, &fds, client_fds);
-    if (ret != ESP_OK) {
+    ws_tx_kick();
+}
+
+/** 移除客户端，释放队列中的帧
+ * @param fd socket
+ * @return 无
+*/
+static void ws_client_remove(int fd)
+{
+    ws_frame_t *frames[WS_CLIENT_QUEUE_LEN];
+    int num = 0;
+    portENTER_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
+    {
+        ws_client_t *client = &s_clients[i];
+        if(client->used && client->fd == fd)
+        {
+            for(num = 0;num < client->num;num++)
+                frames[num] = client->queue[(client->head + num) % WS_CLIENT_QUEUE_LEN];
+            client->used = false;
+            client->num = 0;
+            s_stats.clients--;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < num;i++)
+        ws_frame_release(frames[i]);
+}
+
+/** 断开客户端，httpd在自己的任务中关闭socket
+ * @param fd socket
+ * @return 无
+*/
+static void ws_client_drop(int fd)
+{
+    ws_client_remove(fd);
+    httpd_sess_trigger_close(server, fd);
+}
+
+/** 取出客户端队列中的下一帧
+ * @param index 客户端序号
+ * @param fd 输出，socket
+ * @return 帧，队列空时返回NULL
+*/
+static ws_frame_t *ws_client_pop(int index, int *fd)
+{
+    ws_frame_t *frame = NULL;
+    portENTER_CRITICAL(&s_ws_lock);
+    ws_client_t *client = &s_clients[index];
+    if(client->used && client->num)
+    {
+        frame = client->queue[client->head];
+        client->head = (client->head + 1) % WS_CLIENT_QUEUE_LEN;
+        client->num--;
+        *fd = client->fd;
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    return frame;
+}
+
+/** socket发送缓存是否有空间，没有空间时先不发送，避免阻塞httpd任务，由重试定时器稍后再发
+ * 一直没有空间的客户端队列会排满，在下一次广播时被断开
+ * @param fd socket
+ * @return true 可以发送
+*/
+static bool ws_fd_writable(int fd)
+{
+    fd_set wfds;
+    struct timeval tv = {0};
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+/** 统计计数加一，统计在多个任务中更新，需要加锁
+ * @param counter 计数
+ * @return 无
+*/
+static void ws_stats_inc(uint32_t *counter)
+{
+    portENTER_CRITICAL(&s_ws_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&s_ws_lock);
+}
+
+/** 记录一次发送完成
+ * @param latency_us 帧生成到发送完成的时间
+ * @param len 帧长度
+ * @return 无
+*/
+static void ws_stats_latency(int64_t latency_us, int len)
+{
+    int bucket = 0;
+    while(bucket < WS_LATENCY_BUCKETS - 1 && latency_us >= (2ll << bucket))
+        bucket++;
+    portENTER_CRITICAL(&s_ws_lock);
+    s_stats.latency_hist[bucket]++;
+    if(latency_us > s_stats.latency_max_us)
+        s_stats.latency_max_us = latency_us;
+    s_stats.sent++;
+    s_stats.sent_bytes += len;
+    portEXIT_CRITICAL(&s_ws_lock);
+}
+
+/** 在httpd任务中发送所有客户端队列中的帧
+ * @param arg 无
+ * @return 无
+*/
+static void ws_tx_work(void *arg)
+{
+    bool busy = false;
+    //先清标志，发送过程中新入队的帧会再安排一次工作
+    atomic_store(&s_tx_pending, false);
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
+    {
+        while(1)
+        {
+            int fd;
+            portENTER_CRITICAL(&s_ws_lock);
+            fd = s_clients[i].used && s_clients[i].num ? s_clients[i].fd : -1;
+            portEXIT_CRITICAL(&s_ws_lock);
+            if(fd < 0)
+                break;
+            if(!ws_fd_writable(fd))
+            {
+                ws_stats_inc(&s_stats.tx_busy);
+                busy = true;
+                break;
+            }
+            ws_frame_t *frame = ws_client_pop(i, &fd);
+            if(!frame)
+                break;
+            httpd_ws_frame_t ws_pkt;
+            memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+            ws_pkt.payload = frame->data;
+            ws_pkt.len = frame->len;
+            ws_pkt.type = frame->type;
+            esp_err_t ret = ESP_FAIL;
+            if(httpd_ws_get_fd_info(server, fd) == HTTPD_WS_CLIENT_WEBSOCKET)
+                ret = httpd_ws_send_frame_async(server, fd, &ws_pkt);
+            if(ret == ESP_OK)
+                ws_stats_latency(esp_timer_get_time() - frame->time_us, frame->len);
+            ws_frame_release(frame);
+            if(ret != ESP_OK)
+            {
+                //连接已经断开或者发送超时
+                ESP_LOGW(TAG, "send to fd %d failed, drop client", fd);
+                ws_stats_inc(&s_stats.send_fail);
+                ws_client_drop(fd);
+                break;
+            }
+        }
+    }
+    //有客户端的帧没有发出去，稍后重试，定时器已经在运行时正好合并
+    if(busy && s_retry_timer)
+        esp_timer_start_once(s_retry_timer, WS_TX_RETRY_MS * 1000ull);
+}
+
+/** 安排一次发送工作，已经有排队的工作时不再重复安排
+ * @param 无
+ * @return 无
+*/
+static void ws_tx_kick(void)
+{
+    if(server == NULL || atomic_exchange(&s_tx_pending, true))
+        return;
+    if(httpd_queue_work(server, ws_tx_work, NULL) != ESP_OK)
+        atomic_store(&s_tx_pending, false);
+}
+
+/** 生成二进制关键帧和差分帧，字段没有变化时不生成
+ * @param key 输出，关键帧
+ * @param delta 输出，差分帧，第一帧或字段个数变化时为NULL，此时客户端收关键帧
+ * @return 无
+*/
+static void ws_build_bin(ws_frame_t **key, ws_frame_t **delta)
+{
+    int32_t values[WS_BIN_MAX_FIELD];
+    uint8_t buf[WS_BIN_FRAME_MAX];
+    int num = ws_fields_fn(values, WS_BIN_MAX_FIELD);
+    if(num <= 0 || num > WS_BIN_MAX_FIELD)
+        return;
+    bool same_layout = num == s_bin_num;
+    if(same_layout && memcmp(values, s_bin_prev, num * sizeof(int32_t)) == 0)
+        return;
+    s_bin_seq++;
+    if(same_layout)
+        *delta = ws_frame_new(HTTPD_WS_TYPE_BINARY, buf, ws_bin_encode(buf, s_bin_seq, values, s_bin_prev, num));
+    *key = ws_frame_new(HTTPD_WS_TYPE_BINARY, buf, ws_bin_encode(buf, s_bin_seq, values, NULL, num));
+    memcpy(s_bin_prev, values, num * sizeof(int32_t));
+    s_bin_num = num;
+}
+
+/** 生成文本帧，内容与上一帧相同时不生成
+ * @param 无
+ * @return 帧
+*/
+static ws_frame_t *ws_build_text(void)
+{
+    int len = 0;
+    ws_send_fn(s_build_buff, &len);
+    if(len <= 0 || len > (int)sizeof(s_build_buff))
+        return NULL;
+    //s_last_text只在esp_timer任务中替换，读它不需要加锁
+    if(s_last_text && s_last_text->len == len && memcmp(s_last_text->data, s_build_buff, len) == 0)
+        return NULL;
+    return ws_frame_new(HTTPD_WS_TYPE_TEXT, s_build_buff, len);
+}
+
+/** 生成帧并放入所有客户端的队列，帧只生成一次由客户端共享，内容不变时不发送
+ * 只在esp_timer任务中调用
+ * @param 无
+ * @return 无
+*/
+static void ws_broadcast_update(void)
+{
+    ws_frame_t *text = NULL, *key = NULL, *delta = NULL;
+    int text_num = 0, queued_num = 0;
+    portENTER_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
+    {
+        if(s_clients[i].used && !s_clients[i].binary)
+            text_num++;
+        if(s_clients[i].used)
+            queued_num += s_clients[i].num;
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+
+    //没有文本客户端时不生成JSON
+    if(ws_send_fn && (text_num || !s_last_text))
+        text = ws_build_text();
+    //二进制帧总是生成，保持差分的基准与关键帧一致
+    if(ws_fields_fn)
+        ws_build_bin(&key, &delta);
+    if(!text && !key)
+    {
+        ws_stats_inc(&s_stats.skipped);
+        //内容没有变化，但之前的帧可能还在队列中没有发出去
+        if(queued_num)
+            ws_tx_kick();
         return;
     }
 
-    for (int i = 0; i < fds; i++) {
-        int client_info = httpd_ws_get_fd_info(server, client_fds[i]);
-        if (client_info == HTTPD_WS_CLIENT_WEBSOCKET) {
-            httpd_ws_send_frame_async(hd, client_fds[i], &ws_pkt);
+    int slow_fd[WS_MAX_CLIENT];
+    int slow_num = 0;
+    ws_frame_t *old_text = NULL, *old_key = NULL;
+    portENTER_CRITICAL(&s_ws_lock);
+    if(text)
+    {
+        old_text = s_last_text;
+        s_last_text = text;
+    }
+    if(key)
+    {
+        old_key = s_last_key;
+        s_last_key = key;
+    }
+    for(int i = 0;i < WS_MAX_CLIENT;i++)
+    {
+        ws_client_t *client = &s_clients[i];
+        ws_frame_t *frame = client->binary ? (delta ? delta : key) : text;
+        if(!client->used || !frame)
+            continue;
+        if(!ws_client_push(client, frame))
+            slow_fd[slow_num++] = client->fd;
+    }
+    portEXIT_CRITICAL(&s_ws_lock);
+    //text和key的引用转给s_last_text/s_last_key，delta只由队列持有
+    ws_frame_release(old_text);
+    ws_frame_release(old_key);
+    ws_frame_release(delta);
+    ws_stats_inc(&s_stats.frames);
+
+    //队列排满的客户端跟不上，断开
+    for(int i = 0;i < slow_num;i++)
+    {
+        ESP_LOGW(TAG, "fd %d too slow, drop client", slow_fd[i]);
+        ws_stats_inc(&s_stats.slow_drop);
+        ws_client_drop(slow_fd[i]);
+    }
+    ws_tx_kick();
+}
+
+/** 合并窗口结束，或者周期检查
+ * @param arg 无
+ * @return 无
+*/
+static void ws_broadcast_timer_cb(void *arg)
+{
+    ws_broadcast_update();
+}
+
+/** 发送重试定时器
+ * @param arg 无
+ * @return 无
+*/
+static void ws_tx_retry_cb(void *arg)
+{
+    ws_tx_kick();
+}
+
+/** 从缓存池取一块接收缓存
+ * @param 无
+ * @return 缓存，没有空闲时返回NULL
+*/
+static uint8_t *ws_rx_buf_get(void)
+{
+    uint8_t *buf = NULL;
+    portENTER_CRITICAL(&s_ws_lock);
+    for(int i = 0;i < WS_RX_BUF_NUM;i++)
+    {
+        if(!(s_rx_used & (1u << i)))
+        {
+            s_rx_used |= 1u << i;
+            buf = s_rx_buf[i];
+            break;
         }
     }
-    free(resp_arg);
+    portEXIT_CRITICAL(&s_ws_lock);
+    return buf;
 }
 
-static esp_err_t trigger_async_send(httpd_handle_t handle, httpd_req_t *req)
+/** 归还接收缓存
+ * @param buf 缓存
+ * @return 无
+*/
+static void ws_rx_buf_put(uint8_t *buf)
 {
-    struct async_resp_arg *resp_arg = malloc(sizeof(struct async_resp_arg));
-    resp_arg->hd = req->handle;
-    resp_arg->fd = httpd_req_to_sockfd(req);
-    return httpd_queue_work(handle, ws_async_send, resp_arg);
+    if(!buf)
+        return;
+    int i = (buf - s_rx_buf[0]) / sizeof(s_rx_buf[0]);
+    portENTER_CRITICAL(&s_ws_lock);
+    s_rx_used &= ~(1u << i);
+    portEXIT_CRITICAL(&s_ws_lock);
+}
+
+/** httpd关闭socket时的回调
+ * @param hd httpd
+ * @param sockfd socket
+ * @return 无
+*/
+static void ws_close_fn(httpd_handle_t hd, int sockfd)
+{
+    ws_client_remove(sockfd);
+    close(sockfd);
 }
 
 /** 当其他设备WS访问时触发此回调函数
@@ -77,6 +566,7 @@ static esp_err_t handle_ws_req(httpd_req_t *req)
     if (req->method == HTTP_GET)
     {
         ESP_LOGI(TAG, "Handshake done, the new connection was opened");
+        ws_client_add(httpd_req_to_sockfd(req));
         return ESP_OK;
     }
 
@@ -91,34 +581,52 @@ static esp_err_t handle_ws_req(httpd_req_t *req)
         return ret;
     }
 
+    //超过接收缓存的帧不处理，断开连接
+    if (ws_pkt.len > WS_RX_BUF_SIZE)
+    {
+        ESP_LOGW(TAG, "frame too long: %d", (int)ws_pkt.len);
+        ws_stats_inc(&s_stats.rx_oversize);
+        return ESP_ERR_INVALID_SIZE;
+    }
     if (ws_pkt.len)
     {
-        buf = calloc(1, ws_pkt.len + 1);
+        buf = ws_rx_buf_get();
         if (buf == NULL)
         {
-            ESP_LOGE(TAG, "Failed to calloc memory for buf");
+            ESP_LOGE(TAG, "no free rx buffer");
             return ESP_ERR_NO_MEM;
         }
         ws_pkt.payload = buf;
-        ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+        ret = httpd_ws_recv_frame(req, &ws_pkt, WS_RX_BUF_SIZE);
         if (ret != ESP_OK)
         {
             ESP_LOGE(TAG, "httpd_ws_recv_frame failed with %d", ret);
-            free(buf);
+            ws_rx_buf_put(buf);
             return ret;
         }
-        ESP_LOGI(TAG, "Got packet with message: %s", ws_pkt.payload);
+        buf[ws_pkt.len] = '\0';
+        ESP_LOGD(TAG, "Got packet with message: %s", ws_pkt.payload);
     }
+    ws_stats_inc(&s_stats.rx);
 
-    ESP_LOGI(TAG, "frame len is %d", ws_pkt.len);
-
-    if (ws_pkt.type == HTTPD_WS_TYPE_TEXT)
+    if (ws_pkt.type == HTTPD_WS_TYPE_TEXT && buf)
     {
+        //切换到二进制帧，不交给用户回调
+        if(ws_fields_fn && ws_pkt.len == strlen(WS_PROTO_BIN) && memcmp(ws_pkt.payload, WS_PROTO_BIN, ws_pkt.len) == 0)
+        {
+            ws_rx_buf_put(buf);
+            ws_client_set_binary(httpd_req_to_sockfd(req));
+            return ESP_OK;
+        }
+        //payload在回调返回前有效，回调可以原地修改
         if(ws_receive_fn)
             ws_receive_fn(ws_pkt.payload,ws_pkt.len);
-        free(buf);
-        return trigger_async_send(req->handle, req);
+        ws_rx_buf_put(buf);
+        //接收的数据可能改变了状态，合并后广播
+        web_monitor_notify();
+        return ESP_OK;
     }
+    ws_rx_buf_put(buf);
     return ESP_OK;
 }
 
@@ -134,10 +642,44 @@ esp_err_t get_req_handler(httpd_req_t *req)
     return response;
 }
 
+/** HTTP GET /stats 返回广播统计，/stats?reset=1 返回后清零，压测工具分段读取
+ * @param req http请求
+ * @return ESP_OK or ESP_FAIL
+*/
+static esp_err_t stats_req_handler(httpd_req_t *req)
+{
+    char buf[512];
+    char query[16];
+    ws_stats_t st;
+    web_monitor_get_stats(&st);
+    int len = snprintf(buf, sizeof(buf),
+        "{\"clients\":%lu,\"clients_max\":%lu,\"frames\":%lu,\"skipped\":%lu,"
+        "\"sent\":%lu,\"sent_bytes\":%llu,\"send_fail\":%lu,\"slow_drop\":%lu,\"tx_busy\":%lu,"
+        "\"rx\":%lu,\"rx_oversize\":%lu,"
+        "\"latency_p50_us\":%lu,\"latency_p90_us\":%lu,\"latency_p99_us\":%lu,\"latency_max_us\":%lu,"
+        "\"frames_alive_max\":%lu,\"frames_bytes_max\":%lu,"
+        "\"heap_free\":%lu,\"heap_min_free\":%lu}",
+        (unsigned long)st.clients, (unsigned long)st.clients_max, (unsigned long)st.frames, (unsigned long)st.skipped,
+        (unsigned long)st.sent, (unsigned long long)st.sent_bytes, (unsigned long)st.send_fail, (unsigned long)st.slow_drop, (unsigned long)st.tx_busy,
+        (unsigned long)st.rx, (unsigned long)st.rx_oversize,
+        (unsigned long)web_monitor_latency_percentile(&st, 50), (unsigned long)web_monitor_latency_percentile(&st, 90),
+        (unsigned long)web_monitor_latency_percentile(&st, 99), (unsigned long)st.latency_max_us,
+        (unsigned long)st.frames_alive_max, (unsigned long)st.frames_bytes_max,
+        (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size());
+    if(httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && strcmp(query, "reset=1") == 0)
+        web_monitor_reset_stats();
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, buf, len);
+}
 
 httpd_handle_t setup_websocket_server(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.close_fn = ws_close_fn;
+    config.send_wait_timeout = WS_SEND_TIMEOUT_S;
+    //静态文件服务使用通配符
+    config.uri_match_fn = httpd_uri_match_wildcard;
 
     httpd_uri_t uri_get = {
         .uri = "/",
@@ -153,27 +695,23 @@ httpd_handle_t setup_websocket_server(void)
         .is_websocket = true
         };
 
+    httpd_uri_t stats = {
+        .uri = "/stats",
+        .method = HTTP_GET,
+        .handler = stats_req_handler,
+        .user_ctx = NULL};
+
     if (httpd_start(&server, &config) == ESP_OK)
     {
-        httpd_register_uri_handler(server, &uri_get);
+        if(http_html)
+            httpd_register_uri_handler(server, &uri_get);
         httpd_register_uri_handler(server, &ws);
+        httpd_register_uri_handler(server, &stats);
     }
 
     return server;
 }
 
-/** esp定时器函数，定时发送数据到客户端
- * @param arg 用户参数
- * @return 无
-*/
-void send_server_data(void* arg)
-{
-    struct async_resp_arg *resp_arg = malloc(sizeof(struct async_resp_arg));
-    resp_arg->hd = server;
-    httpd_queue_work(server, ws_async_send, resp_arg);
-}
-
-
 /** 初始化ws
  * @param cfg ws一些配置,请看ws_cfg_t定义
  * @return  ESP_OK or ESP_FAIL
@@ -185,10 +723,34 @@ esp_err_t   web_monitor_init(ws_cfg_t *cfg)
     http_html = cfg->html_code;
     ws_receive_fn = cfg->receive_fn;
     ws_send_fn = cfg->send_fn;
+    ws_fields_fn = cfg->fields_fn;
+    if(cfg->coalesce_ms > 0)
+        s_coalesce_ms = cfg->coalesce_ms;
     setup_websocket_server();
-    #if 1
+
+    //数据变化时启动合并定时器，窗口内的多次变化只广播一次
+    const esp_timer_create_args_t notify_timer_args = {
+        .callback = ws_broadcast_timer_cb,
+        .name = "ws_notify",
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&notify_timer_args, &s_notify_timer));
+
+    //socket发送缓存满时的重试
+    const esp_timer_create_args_t retry_timer_args = {
+        .callback = ws_tx_retry_cb,
+        .name = "ws_retry",
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &s_retry_timer));
+
+    //周期检查一次，没有调用web_monitor_notify的数据变化也能推送出去，内容不变时不发送
     const esp_timer_create_args_t periodic_timer_args = {
-        .callback = send_server_data,
+        .callback = ws_broadcast_timer_cb,
         .name = "",
         .arg = NULL,
         .dispatch_method = ESP_TIMER_TASK,
@@ -198,6 +760,75 @@ esp_err_t   web_monitor_init(ws_cfg_t *cfg)
     esp_timer_handle_t periodic_timer;
     ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
     ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, cfg->intervel_ms * 1000ull));
-#endif
     return ESP_OK;
 }
+
+/** 通知数据已经变化，合并窗口结束后广播，可以在任意任务中调用
+ * @param 无
+ * @return 无
+*/
+void    web_monitor_notify(void)
+{
+    //定时器已经在运行时返回错误，正好合并到这一次
+    if(s_notify_timer)
+        esp_timer_start_once(s_notify_timer, s_coalesce_ms * 1000ull);
+}
+
+/** 获取广播统计
+ * @param stats 输出
+ * @return 无
+*/
+void    web_monitor_get_stats(ws_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_ws_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_ws_lock);
+}
+
+/** 从延迟直方图估计百分位
+ * @param stats 统计
+ * @param percent 百分位，例如 50、99
+ * @return 延迟(us)，为所在桶的上限，没有数据时返回0
+*/
+uint32_t    web_monitor_latency_percentile(const ws_stats_t *stats, int percent)
+{
+    uint64_t total = 0, sum = 0;
+    for(int i = 0;i < WS_LATENCY_BUCKETS;i++)
+        total += stats->latency_hist[i];
+    if(total == 0)
+        return 0;
+    for(int i = 0;i < WS_LATENCY_BUCKETS - 1;i++)
+    {
+        sum += stats->latency_hist[i];
+        if(sum * 100 >= total * percent)
+            return 2u << i;
+    }
+    return stats->latency_max_us;
+}
+
+/** 清零累计的统计，当前客户端个数保留，用于分段测量
+ * @param 无
+ * @return 无
+*/
+void    web_monitor_reset_stats(void)
+{
+    portENTER_CRITICAL(&s_ws_lock);
+    uint32_t clients = s_stats.clients;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.clients = clients;
+    s_stats.clients_max = clients;
+    s_stats.frames_alive_max = s_frames_alive;
+    s_stats.frames_bytes_max = s_frames_bytes;
+    portEXIT_CRITICAL(&s_ws_lock);
+}
+
+/** 注册额外的http接口，需要在web_monitor_init之后调用
+ * @param uri 接口定义
+ * @return  ESP_OK or ESP_FAIL
+*/
+esp_err_t   web_monitor_register_uri(const httpd_uri_t *uri)
+{
+    if(server == NULL || uri == NULL)
+        return ESP_FAIL;
+    return httpd_register_uri_handler(server, uri);
+}
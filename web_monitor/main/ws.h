@@ -1,25 +1,89 @@
 #ifndef _WS_H_
 #define _WS_H_
 #include "esp_err.h"
+#include "esp_http_server.h"
 
-//ws接收到的处理回调函数
+//ws接收到的处理回调函数，payload以'\0'结尾，回调返回前有效，可以原地修改
 typedef void(*ws_receive_cb)(uint8_t* payload,int len);
 
-//ws周期需要发送的函数数据
+//生成需要广播的数据，send_buf大小为256字节，len为数据长度
 typedef void(*ws_send_cb)(char* send_buf,int *len);
 
+//二进制帧的字段值，values的下标即字段ID，数值为定点整数，返回字段个数
+typedef int(*ws_fields_cb)(int32_t *values,int max);
+
+//客户端发送此文本切换到二进制帧，格式见ws_bin.h
+#define WS_PROTO_BIN    "proto:bin"
+
 typedef struct
 {
-    const char* html_code;              //当执行http访问时返回的html页面
+    const char* html_code;              //当执行http访问时返回的html页面，NULL表示不注册"/"(由静态文件服务提供)
     ws_receive_cb   receive_fn;         //当ws接收到数据时，调用此函数
-    ws_send_cb      send_fn;            //周期发送数据
-    int         intervel_ms;            //周期发送数据周期(需不小于1000ms)
+    ws_send_cb      send_fn;            //生成广播的数据
+    ws_fields_cb    fields_fn;          //二进制帧的字段，NULL表示不支持二进制帧
+    int         intervel_ms;            //周期检查数据的周期(需不小于1000ms)，内容不变时不发送
+    int         coalesce_ms;            //web_monitor_notify的合并窗口，0使用默认值50ms
 }ws_cfg_t;
 
+//广播延迟直方图的桶数，第i个桶为 [2^i, 2^(i+1)) us，最后一个桶包含更大的值
+#define WS_LATENCY_BUCKETS      20
+
+//广播统计
+typedef struct
+{
+    uint32_t    frames;                 //生成的帧数
+    uint32_t    skipped;                //内容没变化而跳过的次数
+    uint32_t    sent;                   //发送给客户端的帧数
+    uint32_t    send_fail;              //发送失败断开的客户端数
+    uint32_t    slow_drop;              //队列排满断开的客户端数
+    uint32_t    tx_busy;                //socket发送缓存满而推迟发送的次数
+    uint32_t    rx;                     //接收的帧数
+    uint32_t    rx_oversize;            //超长而断开的帧数
+    uint64_t    sent_bytes;             //发送给客户端的字节数
+    uint32_t    clients;                //当前客户端个数
+    uint32_t    clients_max;            //客户端个数的最大值
+    uint32_t    frames_alive_max;       //同时存在的帧个数的最大值
+    uint32_t    frames_bytes_max;       //同时存在的帧占用字节数的最大值
+    uint32_t    latency_max_us;         //帧生成到发送完成的最大延迟
+    uint32_t    latency_hist[WS_LATENCY_BUCKETS];   //帧生成到发送完成的延迟分布
+}ws_stats_t;
+
 /** 初始化ws
  * @param cfg ws一些配置,请看ws_cfg_t定义
  * @return  ESP_OK or ESP_FAIL
 */
 esp_err_t   web_monitor_init(ws_cfg_t *cfg);
 
+/** 注册额外的http接口，需要在web_monitor_init之后调用
+ * @param uri 接口定义
+ * @return  ESP_OK or ESP_FAIL
+*/
+esp_err_t   web_monitor_register_uri(const httpd_uri_t *uri);
+
+/** 通知数据已经变化，合并窗口结束后调用send_fn生成一帧广播给所有客户端
+ * 每个客户端有自己的发送队列，帧只生成一次由所有客户端共享，跟不上的客户端会被断开
+ * @param 无
+ * @return 无
+*/
+void    web_monitor_notify(void);
+
+/** 获取广播统计
+ * @param stats 输出
+ * @return 无
+*/
+void    web_monitor_get_stats(ws_stats_t *stats);
+
+/** 从延迟直方图估计百分位
+ * @param stats 统计
+ * @param percent 百分位，例如 50、99
+ * @return 延迟(us)，为所在桶的上限，没有数据时返回0
+*/
+uint32_t    web_monitor_latency_percentile(const ws_stats_t *stats, int percent);
+
+/** 清零累计的统计，当前客户端个数保留，用于分段测量
+ * @param 无
+ * @return 无
+*/
+void    web_monitor_reset_stats(void);
+
 #endif
@@ -0,0 +1,43 @@
+#include "ws_bin.h"
+
+/** 写入zig-zag变长整数，每字节7位，低位在前，最高位为1表示后面还有
+ * @param buf 输出
+ * @param v 数值
+ * @return 写入的字节数
+*/
+static int ws_bin_put_varint(uint8_t *buf, int32_t v)
+{
+    uint32_t zz = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    int len = 0;
+    while (zz >= 0x80)
+    {
+        buf[len++] = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    buf[len++] = (uint8_t)zz;
+    return len;
+}
+
+/** 编码一帧
+ * @param buf 输出，不小于 WS_BIN_FRAME_MAX
+ * @param seq 序号
+ * @param values 当前各字段的值，下标即字段ID
+ * @param prev 上一帧各字段的值，NULL表示编码关键帧
+ * @param num 字段个数，不超过 WS_BIN_MAX_FIELD
+ * @return 帧长度，差分帧没有变化的字段时只有2字节头
+*/
+int ws_bin_encode(uint8_t *buf, uint8_t seq, const int32_t *values, const int32_t *prev, int num)
+{
+    int len = 0;
+    buf[len++] = (WS_BIN_VERSION << 4) | (prev ? 0 : WS_BIN_FLAG_KEY);
+    buf[len++] = seq;
+    for (int i = 0; i < num && i < WS_BIN_MAX_FIELD; i++)
+    {
+        if (prev && values[i] == prev[i])
+            continue;
+        buf[len++] = (uint8_t)i;
+        //差值按32位回绕，客户端同样按32位相加
+        len += ws_bin_put_varint(&buf[len], prev ? (int32_t)((uint32_t)values[i] - (uint32_t)prev[i]) : values[i]);
+    }
+    return len;
+}
@@ -0,0 +1,31 @@
+#ifndef _WS_BIN_H_
+#define _WS_BIN_H_
+#include <stdint.h>
+
+/*
+ * 二进制遥测帧，代替JSON文本，客户端连接后发送 "proto:bin" 切换
+ *  [0]  版本(高4位) | 标志(低4位)，bit0=1 为关键帧
+ *  [1]  序号，每个差分帧加1，关键帧携带当前序号
+ *  之后是若干字段：[字段ID 1字节][zig-zag变长整数]
+ * 关键帧包含所有字段的绝对值；差分帧只包含变化的字段，数值是与上一帧的差
+ * 数值都是定点整数，例如温度X10，客户端按字段ID换算
+ * 客户端发现序号不连续时重新发送 "proto:bin" 请求关键帧
+ */
+
+#define WS_BIN_VERSION      1
+#define WS_BIN_FLAG_KEY     0x01
+#define WS_BIN_MAX_FIELD    16
+//一帧最大长度：2字节头 + 每个字段 1字节ID + 最多5字节数值
+#define WS_BIN_FRAME_MAX    (2 + WS_BIN_MAX_FIELD * 6)
+
+/** 编码一帧
+ * @param buf 输出，不小于 WS_BIN_FRAME_MAX
+ * @param seq 序号
+ * @param values 当前各字段的值，下标即字段ID
+ * @param prev 上一帧各字段的值，NULL表示编码关键帧
+ * @param num 字段个数，不超过 WS_BIN_MAX_FIELD
+ * @return 帧长度，差分帧没有变化的字段时只有2字节头
+*/
+int ws_bin_encode(uint8_t *buf, uint8_t seq, const int32_t *values, const int32_t *prev, int num);
+
+#endif
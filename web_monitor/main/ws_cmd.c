@@ -0,0 +1,86 @@
+#include <string.h>
+#include "ws_cmd.h"
+
+static inline int ws_cmd_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/** 解析并执行一条命令，line 会被修改
+ * @param table 命令表
+ * @param num 命令个数
+ * @param line 命令文本，line[len] 必须可写
+ * @param len 长度
+ * @return ESP_ERR_NOT_FOUND 没有此命令，ESP_ERR_INVALID_ARG 参数个数或长度不对，否则为处理函数的返回值
+*/
+esp_err_t ws_cmd_dispatch(const ws_cmd_t *table, int num, char *line, int len)
+{
+    char *argv[WS_CMD_MAX_ARGS + 1];
+    int argc = 0;
+    int i = 0;
+    line[len] = '\0';
+    //原地切分，分隔符改成'\0'
+    while (i < len)
+    {
+        while (i < len && ws_cmd_is_space(line[i]))
+            line[i++] = '\0';
+        if (i >= len)
+            break;
+        if (argc > WS_CMD_MAX_ARGS)
+            return ESP_ERR_INVALID_ARG;
+        int start = i;
+        while (i < len && !ws_cmd_is_space(line[i]) && line[i] != '\0')
+            i++;
+        if (i < len && line[i] == '\0')
+            return ESP_ERR_INVALID_ARG;
+        if (i - start > WS_CMD_ARG_MAX)
+            return ESP_ERR_INVALID_ARG;
+        argv[argc++] = &line[start];
+    }
+    if (argc == 0)
+        return ESP_ERR_NOT_FOUND;
+    for (int k = 0; k < num; k++)
+    {
+        if (strcmp(argv[0], table[k].name) != 0)
+            continue;
+        if (argc - 1 < table[k].min_args || argc - 1 > table[k].max_args)
+            return ESP_ERR_INVALID_ARG;
+        return table[k].fn(argc, argv);
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/** 解析十进制整数参数
+ * @param arg 参数
+ * @param min 最小值
+ * @param max 最大值
+ * @param out 输出
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t ws_cmd_parse_int(const char *arg, int32_t min, int32_t max, int32_t *out)
+{
+    int64_t v = 0;
+    int neg = 0;
+    if (*arg == '-')
+    {
+        neg = 1;
+        arg++;
+    }
+    if (*arg == '\0')
+        return ESP_ERR_INVALID_ARG;
+    //参数长度有限，不会溢出int64
+    for (; *arg; arg++)
+    {
+        if (*arg < '0' || *arg > '9')
+            return ESP_ERR_INVALID_ARG;
+        v = v * 10 + (*arg - '0');
+        if (v > (int64_t)INT32_MAX + 1)
+            return ESP_ERR_INVALID_ARG;
+    }
+    if (neg)
+        v = -v;
+    if (v < min || v > max)
+        return ESP_ERR_INVALID_ARG;
+    *out = (int32_t)v;
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+#ifndef _WS_CMD_H_
+#define _WS_CMD_H_
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * WebSocket文本命令解析："命令 参数1 参数2 ..."，空格分隔
+ * 在接收缓存上原地切分，不拷贝也不分配内存，按静态命令表分发
+ */
+
+#define WS_CMD_MAX_ARGS     4       //命令最多参数个数
+#define WS_CMD_ARG_MAX      32      //每个参数最大长度
+
+//命令处理函数，argv[0]为命令名，argv[1..argc-1]为参数
+typedef esp_err_t(*ws_cmd_fn)(int argc, char **argv);
+
+//命令表项
+typedef struct
+{
+    const char *name;       //命令名
+    uint8_t min_args;       //最少参数个数(不含命令名)
+    uint8_t max_args;       //最多参数个数(不含命令名)，不超过 WS_CMD_MAX_ARGS
+    ws_cmd_fn fn;           //处理函数
+}ws_cmd_t;
+
+/** 解析并执行一条命令，line 会被修改
+ * @param table 命令表
+ * @param num 命令个数
+ * @param line 命令文本，line[len] 必须可写
+ * @param len 长度
+ * @return ESP_ERR_NOT_FOUND 没有此命令，ESP_ERR_INVALID_ARG 参数个数或长度不对，否则为处理函数的返回值
+*/
+esp_err_t ws_cmd_dispatch(const ws_cmd_t *table, int num, char *line, int len);
+
+/** 解析十进制整数参数
+ * @param arg 参数
+ * @param min 最小值
+ * @param max 最大值
+ * @param out 输出
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+*/
+esp_err_t ws_cmd_parse_int(const char *arg, int32_t min, int32_t max, int32_t *out);
+
+#endif
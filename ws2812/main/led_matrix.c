@@ -0,0 +1,332 @@
+/*
+ * WS2812 点阵屏
+ *
+ * 灯带驱动只认线性索引，而点阵面板的走线通常是蛇形的，多块面板拼接、旋转安装后更复杂。
+ * 这里在初始化时把 (x,y) -> 灯带索引 的映射一次性算好存成查找表，
+ * 所有绘图操作都通过查表直接写到按灯带顺序排列的画布上，推送时只需一次 memcpy 加一次发送。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "led_matrix.h"
+
+static const char *TAG = "led_matrix";
+
+/* 点阵描述符 */
+struct LedMatrix_t
+{
+    Ws2812MultiHandle_t xStrip; // 所在的多灯带控制器
+    uint32_t ulBaseIndex;       // 在灯带帧缓存中的起始索引
+    uint16_t usWidth;           // 旋转后的逻辑宽度
+    uint16_t usHeight;          // 旋转后的逻辑高度
+    uint16_t *pusLut;           // 查找表，下标 y * usWidth + x，值为点阵内的灯带顺序索引
+    uint8_t *pcCanvas;          // 画布，按灯带顺序排列，GRB 每点 3 字节
+};
+
+/* 5x8 ASCII 字库（0x20 ~ 0x7E），每个字符 5 列，每列一个字节，低位在上 */
+static const uint8_t s_ucFont5x8[][LED_MATRIX_FONT_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14}, // ' ' ! " #
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, // $ % & '
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ( ) * +
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02}, // , - . /
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, // 0 1 2 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07}, // 4 5 6 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00}, {0x00, 0x40, 0x34, 0x00, 0x00}, // 8 9 : ;
+    {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, // < = > ?
+    {0x3E, 0x41, 0x5D, 0x59, 0x4E}, {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // @ A B C
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x41, 0x51, 0x73}, // D E F G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, // H I J K
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // L M N O
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x26, 0x49, 0x49, 0x49, 0x32}, // P Q R S
+    {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, // T U V W
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41}, // X Y Z [
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40}, // \ ] ^ _
+    {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40}, {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, // ` a b c
+    {0x38, 0x44, 0x44, 0x28, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78}, // d e f g
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00}, // h i j k
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, // l m n o
+    {0xFC, 0x18, 0x24, 0x24, 0x18}, {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24}, // p q r s
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C}, // t u v w
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, // x y z {
+    {0x00, 0x00, 0x77, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},                                  // | } ~
+};
+
+/** 计算某个逻辑坐标对应的灯带顺序索引，只在初始化建表时调用
+ * @param pxConfig 布局配置
+ * @param ulCols,ulRows 横向、纵向面板块数
+ * @param x,y 旋转后的逻辑坐标
+ * @return 点阵内的灯带顺序索引
+ */
+static uint32_t prvLedMatrixMap(const LedMatrixConfig_t *pxConfig, uint32_t ulCols, uint32_t ulRows, uint32_t x, uint32_t y)
+{
+    uint32_t ulPanelW = pxConfig->usPanelWidth;
+    uint32_t ulPanelH = pxConfig->usPanelHeight;
+    uint32_t ulTotalW = ulPanelW * ulCols;
+    uint32_t ulTotalH = ulPanelH * ulRows;
+    uint32_t px, py;
+
+    /* 1、逻辑坐标反旋转到物理坐标 */
+    switch (pxConfig->xRotate){
+    case LED_MATRIX_ROTATE_90:
+        px = y;
+        py = ulTotalH - 1 - x;
+        break;
+    case LED_MATRIX_ROTATE_180:
+        px = ulTotalW - 1 - x;
+        py = ulTotalH - 1 - y;
+        break;
+    case LED_MATRIX_ROTATE_270:
+        px = ulTotalW - 1 - y;
+        py = x;
+        break;
+    default:
+        px = x;
+        py = y;
+        break;
+    }
+
+    /* 2、确定所在面板及面板内坐标 */
+    uint32_t ulTileX = px / ulPanelW;
+    uint32_t ulTileY = py / ulPanelH;
+    uint32_t lx = px % ulPanelW;
+    uint32_t ly = py % ulPanelH;
+    if (pxConfig->ucTileSerpentine && (ulTileY & 1))
+        ulTileX = ulCols - 1 - ulTileX;
+    uint32_t ulTile = ulTileY * ulCols + ulTileX;
+
+    /* 3、面板内走线 */
+    uint32_t ulLocal;
+    if (pxConfig->ucColumnMajor){
+        if (pxConfig->ucSerpentine && (lx & 1))
+            ly = ulPanelH - 1 - ly;
+        ulLocal = lx * ulPanelH + ly;
+    } else {
+        if (pxConfig->ucSerpentine && (ly & 1))
+            lx = ulPanelW - 1 - lx;
+        ulLocal = ly * ulPanelW + lx;
+    }
+    return ulTile * ulPanelW * ulPanelH + ulLocal;
+}
+
+/** 创建点阵并建立查找表
+ * @param xStrip 多灯带控制器句柄
+ * @param pxConfig 布局配置
+ * @param pxHandle 返回的点阵句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedMatrixInit(Ws2812MultiHandle_t xStrip, const LedMatrixConfig_t *pxConfig, LedMatrixHandle_t *pxHandle)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(xStrip && pxConfig && pxHandle, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(pxConfig->usPanelWidth && pxConfig->usPanelHeight, ESP_ERR_INVALID_ARG, TAG, "invalid panel size");
+
+    uint32_t ulCols = pxConfig->ucPanelCols ? pxConfig->ucPanelCols : 1;
+    uint32_t ulRows = pxConfig->ucPanelRows ? pxConfig->ucPanelRows : 1;
+    uint32_t ulTotalW = pxConfig->usPanelWidth * ulCols;
+    uint32_t ulTotalH = pxConfig->usPanelHeight * ulRows;
+    uint32_t ulCount = ulTotalW * ulTotalH;
+    ESP_RETURN_ON_FALSE(ulCount <= UINT16_MAX && ulTotalW <= UINT16_MAX && ulTotalH <= UINT16_MAX, ESP_ERR_INVALID_SIZE, TAG, "matrix too large");
+    ESP_RETURN_ON_FALSE(pxConfig->ulBaseIndex + ulCount <= ulWs2812MultiGetLedNum(xStrip), ESP_ERR_INVALID_SIZE, TAG, "matrix exceeds strip length");
+
+    struct LedMatrix_t *pxMatrix = calloc(1, sizeof(struct LedMatrix_t));
+    ESP_RETURN_ON_FALSE(pxMatrix, ESP_ERR_NO_MEM, TAG, "no mem for matrix");
+    pxMatrix->xStrip = xStrip;
+    pxMatrix->ulBaseIndex = pxConfig->ulBaseIndex;
+    /* 旋转 90/270 度后宽高互换 */
+    if (pxConfig->xRotate == LED_MATRIX_ROTATE_90 || pxConfig->xRotate == LED_MATRIX_ROTATE_270){
+        pxMatrix->usWidth = ulTotalH;
+        pxMatrix->usHeight = ulTotalW;
+    } else {
+        pxMatrix->usWidth = ulTotalW;
+        pxMatrix->usHeight = ulTotalH;
+    }
+    pxMatrix->pusLut = malloc(ulCount * sizeof(uint16_t));
+    ESP_GOTO_ON_FALSE(pxMatrix->pusLut, ESP_ERR_NO_MEM, err, TAG, "no mem for lut");
+    pxMatrix->pcCanvas = calloc(1, ulCount * 3);
+    ESP_GOTO_ON_FALSE(pxMatrix->pcCanvas, ESP_ERR_NO_MEM, err, TAG, "no mem for canvas");
+
+    /* 建表，之后的绘图操作都只查表，不再计算布局 */
+    for (uint32_t y = 0; y < pxMatrix->usHeight; y++){
+        for (uint32_t x = 0; x < pxMatrix->usWidth; x++){
+            pxMatrix->pusLut[y * pxMatrix->usWidth + x] = prvLedMatrixMap(pxConfig, ulCols, ulRows, x, y);
+        }
+    }
+
+    *pxHandle = pxMatrix;
+    return ESP_OK;
+err:
+    if (pxMatrix->pusLut)
+        free(pxMatrix->pusLut);
+    free(pxMatrix);
+    return ret;
+}
+
+/** 释放点阵
+ * @param xHandle 点阵句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedMatrixDeinit(LedMatrixHandle_t xHandle)
+{
+    if (!xHandle)
+        return ESP_OK;
+    free(xHandle->pusLut);
+    free(xHandle->pcCanvas);
+    free(xHandle);
+    return ESP_OK;
+}
+
+/** 获取旋转后的逻辑宽高
+ * @param xHandle 点阵句柄
+ * @param pusWidth,pusHeight 返回的宽高
+ * @return 无
+ */
+void vLedMatrixGetSize(LedMatrixHandle_t xHandle, uint16_t *pusWidth, uint16_t *pusHeight)
+{
+    if (pusWidth)
+        *pusWidth = xHandle->usWidth;
+    if (pusHeight)
+        *pusHeight = xHandle->usHeight;
+}
+
+/** 整屏填充同一颜色
+ * @param xHandle 点阵句柄
+ * @param r,g,b RGB 数据
+ * @return 无
+ */
+void vLedMatrixFill(LedMatrixHandle_t xHandle, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint32_t ulCount = (uint32_t)xHandle->usWidth * xHandle->usHeight;
+    if (r == g && g == b){
+        memset(xHandle->pcCanvas, r, ulCount * 3);
+        return;
+    }
+    /* 填充与布局无关，直接按画布顺序写 */
+    uint8_t *pcPixel = xHandle->pcCanvas;
+    for (uint32_t i = 0; i < ulCount; i++, pcPixel += 3){
+        pcPixel[0] = g; // WS2812 的数据顺序是 GRB
+        pcPixel[1] = r;
+        pcPixel[2] = b;
+    }
+}
+
+/** 设置某个点的颜色
+ * @param xHandle 点阵句柄
+ * @param x,y 逻辑坐标
+ * @param r,g,b RGB 数据
+ * @return 无
+ */
+void vLedMatrixSetPixel(LedMatrixHandle_t xHandle, int x, int y, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (x < 0 || y < 0 || x >= xHandle->usWidth || y >= xHandle->usHeight)
+        return;
+    uint8_t *pcPixel = &xHandle->pcCanvas[xHandle->pusLut[y * xHandle->usWidth + x] * 3];
+    pcPixel[0] = g;
+    pcPixel[1] = r;
+    pcPixel[2] = b;
+}
+
+/** 把一块 RGB888 位图拷贝到点阵上
+ * @param xHandle 点阵句柄
+ * @param x,y 左上角逻辑坐标
+ * @param usWidth,usHeight 位图宽高
+ * @param pcRgb 位图数据
+ * @return 无
+ */
+void vLedMatrixBlit(LedMatrixHandle_t xHandle, int x, int y, uint16_t usWidth, uint16_t usHeight, const uint8_t *pcRgb)
+{
+    /* 先算出裁剪后的区域，循环内不再做边界判断 */
+    int iX0 = x < 0 ? -x : 0;
+    int iY0 = y < 0 ? -y : 0;
+    int iX1 = x + usWidth > xHandle->usWidth ? xHandle->usWidth - x : usWidth;
+    int iY1 = y + usHeight > xHandle->usHeight ? xHandle->usHeight - y : usHeight;
+
+    for (int j = iY0; j < iY1; j++){
+        const uint8_t *pcSrc = &pcRgb[(j * usWidth + iX0) * 3];
+        const uint16_t *pusRow = &xHandle->pusLut[(y + j) * xHandle->usWidth];
+        for (int i = iX0; i < iX1; i++, pcSrc += 3){
+            uint8_t *pcPixel = &xHandle->pcCanvas[pusRow[x + i] * 3];
+            pcPixel[0] = pcSrc[1];
+            pcPixel[1] = pcSrc[0];
+            pcPixel[2] = pcSrc[2];
+        }
+    }
+}
+
+/** 整屏平移
+ * @param xHandle 点阵句柄
+ * @param iDx 向右平移的点数（负数向左）
+ * @param iDy 向下平移的点数（负数向上）
+ * @return 无
+ */
+void vLedMatrixScroll(LedMatrixHandle_t xHandle, int iDx, int iDy)
+{
+    int iW = xHandle->usWidth;
+    int iH = xHandle->usHeight;
+    /* 按平移方向反向遍历，源点总是在被覆盖之前读取，不需要额外的缓存 */
+    int iYStart = iDy > 0 ? iH - 1 : 0;
+    int iYStep = iDy > 0 ? -1 : 1;
+    int iXStart = iDx > 0 ? iW - 1 : 0;
+    int iXStep = iDx > 0 ? -1 : 1;
+
+    for (int n = 0, y = iYStart; n < iH; n++, y += iYStep){
+        int iSrcY = y - iDy;
+        for (int m = 0, x = iXStart; m < iW; m++, x += iXStep){
+            int iSrcX = x - iDx;
+            uint8_t *pcDst = &xHandle->pcCanvas[xHandle->pusLut[y * iW + x] * 3];
+            if (iSrcX < 0 || iSrcY < 0 || iSrcX >= iW || iSrcY >= iH){
+                pcDst[0] = pcDst[1] = pcDst[2] = 0;
+            } else {
+                const uint8_t *pcSrc = &xHandle->pcCanvas[xHandle->pusLut[iSrcY * iW + iSrcX] * 3];
+                pcDst[0] = pcSrc[0];
+                pcDst[1] = pcSrc[1];
+                pcDst[2] = pcSrc[2];
+            }
+        }
+    }
+}
+
+/** 用内置字库绘制 ASCII 字符串
+ * @param xHandle 点阵句柄
+ * @param x,y 左上角逻辑坐标
+ * @param pcText 字符串
+ * @param r,g,b RGB 数据
+ * @return 字符串结束处的 x 坐标
+ */
+int iLedMatrixDrawText(LedMatrixHandle_t xHandle, int x, int y, const char *pcText, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (; *pcText; pcText++){
+        char c = *pcText;
+        if (c < 0x20 || c > 0x7E)
+            c = '?';
+        /* 整个字符都在屏幕外时跳过 */
+        if (x + LED_MATRIX_FONT_WIDTH > 0 && x < xHandle->usWidth){
+            const uint8_t *pcGlyph = s_ucFont5x8[c - 0x20];
+            for (int i = 0; i < LED_MATRIX_FONT_WIDTH; i++){
+                uint8_t ucColumn = pcGlyph[i];
+                for (int j = 0; ucColumn; j++, ucColumn >>= 1){
+                    if (ucColumn & 1)
+                        vLedMatrixSetPixel(xHandle, x + i, y + j, r, g, b);
+                }
+            }
+        }
+        x += LED_MATRIX_FONT_WIDTH + 1; // 字间距 1 列
+    }
+    return x;
+}
+
+/** 把当前画面推送到灯带
+ * @param xHandle 点阵句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xLedMatrixPush(LedMatrixHandle_t xHandle)
+{
+    if (!xHandle)
+        return ESP_FAIL;
+    // 关键：等待上一帧发送完成再覆盖灯带帧缓存，避免画面撕裂
+    ESP_RETURN_ON_ERROR(xWs2812MultiWaitDone(xHandle->xStrip, 50), TAG, "previous frame not done");
+    /* 画布已经是灯带顺序，整块拷贝即可 */
+    memcpy(pcWs2812MultiGetBuffer(xHandle->xStrip) + xHandle->ulBaseIndex * 3, xHandle->pcCanvas,
+           (uint32_t)xHandle->usWidth * xHandle->usHeight * 3);
+    return xWs2812MultiRefresh(xHandle->xStrip);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_ws2812_multi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_MATRIX_FONT_WIDTH 5  // 内置字库字宽
+#define LED_MATRIX_FONT_HEIGHT 8 // 内置字库字高（含下行笔画）
+
+/* 整体旋转角度（顺时针） */
+typedef enum
+{
+    LED_MATRIX_ROTATE_0 = 0,
+    LED_MATRIX_ROTATE_90,
+    LED_MATRIX_ROTATE_180,
+    LED_MATRIX_ROTATE_270,
+} LedMatrixRotate_t;
+
+/* 点阵布局配置，物理走线为：面板按行依次串联，面板内按行（或按列）依次串联 */
+typedef struct
+{
+    uint16_t usPanelWidth;     // 单块面板宽度（LED 个数）
+    uint16_t usPanelHeight;    // 单块面板高度（LED 个数）
+    uint8_t ucPanelCols;       // 横向面板块数，0 视为 1
+    uint8_t ucPanelRows;       // 纵向面板块数，0 视为 1
+    uint8_t ucSerpentine;      // 面板内蛇形走线：奇数行（列）反向
+    uint8_t ucColumnMajor;     // 面板内按列走线
+    uint8_t ucTileSerpentine;  // 面板之间蛇形串联：奇数面板行从右往左
+    LedMatrixRotate_t xRotate; // 整体旋转角度
+    uint32_t ulBaseIndex;      // 点阵第一个 LED 在多灯带逻辑帧缓存中的索引
+} LedMatrixConfig_t;
+
+typedef struct LedMatrix_t *LedMatrixHandle_t;
+
+/** 在多灯带帧缓存之上创建点阵，初始化时一次性计算 (x,y) -> 灯带索引 的查找表
+ * @param xStrip 多灯带控制器句柄
+ * @param pxConfig 布局配置
+ * @param pxHandle 返回的点阵句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedMatrixInit(Ws2812MultiHandle_t xStrip, const LedMatrixConfig_t *pxConfig, LedMatrixHandle_t *pxHandle);
+
+/** 释放点阵
+ * @param xHandle 点阵句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedMatrixDeinit(LedMatrixHandle_t xHandle);
+
+/** 获取旋转后的逻辑宽高
+ * @param xHandle 点阵句柄
+ * @param pusWidth,pusHeight 返回的宽高
+ * @return 无
+*/
+void vLedMatrixGetSize(LedMatrixHandle_t xHandle, uint16_t *pusWidth, uint16_t *pusHeight);
+
+/** 整屏填充同一颜色
+ * @param xHandle 点阵句柄
+ * @param r,g,b RGB 数据
+ * @return 无
+*/
+void vLedMatrixFill(LedMatrixHandle_t xHandle, uint8_t r, uint8_t g, uint8_t b);
+
+/** 设置某个点的颜色，越界的点直接忽略
+ * @param xHandle 点阵句柄
+ * @param x,y 逻辑坐标
+ * @param r,g,b RGB 数据
+ * @return 无
+*/
+void vLedMatrixSetPixel(LedMatrixHandle_t xHandle, int x, int y, uint8_t r, uint8_t g, uint8_t b);
+
+/** 把一块 RGB888 位图拷贝到点阵上，超出部分裁剪
+ * @param xHandle 点阵句柄
+ * @param x,y 左上角逻辑坐标
+ * @param usWidth,usHeight 位图宽高
+ * @param pcRgb 位图数据，按行存放，每点 3 字节 RGB
+ * @return 无
+*/
+void vLedMatrixBlit(LedMatrixHandle_t xHandle, int x, int y, uint16_t usWidth, uint16_t usHeight, const uint8_t *pcRgb);
+
+/** 整屏平移，移出的内容丢弃，空出的位置填黑
+ * @param xHandle 点阵句柄
+ * @param iDx 向右平移的点数（负数向左）
+ * @param iDy 向下平移的点数（负数向上）
+ * @return 无
+*/
+void vLedMatrixScroll(LedMatrixHandle_t xHandle, int iDx, int iDy);
+
+/** 用内置 5x8 点阵字库绘制 ASCII 字符串，背景透明
+ * @param xHandle 点阵句柄
+ * @param x,y 左上角逻辑坐标，可以为负数（用于滚动字幕）
+ * @param pcText 字符串
+ * @param r,g,b RGB 数据
+ * @return 字符串结束处的 x 坐标
+*/
+int iLedMatrixDrawText(LedMatrixHandle_t xHandle, int x, int y, const char *pcText, uint8_t r, uint8_t g, uint8_t b);
+
+/** 把当前画面推送到灯带：一次 memcpy 到灯带帧缓存，再一次并行发送
+ * @param xHandle 点阵句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xLedMatrixPush(LedMatrixHandle_t xHandle);
+
+#ifdef __cplusplus
+}
+#endif
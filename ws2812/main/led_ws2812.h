@@ -37,6 +37,12 @@ esp_err_t xWs2812Deinit(Ws2812StripHandle_t xHandle);
 */
 esp_err_t xWs2812Write(Ws2812StripHandle_t xHandle, uint32_t ulIndex, uint32_t r, uint32_t g, uint32_t b);
 
+/** 创建一个基于 WS2812 时序的编码器（多灯带控制器也会用到）
+ * @param pxRetEncoder 返回的编码器，这个编码器在使用 rmt_transmit 函数传输时会用到
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xRmtNewLedStripEncoder(rmt_encoder_handle_t *pxRetEncoder);
+
 
 #ifdef __cplusplus
 }
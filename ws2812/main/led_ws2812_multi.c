@@ -0,0 +1,251 @@
+/*
+ * 多灯带 WS2812 控制器
+ *
+ * xWs2812Init 每条灯带一个句柄，多条灯带只能依次调用 xWs2812Write，刷新时间是各灯带之和。
+ * 这里把多条灯带分配到不同的 RMT TX 通道上，共用一块连续的逻辑帧缓存：
+    1、每条灯带在帧缓存中占一段连续区域，rmt_transmit 直接发送该区域，无需拷贝
+    2、所有通道的发送请求一次性下发，RMT 后台并行输出
+    3、芯片支持 RMT 同步管理器（SOC_RMT_SUPPORT_TX_SYNCHRO）时，所有通道同时起跳
+ * 因此 N 条灯带的刷新时间约等于最长那条灯带的时间，而不是 N 条之和。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "soc/soc_caps.h"
+#include "driver/rmt_tx.h"
+#include "led_ws2812.h"
+#include "led_ws2812_multi.h"
+
+static const char *TAG = "ws2812_multi";
+
+#define LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz 分辨率，与 led_ws2812.c 保持一致
+
+/* 单条灯带的运行信息 */
+typedef struct
+{
+    rmt_channel_handle_t xLedChan;    // rmt 通道
+    rmt_encoder_handle_t xLedEncoder; // rmt 编码器，每个通道独立一个，编码状态互不干扰
+    uint32_t ulStart;                 // 在逻辑帧缓存中的起始 LED 索引
+    uint32_t ulLedNum;                // LED 个数
+} Ws2812MultiStrip_t;
+
+/* 多灯带控制器描述符 */
+struct Ws2812Multi_t
+{
+    Ws2812MultiStrip_t xStrips[WS2812_MULTI_MAX_STRIP]; // 灯带列表
+    uint32_t ulStripNum;                                // 灯带条数
+    uint32_t ulLedNum;                                  // LED 总数
+    uint8_t *pcLedBuffer;                               // 逻辑帧缓存，GRB 顺序
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    rmt_sync_manager_handle_t xSync; // 同步管理器，让所有通道同时开始发送
+#endif
+};
+
+/** 释放控制器占用的所有资源
+ * @param pxMulti 控制器
+ * @return 无
+ */
+static void prvWs2812MultiFree(struct Ws2812Multi_t *pxMulti)
+{
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    if (pxMulti->xSync)
+        rmt_del_sync_manager(pxMulti->xSync);
+#endif
+    for (uint32_t i = 0; i < pxMulti->ulStripNum; i++){
+        Ws2812MultiStrip_t *pxStrip = &pxMulti->xStrips[i];
+        if (pxStrip->xLedChan){
+            rmt_disable(pxStrip->xLedChan);
+            rmt_del_channel(pxStrip->xLedChan);
+        }
+        if (pxStrip->xLedEncoder)
+            rmt_del_encoder(pxStrip->xLedEncoder);
+    }
+    if (pxMulti->pcLedBuffer)
+        free(pxMulti->pcLedBuffer);
+    free(pxMulti);
+}
+
+/** 初始化多灯带控制器
+ * @param pxStrips 灯带配置数组
+ * @param ulStripNum 灯带条数
+ * @param pxHandle 返回的控制句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xWs2812MultiInit(const Ws2812StripConfig_t *pxStrips, uint32_t ulStripNum, Ws2812MultiHandle_t *pxHandle)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_channel_handle_t xChans[WS2812_MULTI_MAX_STRIP] = {0};
+    ESP_RETURN_ON_FALSE(pxStrips && pxHandle, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(ulStripNum > 0 && ulStripNum <= WS2812_MULTI_MAX_STRIP, ESP_ERR_INVALID_ARG, TAG, "invalid strip num");
+
+    struct Ws2812Multi_t *pxMulti = calloc(1, sizeof(struct Ws2812Multi_t));
+    ESP_RETURN_ON_FALSE(pxMulti, ESP_ERR_NO_MEM, TAG, "no mem for multi strip");
+
+    /* 计算每条灯带在逻辑帧缓存中的位置 */
+    for (uint32_t i = 0; i < ulStripNum; i++){
+        ESP_GOTO_ON_FALSE(pxStrips[i].ulLedNum > 0, ESP_ERR_INVALID_ARG, err, TAG, "strip %lu is empty", i);
+        pxMulti->xStrips[i].ulStart = pxMulti->ulLedNum;
+        pxMulti->xStrips[i].ulLedNum = pxStrips[i].ulLedNum;
+        pxMulti->ulLedNum += pxStrips[i].ulLedNum;
+    }
+    /* 所有灯带共用一块连续的帧缓存 */
+    pxMulti->pcLedBuffer = calloc(1, pxMulti->ulLedNum * 3);
+    ESP_GOTO_ON_FALSE(pxMulti->pcLedBuffer, ESP_ERR_NO_MEM, err, TAG, "no mem for led buffer");
+
+    for (uint32_t i = 0; i < ulStripNum; i++){
+        Ws2812MultiStrip_t *pxStrip = &pxMulti->xStrips[i];
+        /* 每个通道只占一个内存块，这样芯片上所有的 TX 通道都能分配给灯带 */
+        rmt_tx_channel_config_t xTxChannelConfig = {
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .gpio_num = pxStrips[i].xGpio,
+            .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+            .resolution_hz = LED_STRIP_RESOLUTION_HZ,
+            .trans_queue_depth = 4,
+        };
+        ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&xTxChannelConfig, &pxStrip->xLedChan), err, TAG, "no free rmt tx channel for strip %lu", i);
+        pxMulti->ulStripNum = i + 1; // 记录已创建的通道数，出错时按此释放
+        ESP_GOTO_ON_ERROR(xRmtNewLedStripEncoder(&pxStrip->xLedEncoder), err, TAG, "create encoder failed");
+        ESP_GOTO_ON_ERROR(rmt_enable(pxStrip->xLedChan), err, TAG, "enable channel failed");
+        xChans[i] = pxStrip->xLedChan;
+    }
+
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    /* 多于一条灯带时创建同步管理器，所有通道都调用 rmt_transmit 后才会同时开始发送 */
+    if (ulStripNum > 1){
+        rmt_sync_manager_config_t xSyncConfig = {
+            .tx_channel_array = xChans,
+            .array_size = ulStripNum,
+        };
+        ESP_GOTO_ON_ERROR(rmt_new_sync_manager(&xSyncConfig, &pxMulti->xSync), err, TAG, "create sync manager failed");
+    }
+#endif
+
+    ESP_LOGI(TAG, "%lu strips, %lu leds", ulStripNum, pxMulti->ulLedNum);
+    *pxHandle = pxMulti;
+    return ESP_OK;
+err:
+    prvWs2812MultiFree(pxMulti);
+    return ret;
+}
+
+/** 反初始化多灯带控制器
+ * @param xHandle 初始化的句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xWs2812MultiDeinit(Ws2812MultiHandle_t xHandle)
+{
+    if (!xHandle)
+        return ESP_OK;
+    xWs2812MultiWaitDone(xHandle, -1);
+    prvWs2812MultiFree(xHandle);
+    return ESP_OK;
+}
+
+/** 向逻辑帧缓存写入某个 LED 的 RGB 数据
+ * @param xHandle 句柄
+ * @param ulIndex 逻辑索引（0开始）
+ * @param r,g,b RGB 数据
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xWs2812MultiSetPixel(Ws2812MultiHandle_t xHandle, uint32_t ulIndex, uint32_t r, uint32_t g, uint32_t b)
+{
+    if (!xHandle || ulIndex >= xHandle->ulLedNum)
+        return ESP_FAIL;
+    /* 帧缓存是连续的，逻辑索引直接对应字节偏移，不需要查找灯带 */
+    uint8_t *pcPixel = &xHandle->pcLedBuffer[ulIndex * 3];
+    pcPixel[0] = g & 0xff; // WS2812 的数据顺序是 GRB
+    pcPixel[1] = r & 0xff;
+    pcPixel[2] = b & 0xff;
+    return ESP_OK;
+}
+
+/** 等待上一次刷新全部发送完成
+ * @param xHandle 句柄
+ * @param iTimeoutMs 超时时间（ms），-1 表示一直等待
+ * @return ESP_OK or ESP_ERR_TIMEOUT
+ */
+esp_err_t xWs2812MultiWaitDone(Ws2812MultiHandle_t xHandle, int iTimeoutMs)
+{
+    if (!xHandle)
+        return ESP_FAIL;
+    /* 各通道并行发送，依次等待的总时间仍然只是最长那条灯带的时间 */
+    for (uint32_t i = 0; i < xHandle->ulStripNum; i++){
+        esp_err_t ret = rmt_tx_wait_all_done(xHandle->xStrips[i].xLedChan, iTimeoutMs);
+        if (ret != ESP_OK)
+            return ret;
+    }
+    return ESP_OK;
+}
+
+/** 把整块逻辑帧缓存同时发送到所有灯带
+ * @param xHandle 句柄
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xWs2812MultiRefresh(Ws2812MultiHandle_t xHandle)
+{
+    if (!xHandle)
+        return ESP_FAIL;
+    // 关键：等待上一帧全部发送完成，否则 RMT 还在读取帧缓存
+    ESP_RETURN_ON_ERROR(xWs2812MultiWaitDone(xHandle, 50), TAG, "previous frame not done");
+
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    /* 各灯带长度不同，上一帧结束时间不一致，重新同步后再下发 */
+    if (xHandle->xSync)
+        ESP_RETURN_ON_ERROR(rmt_sync_reset(xHandle->xSync), TAG, "sync reset failed");
+#endif
+
+    rmt_transmit_config_t xTxConfig = {
+        .loop_count = 0, // 不循环发送
+    };
+    for (uint32_t i = 0; i < xHandle->ulStripNum; i++){
+        Ws2812MultiStrip_t *pxStrip = &xHandle->xStrips[i];
+        /* 直接发送帧缓存中属于该灯带的一段，rmt_transmit 不阻塞，通道在后台并行输出 */
+        ESP_RETURN_ON_ERROR(rmt_transmit(pxStrip->xLedChan, pxStrip->xLedEncoder, &xHandle->pcLedBuffer[pxStrip->ulStart * 3],
+                                         pxStrip->ulLedNum * 3, &xTxConfig),
+                            TAG, "strip %lu transmit failed", i);
+    }
+    return ESP_OK;
+}
+
+/** 逻辑索引转换为（灯带号, 灯带内偏移）
+ * @param xHandle 句柄
+ * @param ulIndex 逻辑索引
+ * @param pulStrip 返回的灯带号
+ * @param pulOffset 返回的灯带内偏移
+ * @return ESP_OK or ESP_FAIL
+ */
+esp_err_t xWs2812MultiLocate(Ws2812MultiHandle_t xHandle, uint32_t ulIndex, uint32_t *pulStrip, uint32_t *pulOffset)
+{
+    if (!xHandle || ulIndex >= xHandle->ulLedNum)
+        return ESP_FAIL;
+    for (uint32_t i = 0; i < xHandle->ulStripNum; i++){
+        const Ws2812MultiStrip_t *pxStrip = &xHandle->xStrips[i];
+        if (ulIndex < pxStrip->ulStart + pxStrip->ulLedNum){
+            if (pulStrip)
+                *pulStrip = i;
+            if (pulOffset)
+                *pulOffset = ulIndex - pxStrip->ulStart;
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+/** 获取逻辑帧缓存
+ * @param xHandle 句柄
+ * @return 帧缓存首地址
+ */
+uint8_t *pcWs2812MultiGetBuffer(Ws2812MultiHandle_t xHandle)
+{
+    return xHandle ? xHandle->pcLedBuffer : NULL;
+}
+
+/** 获取所有灯带的 LED 总数
+ * @param xHandle 句柄
+ * @return LED 总数
+ */
+uint32_t ulWs2812MultiGetLedNum(Ws2812MultiHandle_t xHandle)
+{
+    return xHandle ? xHandle->ulLedNum : 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WS2812_MULTI_MAX_STRIP 8 // 最多支持的灯带数，实际可用数量受芯片 RMT TX 通道数限制
+
+/* 单条灯带的配置 */
+typedef struct
+{
+    gpio_num_t xGpio;  // 控制该灯带的管脚
+    uint32_t ulLedNum; // 该灯带的 LED 个数
+} Ws2812StripConfig_t;
+
+typedef struct Ws2812Multi_t *Ws2812MultiHandle_t;
+
+/** 初始化多灯带控制器，每条灯带占用一个 RMT TX 通道，所有灯带共用一块逻辑帧缓存
+ * 逻辑索引按配置顺序依次排列：第 0 条灯带占 [0, n0)，第 1 条占 [n0, n0+n1)，以此类推
+ * @param pxStrips 灯带配置数组
+ * @param ulStripNum 灯带条数
+ * @param pxHandle 返回的控制句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xWs2812MultiInit(const Ws2812StripConfig_t *pxStrips, uint32_t ulStripNum, Ws2812MultiHandle_t *pxHandle);
+
+/** 反初始化多灯带控制器
+ * @param xHandle 初始化的句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xWs2812MultiDeinit(Ws2812MultiHandle_t xHandle);
+
+/** 向逻辑帧缓存写入某个 LED 的 RGB 数据（只写缓存，不发送）
+ * @param xHandle 句柄
+ * @param ulIndex 逻辑索引（0开始）
+ * @param r,g,b RGB 数据
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xWs2812MultiSetPixel(Ws2812MultiHandle_t xHandle, uint32_t ulIndex, uint32_t r, uint32_t g, uint32_t b);
+
+/** 把整块逻辑帧缓存同时发送到所有灯带
+ * 支持 RMT 同步管理器的芯片上所有通道同时起跳，刷新时间约等于最长灯带的时间
+ * @param xHandle 句柄
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xWs2812MultiRefresh(Ws2812MultiHandle_t xHandle);
+
+/** 等待上一次刷新全部发送完成
+ * @param xHandle 句柄
+ * @param iTimeoutMs 超时时间（ms），-1 表示一直等待
+ * @return ESP_OK or ESP_ERR_TIMEOUT
+*/
+esp_err_t xWs2812MultiWaitDone(Ws2812MultiHandle_t xHandle, int iTimeoutMs);
+
+/** 逻辑索引转换为（灯带号, 灯带内偏移）
+ * @param xHandle 句柄
+ * @param ulIndex 逻辑索引
+ * @param pulStrip 返回的灯带号
+ * @param pulOffset 返回的灯带内偏移
+ * @return ESP_OK or ESP_FAIL
+*/
+esp_err_t xWs2812MultiLocate(Ws2812MultiHandle_t xHandle, uint32_t ulIndex, uint32_t *pulStrip, uint32_t *pulOffset);
+
+/** 获取逻辑帧缓存（GRB 顺序，每个 LED 3 字节），用于上层整帧写入
+ * @param xHandle 句柄
+ * @return 帧缓存首地址
+*/
+uint8_t *pcWs2812MultiGetBuffer(Ws2812MultiHandle_t xHandle);
+
+/** 获取所有灯带的 LED 总数
+ * @param xHandle 句柄
+ * @return LED 总数
+*/
+uint32_t ulWs2812MultiGetLedNum(Ws2812MultiHandle_t xHandle);
+
+#ifdef __cplusplus
+}
+#endif